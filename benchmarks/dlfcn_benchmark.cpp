@@ -37,3 +37,56 @@ BIONIC_TRIVIAL_BENCHMARK(BM_dladdr_libc_printf, bm_dladdr(printf));
 BIONIC_TRIVIAL_BENCHMARK(BM_dladdr_libdl_dladdr, bm_dladdr(dladdr));
 BIONIC_TRIVIAL_BENCHMARK(BM_dladdr_local_function, bm_dladdr(local_function));
 BIONIC_TRIVIAL_BENCHMARK(BM_dladdr_libbase_split, bm_dladdr(android::base::Split));
+
+// Populating a dispatch table: the same symbols looked up one dlsym() at a time, and in one
+// android_dlsym_batch() call.
+static const char* const kDispatchSymbols[] = {
+  "abort", "atoi", "calloc", "close", "fclose", "fflush", "fopen", "fprintf", "fread", "free",
+  "fwrite", "getenv", "getpid", "malloc", "memchr", "memcmp", "memcpy", "memmove", "memset",
+  "mmap", "munmap", "open", "pthread_create", "pthread_join", "pthread_mutex_lock",
+  "pthread_mutex_unlock", "read", "realloc", "snprintf", "strchr", "strcmp", "strcpy", "strdup",
+  "strlen", "strncmp", "strrchr", "strtol", "sysconf", "write",
+};
+static constexpr size_t kDispatchSymbolCount = sizeof(kDispatchSymbols) / sizeof(char*);
+
+#if defined(__BIONIC__)
+static constexpr const char* kLibcName = "libc.so";
+#else
+static constexpr const char* kLibcName = "libc.so.6";
+#endif
+
+static void BM_dlsym_dispatch_table(benchmark::State& state) {
+  void* handle = dlopen(kLibcName, RTLD_NOW);
+  if (handle == nullptr) abort();
+  void* table[kDispatchSymbolCount];
+  for (auto _ : state) {
+    for (size_t i = 0; i < kDispatchSymbolCount; ++i) {
+      table[i] = dlsym(handle, kDispatchSymbols[i]);
+    }
+    benchmark::DoNotOptimize(table);
+  }
+  state.SetItemsProcessed(state.iterations() * kDispatchSymbolCount);
+  dlclose(handle);
+}
+BIONIC_BENCHMARK(BM_dlsym_dispatch_table);
+
+#if defined(__BIONIC__)
+extern "C" size_t android_dlsym_batch(void* handle, const char* const* symbols, void** addresses,
+                                      size_t count);
+
+static void BM_dlsym_batch_dispatch_table(benchmark::State& state) {
+  void* handle = dlopen(kLibcName, RTLD_NOW);
+  if (handle == nullptr) abort();
+  void* table[kDispatchSymbolCount];
+  for (auto _ : state) {
+    if (android_dlsym_batch(handle, kDispatchSymbols, table, kDispatchSymbolCount) !=
+        kDispatchSymbolCount) {
+      abort();
+    }
+    benchmark::DoNotOptimize(table);
+  }
+  state.SetItemsProcessed(state.iterations() * kDispatchSymbolCount);
+  dlclose(handle);
+}
+BIONIC_BENCHMARK(BM_dlsym_batch_dispatch_table);
+#endif
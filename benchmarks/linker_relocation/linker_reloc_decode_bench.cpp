@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+// Microbenchmarks for the linker's relocation decoders: the SLEB128 reader used for Android packed
+// (APS2) relocations and the RELR bitmap walk. Unlike linker-reloc-bench, these run in-process on
+// synthetic tables, so they isolate the decode loops from mmap and symbol lookup.
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "linker_relr.h"
+#include "linker_sleb128.h"
+
+static void append_sleb128(std::vector<uint8_t>* out, int64_t value) {
+  bool more = true;
+  while (more) {
+    uint8_t byte = value & 0x7f;
+    value >>= 7;
+    more = !((value == 0 && (byte & 0x40) == 0) || (value == -1 && (byte & 0x40) != 0));
+    if (more) byte |= 0x80;
+    out->push_back(byte);
+  }
+}
+
+// A packed-relocation-like stream: mostly one-byte offset deltas, with an occasional group header
+// and relocation info word that need several bytes.
+static std::vector<uint8_t> make_packed_stream(size_t count) {
+  std::vector<uint8_t> stream;
+  for (size_t i = 0; i < count; ++i) {
+    if (i % 64 == 0) {
+      append_sleb128(&stream, 64);
+      append_sleb128(&stream, 0x40000017);
+    } else {
+      append_sleb128(&stream, sizeof(void*));
+    }
+  }
+  return stream;
+}
+
+static void BM_linker_sleb128_decode(benchmark::State& state) {
+  const size_t count = state.range(0);
+  std::vector<uint8_t> stream = make_packed_stream(count);
+  for (auto _ : state) {
+    sleb128_decoder decoder(stream.data(), stream.size());
+    size_t sum = 0;
+    for (size_t i = 0; i < count; ++i) {
+      sum += decoder.pop_front();
+      if (i % 64 == 0) sum += decoder.pop_front();
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_linker_sleb128_decode)->Arg(1 << 16);
+
+// Encodes one RELR table covering `word_count` words, relocating every `stride`-th word.
+static std::vector<ElfW(Relr)> make_relr(size_t word_count, size_t stride) {
+  constexpr size_t kBits = 8 * sizeof(ElfW(Relr)) - 1;
+  std::vector<ElfW(Relr)> relr;
+  relr.push_back(0);
+  for (size_t base = 1; base < word_count; base += kBits) {
+    ElfW(Relr) bitmap = 0;
+    for (size_t bit = 0; bit < kBits && base + bit < word_count; ++bit) {
+      if ((base + bit) % stride == 0) bitmap |= static_cast<ElfW(Relr)>(1) << bit;
+    }
+    relr.push_back((bitmap << 1) | 1);
+  }
+  return relr;
+}
+
+static void BM_linker_relr_apply(benchmark::State& state) {
+  const size_t word_count = state.range(0);
+  const size_t stride = state.range(1);
+  std::vector<ElfW(Relr)> relr = make_relr(word_count, stride);
+  std::vector<ElfW(Addr)> words(word_count);
+  ElfW(Addr) load_bias = reinterpret_cast<ElfW(Addr)>(words.data());
+  for (auto _ : state) {
+    relocate_relr(relr.data(), relr.data() + relr.size(), load_bias);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * (word_count / stride));
+}
+// Dense (every word, typical of vtables and GOTs) and sparse (every fourth word) bitmaps.
+BENCHMARK(BM_linker_relr_apply)->Args({1 << 16, 1})->Args({1 << 16, 4});
+
+BENCHMARK_MAIN();
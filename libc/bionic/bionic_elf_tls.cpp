@@ -357,6 +357,32 @@ static void update_tls_dtv(bionic_tcb* tcb) {
   dtv->generation = atomic_load(&modules.generation);
 }
 
+// Allocates and initializes a thread's copy of a dynamic module's TLS block,
+// and stores it in the thread's DTV, which must be up to date.
+//
+// This function must be called with signals blocked and a write lock on
+// TlsModules held.
+static void* allocate_dynamic_tls_block(TlsDtv* dtv, size_t module_idx) {
+  const TlsModules& modules = __libc_shared_globals()->tls_modules;
+  const TlsSegment& segment = modules.module_table[module_idx].segment;
+  // TODO: Currently the aligned_size.align.skew property is ignored.
+  // That is, for a dynamic TLS block at addr A, (A % p_align) will be 0, not
+  // (p_vaddr % p_align).
+  void* mod_ptr = __libc_shared_globals()->tls_allocator.memalign(segment.aligned_size.align.value,
+                                                                  segment.aligned_size.size);
+  if (segment.init_size > 0) {
+    memcpy(mod_ptr, segment.init_ptr, segment.init_size);
+  }
+  dtv->modules[module_idx] = mod_ptr;
+
+  // Reports the allocation to the listener, if any.
+  if (modules.on_creation_cb != nullptr) {
+    modules.on_creation_cb(
+        mod_ptr, static_cast<void*>(static_cast<char*>(mod_ptr) + segment.aligned_size.size));
+  }
+  return mod_ptr;
+}
+
 __attribute__((noinline)) static void* tls_get_addr_slow_path(const TlsIndex* ti) {
   TlsModules& modules = __libc_shared_globals()->tls_modules;
   bionic_tcb* tcb = __get_bionic_tcb();
@@ -372,22 +398,7 @@ __attribute__((noinline)) static void* tls_get_addr_slow_path(const TlsIndex* ti
   const size_t module_idx = __tls_module_id_to_idx(ti->module_id);
   void* mod_ptr = dtv->modules[module_idx];
   if (mod_ptr == nullptr) {
-    const TlsSegment& segment = modules.module_table[module_idx].segment;
-    // TODO: Currently the aligned_size.align.skew property is ignored.
-    // That is, for a dynamic TLS block at addr A, (A % p_align) will be 0, not
-    // (p_vaddr % p_align).
-    mod_ptr = __libc_shared_globals()->tls_allocator.memalign(segment.aligned_size.align.value,
-                                                              segment.aligned_size.size);
-    if (segment.init_size > 0) {
-      memcpy(mod_ptr, segment.init_ptr, segment.init_size);
-    }
-    dtv->modules[module_idx] = mod_ptr;
-
-    // Reports the allocation to the listener, if any.
-    if (modules.on_creation_cb != nullptr) {
-      modules.on_creation_cb(
-          mod_ptr, static_cast<void*>(static_cast<char*>(mod_ptr) + segment.aligned_size.size));
-    }
+    mod_ptr = allocate_dynamic_tls_block(dtv, module_idx);
   }
 
   return static_cast<char*>(mod_ptr) + ti->offset + TLS_DTV_OFFSET;
@@ -418,6 +429,38 @@ extern "C" void* TLS_GET_ADDR(const TlsIndex* ti) TLS_GET_ADDR_CALLING_CONVENTIO
   return tls_get_addr_slow_path(ti);
 }
 
+// In the eager dynamic TLS mode, a new thread calls this function before its
+// start routine to allocate a DTV for the current generation, and its copies of
+// the TLS blocks of all the dynamic modules loaded so far. Its first access to
+// each of them is then a fast path hit, instead of an allocation under the
+// TlsModules lock. Modules loaded later are still allocated on first access.
+//
+// The caller must have already blocked signals.
+void __init_dynamic_tls(bionic_tcb* tcb) {
+  TlsModules& modules = __libc_shared_globals()->tls_modules;
+  if (!atomic_load_explicit(&modules.eager_dynamic_tls, memory_order_relaxed)) {
+    return;
+  }
+
+  ScopedWriteLock locker(&modules.rwlock);
+
+  // A thread that would never need a DTV shouldn't get one.
+  if (modules.module_count == modules.static_module_count) {
+    return;
+  }
+
+  update_tls_dtv(tcb);
+
+  TlsDtv* dtv = __get_tcb_dtv(tcb);
+  for (size_t i = modules.static_module_count; i < modules.module_count; ++i) {
+    // Skip the slots of unloaded modules.
+    if (modules.module_table[i].first_generation == kTlsGenerationNone) continue;
+    if (dtv->modules[i] == nullptr) {
+      allocate_dynamic_tls_block(dtv, i);
+    }
+  }
+}
+
 // This function frees:
 //  - TLS modules referenced by the current DTV.
 //  - The list of DTV objects associated with the current thread.
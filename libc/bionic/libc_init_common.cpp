@@ -315,15 +315,23 @@ static bool __is_unsafe_environment_variable(const char* name) {
       "LD_AOUT_LIBRARY_PATH",
       "LD_AOUT_PRELOAD",
       "LD_AUDIT",
+      "LD_BINDING_CACHE_DIR",
+      "LD_CONFIG_CACHE_DIR",
       "LD_CONFIG_FILE",
       "LD_DEBUG",
       "LD_DEBUG_OUTPUT",
       "LD_DYNAMIC_WEAK",
+      "LD_EAGER_DYNAMIC_TLS",
       "LD_HWASAN",
       "LD_LIBRARY_PATH",
+      "LD_LOAD_TIMELINE",
       "LD_ORIGIN_PATH",
       "LD_PRELOAD",
       "LD_PROFILE",
+      "LD_RELOCATION_THREADS",
+      "LD_RELOC_STATS",
+      "LD_RELRO_CACHE_DIR",
+      "LD_RESERVATION_POOL",
       "LD_SHOW_AUXV",
       "LD_USE_LOAD_BIAS",
       "LIBC_DEBUG_MALLOC_OPTIONS",
@@ -118,6 +118,9 @@ static void __libc_preinit_impl() {
   __libc_init_fork_handler();
 
   __libc_shared_globals()->set_target_sdk_version_hook = __libc_set_target_sdk_version;
+  __libc_shared_globals()->pthread_create_hook = pthread_create;
+  __libc_shared_globals()->pthread_join_hook = pthread_join;
+  __libc_shared_globals()->pthread_atfork_hook = pthread_atfork;
 
   netdClientInit();
 }
@@ -370,6 +370,8 @@ static int __pthread_start(void* arg) {
 
   __set_stack_and_tls_vma_name(false);
   __init_additional_stacks(thread);
+  // Signals are still blocked here, as __init_dynamic_tls requires.
+  __init_dynamic_tls(__get_bionic_tcb());
   __rt_sigprocmask(SIG_SETMASK, &thread->start_mask, nullptr, sizeof(thread->start_mask));
 #if defined(__aarch64__)
   // Chrome's sandbox prevents this prctl, so only reset IA if the target SDK level is high enough.
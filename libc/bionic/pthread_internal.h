@@ -175,6 +175,19 @@ class pthread_internal_t {
 #define __BIONIC_DLERROR_BUFFER_SIZE 512
   char dlerror_buffer[__BIONIC_DLERROR_BUFFER_SIZE];
 
+  /*
+   * How many times this thread has entered the dynamic linker with its lock held shared (a signal
+   * handler can nest), and where the linker formats errors meanwhile.
+   */
+  uint32_t dl_shared_lock_depth;
+  char* dl_shared_error_buffer;
+
+  /*
+   * How many dl_iterate_phdr() calls this thread is inside, by the parity of the reader epoch they
+   * entered in. Only these readers survive into the child of a fork().
+   */
+  uint32_t dl_phdr_snapshot_readers[2];
+
   bionic_tls* bionic_tls;
 
   int errno_value;
@@ -87,4 +87,14 @@ class CFIShadow {
   };
 };
 
+// Slow path counters for one CFI-enabled module, as reported by __cfi_slowpath_get_stats().
+struct CFISlowpathStats {
+  // The module's __cfi_check, which identifies it (dladdr() gives its name).
+  uintptr_t cfi_check;
+  // __cfi_slowpath calls for targets in this module, and how many of them the slow path cache
+  // answered without calling __cfi_check.
+  uint64_t calls;
+  uint64_t cache_hits;
+};
+
 #endif  // CFI_SHADOW_H
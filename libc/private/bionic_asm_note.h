@@ -32,3 +32,4 @@
 #define NT_ANDROID_TYPE_KUSER 3
 #define NT_ANDROID_TYPE_MEMTAG 4
 #define NT_ANDROID_TYPE_PAD_SEGMENT 5
+#define NT_ANDROID_TYPE_HUGEPAGE_TEXT 6
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <sys/cdefs.h>
+#include <sys/types.h>
+
+__BEGIN_DECLS
+
+// The phases of loading a library that the linker's load timeline records.
+enum {
+  // Searching for the library and opening it.
+  ANDROID_DL_LOAD_PHASE_OPEN = 0,
+  // Reading and checking the ELF header, program headers and dynamic section.
+  ANDROID_DL_LOAD_PHASE_READ,
+  // Reserving address space for the library.
+  ANDROID_DL_LOAD_PHASE_RESERVE,
+  // Mapping the PT_LOAD segments.
+  ANDROID_DL_LOAD_PHASE_LOAD_SEGMENTS,
+  // Parsing the dynamic section (soinfo::prelink_image).
+  ANDROID_DL_LOAD_PHASE_PRELINK,
+  // Applying relocations (the bulk of soinfo::link_image).
+  ANDROID_DL_LOAD_PHASE_LINK,
+  // Protecting, and optionally sharing, the RELRO segment.
+  ANDROID_DL_LOAD_PHASE_RELRO,
+  // Running DT_INIT and DT_INIT_ARRAY. Dependencies' constructors are recorded separately.
+  ANDROID_DL_LOAD_PHASE_CONSTRUCTORS,
+
+  ANDROID_DL_LOAD_PHASE_COUNT,
+};
+
+// One timed phase of loading one library.
+typedef struct {
+  // The library's real path.
+  const char* library;
+  // One of the ANDROID_DL_LOAD_PHASE_* values, and its name.
+  int phase;
+  const char* phase_name;
+  // The thread that did the work. Relocation may happen on helper threads.
+  pid_t tid;
+  // CLOCK_MONOTONIC at the start of the phase.
+  uint64_t start_ns;
+  // Elapsed wall and thread CPU time. A phase that loads more libraries (a constructor that calls
+  // dlopen(), say) includes their time too.
+  uint64_t wall_ns;
+  uint64_t cpu_ns;
+} android_dl_load_phase_info;
+
+__END_DECLS
@@ -181,6 +181,10 @@ struct TlsModules {
 
   // The additional callbacks, if any.
   CallbackHolder* thread_exit_callback_tail_node = nullptr;
+
+  // Whether new threads allocate the TLS blocks of all the loaded dynamic
+  // modules up front, instead of on each module's first access.
+  _Atomic(bool) eager_dynamic_tls = false;
 };
 
 void __init_static_tls(void* static_tls);
@@ -226,6 +230,7 @@ struct TlsIndex {
 extern "C" void* TLS_GET_ADDR(const TlsIndex* ti) TLS_GET_ADDR_CALLING_CONVENTION;
 
 struct bionic_tcb;
+void __init_dynamic_tls(bionic_tcb* tcb);
 void __free_dynamic_tls(bionic_tcb* tcb);
 void __notify_thread_exit_callbacks();
 
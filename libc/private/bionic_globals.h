@@ -128,6 +128,11 @@ struct libc_shared_globals {
   void (*load_hook)(ElfW(Addr) base, const ElfW(Phdr)* phdr, ElfW(Half) phnum) = nullptr;
   void (*unload_hook)(ElfW(Addr) base, const ElfW(Phdr)* phdr, ElfW(Half) phnum) = nullptr;
   void (*set_target_sdk_version_hook)(int target) = nullptr;
+  // Used by the loader to run work on helper threads once libc.so is initialized.
+  int (*pthread_create_hook)(pthread_t* thread, const pthread_attr_t* attr,
+                             void* (*start_routine)(void*), void* arg) = nullptr;
+  int (*pthread_join_hook)(pthread_t thread, void** result) = nullptr;
+  int (*pthread_atfork_hook)(void (*prepare)(), void (*parent)(), void (*child)()) = nullptr;
 
   // Values passed from the linker to libc.so.
   const char* init_progname = nullptr;
@@ -19,6 +19,12 @@
 #include <stdlib.h>
 #include <android/dlext.h>
 
+#include "private/bionic_dl_load_timeline.h"
+#include "private/bionic_dl_reloc_stats.h"
+#include "private/bionic_dl_reservation_pool.h"
+#include "private/bionic_dl_tls_stats.h"
+#include "private/bionic_dl_zip_archive_cache.h"
+
 // These functions are exported by the loader
 // TODO(dimitry): replace these with reference to libc.so
 
@@ -56,9 +62,58 @@ bool __loader_android_link_namespaces(
 __attribute__((__weak__, visibility("default")))
 void __loader_android_dlwarning(void* obj, void (*f)(void*, const char*));
 
+__attribute__((__weak__, visibility("default")))
+struct android_dlopen_async_request* __loader_android_dlopen_async(
+    const char* filename, int flags, const android_dlextinfo* extinfo, int notify_fd,
+    const void* caller_addr);
+
+__attribute__((__weak__, visibility("default")))
+bool __loader_android_dlopen_async_is_done(struct android_dlopen_async_request* request);
+
+__attribute__((__weak__, visibility("default")))
+void* __loader_android_dlopen_async_wait(struct android_dlopen_async_request* request);
+
+__attribute__((__weak__, visibility("default")))
+size_t __loader_android_dlsym_batch(void* handle,
+                                    const char* const* symbols,
+                                    void** addresses,
+                                    size_t count,
+                                    const void* caller_addr);
+
 __attribute__((__weak__, visibility("default")))
 struct android_namespace_t* __loader_android_get_exported_namespace(const char* name);
 
+__attribute__((__weak__, visibility("default")))
+int __loader_android_dl_iterate_load_timeline(
+    int (*cb)(const android_dl_load_phase_info* info, void* data), void* data);
+
+__attribute__((__weak__, visibility("default")))
+void __loader_android_dl_set_load_timeline_enabled(bool enabled);
+
+__attribute__((__weak__, visibility("default")))
+bool __loader_android_dl_get_reloc_stats(void* handle, android_dl_reloc_stats* stats);
+
+__attribute__((__weak__, visibility("default")))
+void __loader_android_dl_set_reloc_stats_enabled(bool enabled);
+
+__attribute__((__weak__, visibility("default")))
+void __loader_android_dl_get_reservation_pool_stats(android_dl_reservation_pool_stats* stats);
+
+__attribute__((__weak__, visibility("default")))
+void __loader_android_dl_set_reservation_pool_limits(size_t max_regions, size_t max_bytes);
+
+__attribute__((__weak__, visibility("default")))
+void __loader_android_dl_get_tls_stats(android_dl_tls_stats* stats);
+
+__attribute__((__weak__, visibility("default")))
+void __loader_android_dl_set_eager_dynamic_tls(bool enabled);
+
+__attribute__((__weak__, visibility("default")))
+void __loader_android_dl_get_zip_archive_cache_stats(android_dl_zip_archive_cache_stats* stats);
+
+__attribute__((__weak__, visibility("default")))
+void __loader_android_dl_set_zip_archive_cache_limits(size_t max_archives, size_t max_bytes);
+
 // Proxy calls to bionic loader
 __attribute__((__weak__))
 void android_get_LD_LIBRARY_PATH(char* buffer, size_t buffer_size) {
@@ -110,9 +165,85 @@ void android_dlwarning(void* obj, void (*f)(void*, const char*)) {
   __loader_android_dlwarning(obj, f);
 }
 
+__attribute__((__weak__))
+struct android_dlopen_async_request* android_dlopen_async(const char* filename, int flags,
+                                                          const android_dlextinfo* extinfo,
+                                                          int notify_fd) {
+  const void* caller_addr = __builtin_return_address(0);
+  return __loader_android_dlopen_async(filename, flags, extinfo, notify_fd, caller_addr);
+}
+
+__attribute__((__weak__))
+bool android_dlopen_async_is_done(struct android_dlopen_async_request* request) {
+  return __loader_android_dlopen_async_is_done(request);
+}
+
+__attribute__((__weak__))
+void* android_dlopen_async_wait(struct android_dlopen_async_request* request) {
+  return __loader_android_dlopen_async_wait(request);
+}
+
+__attribute__((__weak__))
+size_t android_dlsym_batch(void* handle, const char* const* symbols, void** addresses,
+                           size_t count) {
+  const void* caller_addr = __builtin_return_address(0);
+  return __loader_android_dlsym_batch(handle, symbols, addresses, count, caller_addr);
+}
+
 __attribute__((__weak__))
 struct android_namespace_t* android_get_exported_namespace(const char* name) {
   return __loader_android_get_exported_namespace(name);
 }
 
+__attribute__((__weak__))
+int android_dl_iterate_load_timeline(
+    int (*cb)(const android_dl_load_phase_info* info, void* data), void* data) {
+  return __loader_android_dl_iterate_load_timeline(cb, data);
+}
+
+__attribute__((__weak__))
+void android_dl_set_load_timeline_enabled(bool enabled) {
+  __loader_android_dl_set_load_timeline_enabled(enabled);
+}
+
+__attribute__((__weak__))
+bool android_dl_get_reloc_stats(void* handle, android_dl_reloc_stats* stats) {
+  return __loader_android_dl_get_reloc_stats(handle, stats);
+}
+
+__attribute__((__weak__))
+void android_dl_set_reloc_stats_enabled(bool enabled) {
+  __loader_android_dl_set_reloc_stats_enabled(enabled);
+}
+
+__attribute__((__weak__))
+void android_dl_get_reservation_pool_stats(android_dl_reservation_pool_stats* stats) {
+  __loader_android_dl_get_reservation_pool_stats(stats);
+}
+
+__attribute__((__weak__))
+void android_dl_set_reservation_pool_limits(size_t max_regions, size_t max_bytes) {
+  __loader_android_dl_set_reservation_pool_limits(max_regions, max_bytes);
+}
+
+__attribute__((__weak__))
+void android_dl_get_tls_stats(android_dl_tls_stats* stats) {
+  __loader_android_dl_get_tls_stats(stats);
+}
+
+__attribute__((__weak__))
+void android_dl_set_eager_dynamic_tls(bool enabled) {
+  __loader_android_dl_set_eager_dynamic_tls(enabled);
+}
+
+__attribute__((__weak__))
+void android_dl_get_zip_archive_cache_stats(android_dl_zip_archive_cache_stats* stats) {
+  __loader_android_dl_get_zip_archive_cache_stats(stats);
+}
+
+__attribute__((__weak__))
+void android_dl_set_zip_archive_cache_limits(size_t max_archives, size_t max_bytes) {
+  __loader_android_dl_set_zip_archive_cache_limits(max_archives, max_bytes);
+}
+
 } // extern "C"
@@ -66,7 +66,134 @@ static uintptr_t cfi_check_addr(uint16_t v, void* Ptr) {
   return p;
 }
 
+// The slow path cache remembers (CallSiteTypeId, Ptr) pairs that __cfi_check has accepted, so
+// that hot indirect calls to the same few targets don't go through __cfi_check every time. It's a
+// direct-mapped table shared by all threads. Each entry is guarded by a sequence number that is
+// odd while it's being written, so readers never need a lock and see either a whole entry or a
+// miss. Writers that find an entry already being written simply don't cache.
+//
+// The linker bumps the generation before unloading any library, which invalidates every entry:
+// after that the address may belong to a different library, or to none.
+//
+// A writable cache of accepted targets is weaker against memory corruption than the read-only
+// shadow, so it's off unless the process turns it on with __cfi_slowpath_cache_set_enabled().
+struct CfiCacheEntry {
+  uint32_t sequence;
+  uint32_t generation;
+  uint64_t type_id;
+  uintptr_t ptr;
+  uintptr_t cfi_check;
+};
+
+static constexpr size_t kCfiCacheBits = 8;
+static CfiCacheEntry g_cfi_cache[1 << kCfiCacheBits];
+static uint32_t g_cfi_cache_generation;
+static bool g_cfi_cache_enabled;
+
+static CfiCacheEntry* cfi_cache_entry(uint64_t CallSiteTypeId, void* Ptr) {
+  uint64_t key = CallSiteTypeId ^ (reinterpret_cast<uintptr_t>(Ptr) >> 2);
+  return &g_cfi_cache[(key * 0x9e3779b97f4a7c15ULL) >> (64 - kCfiCacheBits)];
+}
+
+// Returns the __cfi_check that accepted (CallSiteTypeId, Ptr), or 0 on a miss.
+static uintptr_t cfi_cache_lookup(CfiCacheEntry* e, uint64_t CallSiteTypeId, void* Ptr,
+                                  uint32_t generation) {
+  uint32_t sequence = __atomic_load_n(&e->sequence, __ATOMIC_ACQUIRE);
+  if (sequence & 1) return 0;
+  bool match = e->generation == generation && e->type_id == CallSiteTypeId &&
+               e->ptr == reinterpret_cast<uintptr_t>(Ptr);
+  uintptr_t cfi_check = e->cfi_check;
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  if (__atomic_load_n(&e->sequence, __ATOMIC_RELAXED) != sequence) return 0;
+  return match ? cfi_check : 0;
+}
+
+static void cfi_cache_insert(CfiCacheEntry* e, uint64_t CallSiteTypeId, void* Ptr,
+                             uintptr_t cfi_check, uint32_t generation) {
+  uint32_t sequence = __atomic_load_n(&e->sequence, __ATOMIC_RELAXED);
+  if ((sequence & 1) || !__atomic_compare_exchange_n(&e->sequence, &sequence, sequence + 1, false,
+                                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+    return;
+  }
+  e->generation = generation;
+  e->type_id = CallSiteTypeId;
+  e->ptr = reinterpret_cast<uintptr_t>(Ptr);
+  e->cfi_check = cfi_check;
+  __atomic_store_n(&e->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+// Per-module slow path counters, keyed by the module's __cfi_check. Off unless turned on with
+// __cfi_slowpath_stats_set_enabled(), since every thread updating the same counters is costly.
+// Modules beyond the first kMaxCfiStatsModules aren't counted.
+static constexpr size_t kMaxCfiStatsModules = 64;
+static CFISlowpathStats g_cfi_stats[kMaxCfiStatsModules];
+static bool g_cfi_stats_enabled;
+
+static void cfi_stats_record(uintptr_t cfi_check, bool cache_hit) {
+  for (CFISlowpathStats& stats : g_cfi_stats) {
+    uintptr_t module = __atomic_load_n(&stats.cfi_check, __ATOMIC_RELAXED);
+    if (module == 0) {
+      if (!__atomic_compare_exchange_n(&stats.cfi_check, &module, cfi_check, false,
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED) &&
+          module != cfi_check) {
+        continue;
+      }
+    } else if (module != cfi_check) {
+      continue;
+    }
+    __atomic_fetch_add(&stats.calls, 1, __ATOMIC_RELAXED);
+    if (cache_hit) __atomic_fetch_add(&stats.cache_hits, 1, __ATOMIC_RELAXED);
+    return;
+  }
+}
+
+extern "C" void __cfi_slowpath_cache_set_enabled(bool enabled) {
+  __atomic_store_n(&g_cfi_cache_enabled, enabled, __ATOMIC_RELAXED);
+}
+
+// Called by the loader before it unloads a library.
+extern "C" void __cfi_slowpath_cache_invalidate() {
+  __atomic_fetch_add(&g_cfi_cache_generation, 1, __ATOMIC_RELEASE);
+}
+
+extern "C" void __cfi_slowpath_stats_set_enabled(bool enabled) {
+  __atomic_store_n(&g_cfi_stats_enabled, enabled, __ATOMIC_RELAXED);
+}
+
+// Copies the counters of up to `count` modules into `stats`, and returns the number of modules
+// with counters.
+extern "C" size_t __cfi_slowpath_get_stats(CFISlowpathStats* stats, size_t count) {
+  size_t modules = 0;
+  for (const CFISlowpathStats& module : g_cfi_stats) {
+    uintptr_t cfi_check = __atomic_load_n(&module.cfi_check, __ATOMIC_RELAXED);
+    if (cfi_check == 0) break;
+    if (modules < count) {
+      stats[modules].cfi_check = cfi_check;
+      stats[modules].calls = __atomic_load_n(&module.calls, __ATOMIC_RELAXED);
+      stats[modules].cache_hits = __atomic_load_n(&module.cache_hits, __ATOMIC_RELAXED);
+    }
+    ++modules;
+  }
+  return modules;
+}
+
 static inline void cfi_slowpath_common(uint64_t CallSiteTypeId, void* Ptr, void* DiagData) {
+  // Without DiagData, __cfi_check traps instead of returning when the check fails, so a call that
+  // returns means the target is valid and can be cached.
+  CfiCacheEntry* cache_entry = nullptr;
+  uint32_t generation = 0;
+  if (DiagData == nullptr && __atomic_load_n(&g_cfi_cache_enabled, __ATOMIC_RELAXED)) {
+    cache_entry = cfi_cache_entry(CallSiteTypeId, Ptr);
+    generation = __atomic_load_n(&g_cfi_cache_generation, __ATOMIC_ACQUIRE);
+    uintptr_t cfi_check = cfi_cache_lookup(cache_entry, CallSiteTypeId, Ptr, generation);
+    if (cfi_check != 0) {
+      if (__atomic_load_n(&g_cfi_stats_enabled, __ATOMIC_RELAXED)) {
+        cfi_stats_record(cfi_check, true);
+      }
+      return;
+    }
+  }
+
   uint16_t v = shadow_load(Ptr);
   switch (v) {
     case CFIShadow::kInvalidShadow:
@@ -74,8 +201,16 @@ static inline void cfi_slowpath_common(uint64_t CallSiteTypeId, void* Ptr, void*
       break;
     case CFIShadow::kUncheckedShadow:
       break;
-    default:
-      reinterpret_cast<CFIShadow::CFICheckFn>(cfi_check_addr(v, Ptr))(CallSiteTypeId, Ptr, DiagData);
+    default: {
+      uintptr_t cfi_check = cfi_check_addr(v, Ptr);
+      if (__atomic_load_n(&g_cfi_stats_enabled, __ATOMIC_RELAXED)) {
+        cfi_stats_record(cfi_check, false);
+      }
+      reinterpret_cast<CFIShadow::CFICheckFn>(cfi_check)(CallSiteTypeId, Ptr, DiagData);
+      if (cache_entry != nullptr) {
+        cfi_cache_insert(cache_entry, CallSiteTypeId, Ptr, cfi_check, generation);
+      }
+    }
   }
 }
 
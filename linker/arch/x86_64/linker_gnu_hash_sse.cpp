@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+// An SSE4.1 vectorized implementation of the GNU symbol hash function.
+
+// Like the Neon version, this function reads beyond the bounds of the name string: it reads each
+// aligned 16-byte chunk containing a byte of the string, including the final NUL byte. An aligned
+// 16-byte load never crosses a page boundary, so the extra bytes are always readable.
+
+#include "linker_gnu_hash_sse.h"
+
+#include <smmintrin.h>
+#include <stdint.h>
+
+// 33 * 0x3e0f83e1 == 1 (mod 2**32)
+static constexpr uint32_t kInverse33 = 0x3e0f83e1;
+
+static constexpr uint32_t power(uint32_t base, int exp) {
+  uint32_t result = 1;
+  for (int i = 0; i < exp; ++i) result *= base;
+  return result;
+}
+
+struct GnuHashSseTables {
+  // 16 bytes of 0xff followed by 16 bytes of 0. Loading 16 bytes starting at (16 - K) produces a
+  // vector whose first K bytes are 0xff.
+  uint8_t ignore_mask[32];
+  // Initial accumulator for a string misaligned by K bytes: 5381 * 33**-K, minus the contribution
+  // of the K leading 0xff bytes.
+  uint32_t init_accum[16];
+  // 33**N, used to advance the accumulator over the N bytes of the final chunk.
+  uint32_t final_step[16];
+  // 33**15 down to 33**0, then 16 zeros. Loading 16 words starting at (16 - N) gives the per-byte
+  // multipliers for a chunk with N remaining bytes; the full chunk multipliers start at 0.
+  uint32_t incline[32];
+};
+
+static constexpr GnuHashSseTables make_tables() {
+  GnuHashSseTables result {};
+  for (int i = 0; i < 16; ++i) {
+    result.ignore_mask[i] = 0xff;
+    result.ignore_mask[16 + i] = 0;
+    uint32_t accum = 5381u * power(kInverse33, i);
+    for (int j = 1; j <= i; ++j) {
+      accum -= 0xffu * power(kInverse33, j);
+    }
+    result.init_accum[i] = accum;
+    result.final_step[i] = power(33, i);
+    result.incline[i] = power(33, 15 - i);
+    result.incline[16 + i] = 0;
+  }
+  return result;
+}
+
+alignas(16) static constexpr GnuHashSseTables kTables = make_tables();
+
+// Multiply each byte of the chunk by the matching 32-bit word of the incline, and sum the products
+// into four lanes.
+__attribute__((target("sse4.1"), always_inline))
+static inline __m128i weigh_chunk(__m128i chunk, const uint32_t* incline) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i* incline_vec = reinterpret_cast<const __m128i*>(incline);
+  const __m128i lo = _mm_unpacklo_epi8(chunk, zero);
+  const __m128i hi = _mm_unpackhi_epi8(chunk, zero);
+
+  __m128i sum = _mm_mullo_epi32(_mm_unpacklo_epi16(lo, zero), _mm_loadu_si128(incline_vec + 0));
+  sum = _mm_add_epi32(sum, _mm_mullo_epi32(_mm_unpackhi_epi16(lo, zero),
+                                           _mm_loadu_si128(incline_vec + 1)));
+  sum = _mm_add_epi32(sum, _mm_mullo_epi32(_mm_unpacklo_epi16(hi, zero),
+                                           _mm_loadu_si128(incline_vec + 2)));
+  sum = _mm_add_epi32(sum, _mm_mullo_epi32(_mm_unpackhi_epi16(hi, zero),
+                                           _mm_loadu_si128(incline_vec + 3)));
+  return sum;
+}
+
+// Calculate the GNU hash and string length of the symbol name.
+//
+// The hash is the same as calculate_gnu_hash_simple's: h = h * 33 + c for each byte, starting at
+// 5381. Each 16-byte chunk is folded in with h = h * 33**16 + sum(c[i] * 33**(15 - i)), spread
+// over four 32-bit lanes that are added together at the end.
+//
+// This does an within-alignment out-of-bounds read for performance reasons.
+__attribute__((target("sse4.1"), no_sanitize("address", "hwaddress")))
+std::pair<uint32_t, uint32_t> calculate_gnu_hash_sse(const char* name) {
+  const uintptr_t offset = reinterpret_cast<uintptr_t>(name) & 15;
+  const __m128i* chunk_ptr =
+      reinterpret_cast<const __m128i*>(reinterpret_cast<uintptr_t>(name) & ~uintptr_t{15});
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i step16 = _mm_set1_epi32(power(33, 16));
+
+  // Force the bytes preceding the string to 0xff so they aren't mistaken for the terminator. The
+  // initial accumulator cancels out their contribution.
+  __m128i chunk = _mm_load_si128(chunk_ptr);
+  chunk = _mm_or_si128(chunk, _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(&kTables.ignore_mask[16 - offset])));
+  __m128i accum = _mm_cvtsi32_si128(kTables.init_accum[offset]);
+
+  uint32_t is_nul;
+  while ((is_nul = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, zero))) == 0) {
+    accum = _mm_mullo_epi32(accum, step16);
+    accum = _mm_add_epi32(accum, weigh_chunk(chunk, &kTables.incline[0]));
+    chunk = _mm_load_si128(++chunk_ptr);
+  }
+
+  const uint32_t num_valid = __builtin_ctz(is_nul);
+  const uint32_t name_len = reinterpret_cast<const char*>(chunk_ptr) - name + num_valid;
+
+  // Fold in the bytes before the NUL. The multipliers for the NUL and everything after it are 0.
+  accum = _mm_mullo_epi32(accum, _mm_set1_epi32(kTables.final_step[num_valid]));
+  accum = _mm_add_epi32(accum, weigh_chunk(chunk, &kTables.incline[16 - num_valid]));
+
+  // Combine the four lanes into a single 32-bit result.
+  accum = _mm_add_epi32(accum, _mm_shuffle_epi32(accum, _MM_SHUFFLE(1, 0, 3, 2)));
+  accum = _mm_add_epi32(accum, _mm_shuffle_epi32(accum, _MM_SHUFFLE(2, 3, 0, 1)));
+  const uint32_t hash = _mm_cvtsi128_si32(accum);
+
+  return { hash, name_len };
+}
@@ -29,20 +29,28 @@
 #include "linker.h"
 #include "linker_cfi.h"
 #include "linker_debuggerd.h"
+#include "linker_dlopen_async.h"
 #include "linker_dlwarning.h"
 #include "linker_globals.h"
+#include "linker_load_timeline.h"
+#include "linker_reloc_stats.h"
+#include "linker_reservation_pool.h"
+#include "linker_tls.h"
+#include "linker_zip_archive_cache.h"
 
 #include <link.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <android/api-level.h>
 
+#include <atomic>
+
 #include <bionic/pthread_internal.h>
 #include "private/bionic_globals.h"
 #include "private/bionic_tls.h"
-#include "private/ScopedPthreadMutexLocker.h"
 
 #define __LINKER_PUBLIC__ __attribute__((visibility("default")))
 
@@ -59,7 +67,30 @@ void* __loader_android_dlopen_ext(const char* filename,
                            int flags,
                            const android_dlextinfo* extinfo,
                            const void* caller_addr) __LINKER_PUBLIC__;
+android_dlopen_async_request* __loader_android_dlopen_async(const char* filename,
+                                                            int flags,
+                                                            const android_dlextinfo* extinfo,
+                                                            int notify_fd,
+                                                            const void* caller_addr) __LINKER_PUBLIC__;
+bool __loader_android_dlopen_async_is_done(android_dlopen_async_request* request) __LINKER_PUBLIC__;
+void* __loader_android_dlopen_async_wait(android_dlopen_async_request* request) __LINKER_PUBLIC__;
 void __loader_android_dlwarning(void* obj, void (*f)(void*, const char*)) __LINKER_PUBLIC__;
+int __loader_android_dl_iterate_load_timeline(
+    int (*cb)(const android_dl_load_phase_info* info, void* data), void* data) __LINKER_PUBLIC__;
+void __loader_android_dl_set_load_timeline_enabled(bool enabled) __LINKER_PUBLIC__;
+bool __loader_android_dl_get_reloc_stats(void* handle,
+                                         android_dl_reloc_stats* stats) __LINKER_PUBLIC__;
+void __loader_android_dl_set_reloc_stats_enabled(bool enabled) __LINKER_PUBLIC__;
+void __loader_android_dl_get_reservation_pool_stats(
+    android_dl_reservation_pool_stats* stats) __LINKER_PUBLIC__;
+void __loader_android_dl_set_reservation_pool_limits(size_t max_regions,
+                                                     size_t max_bytes) __LINKER_PUBLIC__;
+void __loader_android_dl_get_tls_stats(android_dl_tls_stats* stats) __LINKER_PUBLIC__;
+void __loader_android_dl_get_zip_archive_cache_stats(
+    android_dl_zip_archive_cache_stats* stats) __LINKER_PUBLIC__;
+void __loader_android_dl_set_zip_archive_cache_limits(size_t max_archives,
+                                                      size_t max_bytes) __LINKER_PUBLIC__;
+void __loader_android_dl_set_eager_dynamic_tls(bool enabled) __LINKER_PUBLIC__;
 int __loader_android_get_application_target_sdk_version() __LINKER_PUBLIC__;
 void __loader_android_get_LD_LIBRARY_PATH(char* buffer, size_t buffer_size) __LINKER_PUBLIC__;
 android_namespace_t* __loader_android_get_exported_namespace(const char* name) __LINKER_PUBLIC__;
@@ -87,6 +118,11 @@ void* __loader_dlvsym(void* handle,
                       const char* symbol,
                       const char* version,
                       const void* caller_addr) __LINKER_PUBLIC__;
+size_t __loader_android_dlsym_batch(void* handle,
+                                    const char* const* symbols,
+                                    void** addresses,
+                                    size_t count,
+                                    const void* caller_addr) __LINKER_PUBLIC__;
 void __loader_add_thread_local_dtor(void* dso_handle) __LINKER_PUBLIC__;
 void __loader_remove_thread_local_dtor(void* dso_handle) __LINKER_PUBLIC__;
 libc_shared_globals* __loader_shared_globals() __LINKER_PUBLIC__;
@@ -97,7 +133,113 @@ bool __loader_android_handle_signal(int signal_number, siginfo_t* info,
                                     void* context) __LINKER_PUBLIC__;
 }
 
-pthread_mutex_t g_dl_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+// Held by the exclusive owner of the loader lock. It is recursive so that constructors and
+// callbacks run under the lock can call back into the loader.
+static pthread_mutex_t g_dl_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+// Write-locked by the exclusive owner (once, however deeply it recurses) and read-locked by shared
+// holders. Exclusive owners queue on g_dl_mutex first, so at most one waits here at a time, and
+// the rwlock prefers it over new readers so a stream of lookups can't starve dlopen().
+static pthread_rwlock_t g_dl_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+
+// Only written by the thread holding g_dl_mutex.
+static std::atomic<pid_t> g_dl_exclusive_tid(0);
+static size_t g_dl_exclusive_depth = 0;
+
+static std::atomic<size_t> g_dl_shared_count(0);
+
+void dl_lock_init() {
+  pthread_rwlockattr_t attr;
+  pthread_rwlockattr_init(&attr);
+  pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+  pthread_rwlock_init(&g_dl_rwlock, &attr);
+  pthread_rwlockattr_destroy(&attr);
+}
+
+void dl_lock_exclusive() {
+  // The rwlock would make this thread wait for its own read lock forever.
+  if (__predict_false(__get_thread()->dl_shared_lock_depth != 0)) {
+    async_safe_fatal("the loader lock was requested exclusively by a thread that holds it shared "
+                     "(dlopen() or dlclose() called from a signal handler that interrupted dlsym() "
+                     "or dladdr()?)");
+  }
+  pthread_mutex_lock(&g_dl_mutex);
+  if (g_dl_exclusive_depth++ != 0) return;
+
+  pthread_rwlock_wrlock(&g_dl_rwlock);
+  g_dl_exclusive_tid.store(gettid(), std::memory_order_relaxed);
+}
+
+void dl_unlock_exclusive() {
+  if (--g_dl_exclusive_depth == 0) {
+    // Shared holders and dl_iterate_phdr() rely on what's published here being current.
+    update_loader_snapshots();
+    g_dl_exclusive_tid.store(0, std::memory_order_relaxed);
+    pthread_rwlock_unlock(&g_dl_rwlock);
+  }
+  pthread_mutex_unlock(&g_dl_mutex);
+}
+
+bool dl_lock_is_held_exclusively() {
+  // Only this thread can have stored its own tid, so a relaxed load is enough to tell whether
+  // we're nested inside our own exclusive section.
+  return g_dl_exclusive_tid.load(std::memory_order_relaxed) == gettid();
+}
+
+bool dl_lock_shared() {
+  if (dl_lock_is_held_exclusively()) {
+    return false;
+  }
+
+  // A signal handler that interrupts a shared holder already has the access it needs. Taking the
+  // rwlock again would deadlock behind a waiting writer, so only the outermost entry takes it. The
+  // depth is only raised once the lock is held, so a handler can't skip a lock that isn't.
+  pthread_internal_t* thread = __get_thread();
+  if (thread->dl_shared_lock_depth == 0) {
+    pthread_rwlock_rdlock(&g_dl_rwlock);
+    g_dl_shared_count.fetch_add(1, std::memory_order_relaxed);
+    // Shared holders can allocate concurrently.
+    linker_allocator_enable_locking();
+  }
+  ++thread->dl_shared_lock_depth;
+  return true;
+}
+
+void dl_unlock_shared() {
+  pthread_internal_t* thread = __get_thread();
+  if (--thread->dl_shared_lock_depth == 0) {
+    linker_allocator_disable_locking();
+    g_dl_shared_count.fetch_sub(1, std::memory_order_relaxed);
+    pthread_rwlock_unlock(&g_dl_rwlock);
+  }
+}
+
+bool dl_suspend_shared() {
+  // A nested shared section can't release a hold that belongs to the one it interrupted.
+  if (__get_thread()->dl_shared_lock_depth != 1) {
+    return false;
+  }
+  dl_unlock_shared();
+  return true;
+}
+
+void dl_resume_shared() {
+  dl_lock_shared();
+}
+
+// Errors are copied from a shared holder's buffer into the thread's dlerror() buffer.
+static_assert(ScopedDlSharedLock::kErrorBufferSize == __BIONIC_DLERROR_BUFFER_SIZE);
+
+char* dl_set_shared_error_buffer(char* buffer) {
+  pthread_internal_t* thread = __get_thread();
+  char* old_buffer = thread->dl_shared_error_buffer;
+  thread->dl_shared_error_buffer = buffer;
+  return old_buffer;
+}
+
+bool dl_lock_has_shared_holders() {
+  return g_dl_shared_count.load(std::memory_order_relaxed) != 0;
+}
 
 static char* __bionic_set_dlerror(char* new_value) {
   char* old_value = __get_thread()->current_dlerror;
@@ -124,12 +266,12 @@ char* __loader_dlerror() {
 }
 
 void __loader_android_get_LD_LIBRARY_PATH(char* buffer, size_t buffer_size) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlSharedLock locker;
   do_android_get_LD_LIBRARY_PATH(buffer, buffer_size);
 }
 
 void __loader_android_update_LD_LIBRARY_PATH(const char* ld_library_path) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlExclusiveLock locker;
   do_android_update_LD_LIBRARY_PATH(ld_library_path);
 }
 
@@ -137,7 +279,7 @@ static void* dlopen_ext(const char* filename,
                         int flags,
                         const android_dlextinfo* extinfo,
                         const void* caller_addr) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlExclusiveLock locker;
   g_linker_logger.ResetState();
   void* result = do_dlopen(filename, flags, extinfo, caller_addr);
   if (result == nullptr) {
@@ -158,9 +300,38 @@ void* __loader_dlopen(const char* filename, int flags, const void* caller_addr)
   return dlopen_ext(filename, flags, nullptr, caller_addr);
 }
 
+android_dlopen_async_request* __loader_android_dlopen_async(const char* filename,
+                                                            int flags,
+                                                            const android_dlextinfo* extinfo,
+                                                            int notify_fd,
+                                                            const void* caller_addr) {
+  // Deliberately doesn't take the loader lock, which a load in progress holds.
+  const char* error = nullptr;
+  android_dlopen_async_request* request =
+      dlopen_async_start(filename, flags, extinfo, notify_fd, caller_addr, &error);
+  if (request == nullptr) {
+    __bionic_format_dlerror("android_dlopen_async failed", error);
+  }
+  return request;
+}
+
+bool __loader_android_dlopen_async_is_done(android_dlopen_async_request* request) {
+  return dlopen_async_is_done(request);
+}
+
+void* __loader_android_dlopen_async_wait(android_dlopen_async_request* request) {
+  char error[__BIONIC_DLERROR_BUFFER_SIZE];
+  void* handle = dlopen_async_wait(request, error, sizeof(error));
+  if (handle == nullptr) {
+    __bionic_format_dlerror("dlopen failed", error);
+  }
+  return handle;
+}
+
 void* dlsym_impl(void* handle, const char* symbol, const char* version, const void* caller_addr) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
-  g_linker_logger.ResetState();
+  ScopedDlSharedLock locker;
+  // The logger's state is refreshed by the exclusive entry points (dlopen etc.): ResetState()
+  // isn't safe to call concurrently.
   void* result;
   if (!do_dlsym(handle, symbol, version, caller_addr, &result)) {
     __bionic_format_dlerror(linker_get_error_buffer(), nullptr);
@@ -178,13 +349,26 @@ void* __loader_dlvsym(void* handle, const char* symbol, const char* version, con
   return dlsym_impl(handle, symbol, version, caller_addr);
 }
 
+size_t __loader_android_dlsym_batch(void* handle,
+                                    const char* const* symbols,
+                                    void** addresses,
+                                    size_t count,
+                                    const void* caller_addr) {
+  ScopedDlSharedLock locker;
+  size_t resolved = do_dlsym_batch(handle, symbols, addresses, count, caller_addr);
+  if (resolved != count) {
+    __bionic_format_dlerror(linker_get_error_buffer(), nullptr);
+  }
+  return resolved;
+}
+
 int __loader_dladdr(const void* addr, Dl_info* info) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlSharedLock locker;
   return do_dladdr(addr, info);
 }
 
 int __loader_dlclose(void* handle) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlExclusiveLock locker;
   int result = do_dlclose(handle);
   if (result != 0) {
     __bionic_format_dlerror("dlclose failed", linker_get_error_buffer());
@@ -193,20 +377,27 @@ int __loader_dlclose(void* handle) {
 }
 
 int __loader_dl_iterate_phdr(int (*cb)(dl_phdr_info* info, size_t size, void* data), void* data) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  // Every unwinder calls this, so it doesn't take the lock at all unless this thread already
+  // holds it (a constructor that throws, say). Then the snapshot may be out of date, and the
+  // live list is safe to walk.
+  int result;
+  if (!dl_lock_is_held_exclusively() && do_dl_iterate_phdr_snapshot(cb, data, &result)) {
+    return result;
+  }
+  ScopedDlExclusiveLock locker;
   return do_dl_iterate_phdr(cb, data);
 }
 
 #if defined(__arm__)
 _Unwind_Ptr __loader_dl_unwind_find_exidx(_Unwind_Ptr pc, int* pcount) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlSharedLock locker;
   return do_dl_unwind_find_exidx(pc, pcount);
 }
 #endif
 
 void __loader_android_set_application_target_sdk_version(int target) {
   // lock to avoid modification in the middle of dlopen.
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlExclusiveLock locker;
   set_application_target_sdk_version(target);
 }
 
@@ -215,13 +406,13 @@ int __loader_android_get_application_target_sdk_version() {
 }
 
 void __loader_android_dlwarning(void* obj, void (*f)(void*, const char*)) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlExclusiveLock locker;
   get_dlwarning(obj, f);
 }
 
 bool __loader_android_init_anonymous_namespace(const char* shared_libs_sonames,
                                                const char* library_search_path) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlExclusiveLock locker;
   bool success = init_anonymous_namespace(shared_libs_sonames, library_search_path);
   if (!success) {
     __bionic_format_dlerror("android_init_anonymous_namespace failed", linker_get_error_buffer());
@@ -237,7 +428,7 @@ android_namespace_t* __loader_android_create_namespace(const char* name,
                                                 const char* permitted_when_isolated_path,
                                                 android_namespace_t* parent_namespace,
                                                 const void* caller_addr) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlExclusiveLock locker;
 
   android_namespace_t* result = create_namespace(caller_addr,
                                                  name,
@@ -257,7 +448,7 @@ android_namespace_t* __loader_android_create_namespace(const char* name,
 bool __loader_android_link_namespaces(android_namespace_t* namespace_from,
                                       android_namespace_t* namespace_to,
                                       const char* shared_libs_sonames) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlExclusiveLock locker;
 
   bool success = link_namespaces(namespace_from, namespace_to, shared_libs_sonames);
 
@@ -270,7 +461,7 @@ bool __loader_android_link_namespaces(android_namespace_t* namespace_from,
 
 bool __loader_android_link_namespaces_all_libs(android_namespace_t* namespace_from,
                                                android_namespace_t* namespace_to) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlExclusiveLock locker;
 
   bool success = link_namespaces_all_libs(namespace_from, namespace_to);
 
@@ -282,22 +473,78 @@ bool __loader_android_link_namespaces_all_libs(android_namespace_t* namespace_fr
 }
 
 android_namespace_t* __loader_android_get_exported_namespace(const char* name) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlSharedLock locker;
   return get_exported_namespace(name);
 }
 
+void __loader_android_dl_set_load_timeline_enabled(bool enabled) {
+  load_timeline_set_enabled(enabled);
+}
+
+int __loader_android_dl_iterate_load_timeline(
+    int (*cb)(const android_dl_load_phase_info* info, void* data), void* data) {
+  // Copying the timeline allocates.
+  ScopedDlExclusiveLock locker;
+  return load_timeline_iterate(cb, data);
+}
+
+void __loader_android_dl_set_reloc_stats_enabled(bool enabled) {
+  ScopedDlExclusiveLock locker;
+  reloc_stats_set_enabled(enabled);
+}
+
+bool __loader_android_dl_get_reloc_stats(void* handle, android_dl_reloc_stats* stats) {
+  ScopedDlExclusiveLock locker;
+
+  bool success = do_dl_get_reloc_stats(handle, stats);
+
+  if (!success) {
+    __bionic_format_dlerror("android_dl_get_reloc_stats failed", linker_get_error_buffer());
+  }
+
+  return success;
+}
+
+void __loader_android_dl_set_reservation_pool_limits(size_t max_regions, size_t max_bytes) {
+  ScopedDlExclusiveLock locker;
+  reservation_pool_set_limits(max_regions, max_bytes);
+}
+
+void __loader_android_dl_get_reservation_pool_stats(android_dl_reservation_pool_stats* stats) {
+  ScopedDlExclusiveLock locker;
+  reservation_pool_get_stats(stats);
+}
+
+void __loader_android_dl_set_eager_dynamic_tls(bool enabled) {
+  linker_set_eager_dynamic_tls(enabled);
+}
+
+void __loader_android_dl_get_tls_stats(android_dl_tls_stats* stats) {
+  linker_get_tls_stats(stats);
+}
+
+void __loader_android_dl_set_zip_archive_cache_limits(size_t max_archives, size_t max_bytes) {
+  ScopedDlExclusiveLock locker;
+  ZipArchiveCache::get().set_limits(max_archives, max_bytes);
+}
+
+void __loader_android_dl_get_zip_archive_cache_stats(android_dl_zip_archive_cache_stats* stats) {
+  ScopedDlExclusiveLock locker;
+  ZipArchiveCache::get().get_stats(stats);
+}
+
 void __loader_cfi_fail(uint64_t CallSiteTypeId, void* Ptr, void *DiagData, void *CallerPc) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlExclusiveLock locker;
   CFIShadowWriter::CfiFail(CallSiteTypeId, Ptr, DiagData, CallerPc);
 }
 
 void __loader_add_thread_local_dtor(void* dso_handle) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlExclusiveLock locker;
   increment_dso_handle_reference_counter(dso_handle);
 }
 
 void __loader_remove_thread_local_dtor(void* dso_handle) {
-  ScopedPthreadMutexLocker locker(&g_dl_mutex);
+  ScopedDlExclusiveLock locker;
   decrement_dso_handle_reference_counter(dso_handle);
 }
 
@@ -34,7 +34,21 @@ extern "C" void __internal_linker_error() {
 
 __strong_alias(__loader_android_create_namespace, __internal_linker_error);
 __strong_alias(__loader_android_dlopen_ext, __internal_linker_error);
+__strong_alias(__loader_android_dlopen_async, __internal_linker_error);
+__strong_alias(__loader_android_dlopen_async_is_done, __internal_linker_error);
+__strong_alias(__loader_android_dlopen_async_wait, __internal_linker_error);
 __strong_alias(__loader_android_dlwarning, __internal_linker_error);
+__strong_alias(__loader_android_dlsym_batch, __internal_linker_error);
+__strong_alias(__loader_android_dl_iterate_load_timeline, __internal_linker_error);
+__strong_alias(__loader_android_dl_set_load_timeline_enabled, __internal_linker_error);
+__strong_alias(__loader_android_dl_get_reloc_stats, __internal_linker_error);
+__strong_alias(__loader_android_dl_set_reloc_stats_enabled, __internal_linker_error);
+__strong_alias(__loader_android_dl_get_reservation_pool_stats, __internal_linker_error);
+__strong_alias(__loader_android_dl_set_reservation_pool_limits, __internal_linker_error);
+__strong_alias(__loader_android_dl_get_tls_stats, __internal_linker_error);
+__strong_alias(__loader_android_dl_set_eager_dynamic_tls, __internal_linker_error);
+__strong_alias(__loader_android_dl_get_zip_archive_cache_stats, __internal_linker_error);
+__strong_alias(__loader_android_dl_set_zip_archive_cache_limits, __internal_linker_error);
 __strong_alias(__loader_android_get_application_target_sdk_version, __internal_linker_error);
 __strong_alias(__loader_android_get_LD_LIBRARY_PATH, __internal_linker_error);
 __strong_alias(__loader_android_get_exported_namespace, __internal_linker_error);
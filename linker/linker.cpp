@@ -41,6 +41,8 @@
 #include <sys/vfs.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <iterator>
 #include <new>
 #include <string>
@@ -55,21 +57,29 @@
 // Private C library headers.
 
 #include "linker.h"
+#include "linker_address_index.h"
 #include "linker_block_allocator.h"
 #include "linker_cfi.h"
 #include "linker_config.h"
+#include "linker_directory_index.h"
 #include "linker_gdb_support.h"
 #include "linker_globals.h"
 #include "linker_debug.h"
 #include "linker_dlwarning.h"
+#include "linker_load_timeline.h"
 #include "linker_main.h"
 #include "linker_namespaces.h"
+#include "linker_parallel_link.h"
 #include "linker_sleb128.h"
 #include "linker_phdr.h"
+#include "linker_reader_epoch.h"
 #include "linker_relocate.h"
+#include "linker_relro_cache.h"
+#include "linker_reservation_pool.h"
 #include "linker_tls.h"
 #include "linker_translate_path.h"
 #include "linker_utils.h"
+#include "linker_zip_archive_cache.h"
 
 #include "android-base/macros.h"
 #include "android-base/stringprintf.h"
@@ -77,6 +87,7 @@
 #include "private/bionic_asm_note.h"
 #include "private/bionic_call_ifunc_resolver.h"
 #include "private/bionic_globals.h"
+#include "private/ScopedRWLock.h"
 #include "ziparchive/zip_archive.h"
 
 static std::unordered_map<void*, size_t> g_dso_handle_counters;
@@ -94,6 +105,11 @@ static LinkerTypeAllocator<LinkedListEntry<android_namespace_t>> g_namespace_lis
 static uint64_t g_module_load_counter = 0;
 static uint64_t g_module_unload_counter = 0;
 
+// Set when the soinfo list changes, so the dl_iterate_phdr() snapshot is rebuilt. Readers of the
+// snapshot are tracked by g_phdr_snapshot_epoch, which also defers freeing unloaded libraries.
+static bool g_phdr_snapshot_stale = true;
+static ReaderEpoch g_phdr_snapshot_epoch;
+
 static const char* const kLdConfigArchFilePath = "/system/etc/ld.config." ABI_STRING ".txt";
 
 static const char* const kLdConfigFilePath = "/system/etc/ld.config.txt";
@@ -212,7 +228,7 @@ static std::string resolve_soname(const std::string& name) {
 static bool maybe_accessible_via_namespace_links(android_namespace_t* ns, const char* name) {
   std::string soname = resolve_soname(name);
   for (auto& ns_link : ns->linked_namespaces()) {
-    if (ns_link.is_accessible(soname.c_str())) {
+    if (ns_link.is_accessible(soname)) {
       return true;
     }
   }
@@ -223,6 +239,7 @@ static bool maybe_accessible_via_namespace_links(android_namespace_t* ns, const
 // TODO(dimitry): The exempt-list is a workaround for http://b/26394120 ---
 // gradually remove libraries from this list until it is gone.
 static bool is_exempt_lib(android_namespace_t* ns, const char* name, const soinfo* needed_by) {
+  // Sorted, for binary search.
   static const char* const kLibraryExemptList[] = {
     "libandroid_runtime.so",
     "libbinder.so",
@@ -232,12 +249,11 @@ static bool is_exempt_lib(android_namespace_t* ns, const char* name, const soinf
     "libgui.so",
     "libmedia.so",
     "libnativehelper.so",
+    "libsqlite.so",
     "libssl.so",
     "libstagefright.so",
-    "libsqlite.so",
     "libui.so",
     "libutils.so",
-    nullptr
   };
 
   // If you're targeting N, you don't get the exempt-list.
@@ -258,13 +274,8 @@ static bool is_exempt_lib(android_namespace_t* ns, const char* name, const soinf
     name = basename(name);
   }
 
-  for (size_t i = 0; kLibraryExemptList[i] != nullptr; ++i) {
-    if (strcmp(name, kLibraryExemptList[i]) == 0) {
-      return true;
-    }
-  }
-
-  return false;
+  return std::binary_search(std::begin(kLibraryExemptList), std::end(kLibraryExemptList), name,
+                            [](const char* a, const char* b) { return strcmp(a, b) < 0; });
 }
 // END OF WORKAROUND
 
@@ -322,6 +333,7 @@ soinfo* soinfo_alloc(android_namespace_t* ns, const char* name,
                                                        file_offset, rtld_flags);
 
   solist_add_soinfo(si);
+  g_phdr_snapshot_stale = true;
 
   si->generate_handle();
   ns->add_soinfo(si);
@@ -330,14 +342,25 @@ soinfo* soinfo_alloc(android_namespace_t* ns, const char* name,
   return si;
 }
 
-static void soinfo_free(soinfo* si) {
-  if (si == nullptr) {
-    return;
+static void soinfo_release(void* arg) {
+  soinfo* si = static_cast<soinfo*>(arg);
+  ProtectedDataGuard guard;
+
+  void* gap_start = nullptr;
+  size_t gap_size = 0;
+  if (si->has_min_version(6)) {
+    gap_start = reinterpret_cast<void*>(si->get_gap_start());
+    gap_size = si->get_gap_size();
   }
 
   if (si->base != 0 && si->size != 0) {
     if (!si->is_mapped_by_caller()) {
-      munmap(reinterpret_cast<void*>(si->base), si->size);
+      if (reservation_pool_put(reinterpret_cast<void*>(si->base), si->size, gap_start, gap_size)) {
+        // The pool now owns the gap too.
+        gap_size = 0;
+      } else {
+        munmap(reinterpret_cast<void*>(si->base), si->size);
+      }
     } else {
       // remap the region as PROT_NONE, MAP_ANONYMOUS | MAP_NORESERVE
       mmap(reinterpret_cast<void*>(si->base), si->size, PROT_NONE,
@@ -345,8 +368,19 @@ static void soinfo_free(soinfo* si) {
     }
   }
 
-  if (si->has_min_version(6) && si->get_gap_size()) {
-    munmap(reinterpret_cast<void*>(si->get_gap_start()), si->get_gap_size());
+  if (gap_size != 0) {
+    munmap(gap_start, gap_size);
+  }
+
+  TRACE("name %s: releasing soinfo @ %p", si->get_realpath(), si);
+
+  si->~soinfo();
+  g_soinfo_allocator.free(si);
+}
+
+static void soinfo_free(soinfo* si) {
+  if (si == nullptr) {
+    return;
   }
 
   TRACE("name %s: freeing soinfo @ %p", si->get_realpath(), si);
@@ -358,8 +392,10 @@ static void soinfo_free(soinfo* si) {
   // clear links to/from si
   si->remove_all_links();
 
-  si->~soinfo();
-  g_soinfo_allocator.free(si);
+  // dl_iterate_phdr() readers may still be looking at the published snapshot that lists `si`, so
+  // the mapping and the soinfo itself stay around until they're done.
+  g_phdr_snapshot_stale = true;
+  g_phdr_snapshot_epoch.retire(soinfo_release, si);
 }
 
 static void parse_path(const char* path, const char* delimiters,
@@ -461,6 +497,127 @@ int do_dl_iterate_phdr(int (*cb)(dl_phdr_info* info, size_t size, void* data), v
   return rv;
 }
 
+namespace {
+
+// An immutable copy of the fields of the loaded libraries that dl_iterate_phdr() reports.
+struct PhdrSnapshot {
+  struct Entry {
+    ElfW(Addr) addr;
+    const char* name;
+    const ElfW(Phdr)* phdr;
+    ElfW(Half) phnum;
+    // Only set for libraries with a PT_TLS segment, whose TLS block is looked up per thread.
+    soinfo* tls_si;
+  };
+
+  uint64_t adds;
+  uint64_t subs;
+  std::vector<Entry> entries;
+};
+
+}  // anonymous namespace
+
+static std::atomic<PhdrSnapshot*> g_phdr_snapshot(nullptr);
+
+static void release_phdr_snapshot(void* arg) {
+  delete static_cast<PhdrSnapshot*>(arg);
+}
+
+static void update_phdr_snapshot() {
+  PhdrSnapshot* old_snapshot = g_phdr_snapshot.load(std::memory_order_relaxed);
+  if (old_snapshot != nullptr && !g_phdr_snapshot_stale &&
+      old_snapshot->adds == g_module_load_counter &&
+      old_snapshot->subs == g_module_unload_counter) {
+    return;
+  }
+
+  PhdrSnapshot* snapshot = new PhdrSnapshot;
+  snapshot->adds = g_module_load_counter;
+  snapshot->subs = g_module_unload_counter;
+  for (soinfo* si = solist_get_head(); si != nullptr; si = si->next) {
+    snapshot->entries.push_back({si->link_map_head.l_addr, si->link_map_head.l_name, si->phdr,
+                                 static_cast<ElfW(Half)>(si->phnum),
+                                 si->get_tls() != nullptr ? si : nullptr});
+  }
+
+  g_phdr_snapshot.store(snapshot);
+  g_phdr_snapshot_stale = false;
+  if (old_snapshot != nullptr) {
+    g_phdr_snapshot_epoch.retire(release_phdr_snapshot, old_snapshot);
+  }
+}
+
+bool do_dl_iterate_phdr_snapshot(int (*cb)(dl_phdr_info* info, size_t size, void* data),
+                                 void* data, int* result) {
+  pthread_internal_t* thread = __get_thread();
+  uint64_t token = g_phdr_snapshot_epoch.enter();
+  ++thread->dl_phdr_snapshot_readers[token & 1];
+  const PhdrSnapshot* snapshot = g_phdr_snapshot.load();
+  if (snapshot == nullptr) {
+    --thread->dl_phdr_snapshot_readers[token & 1];
+    g_phdr_snapshot_epoch.exit(token);
+    return false;
+  }
+
+  int rv = 0;
+  for (const PhdrSnapshot::Entry& entry : snapshot->entries) {
+    dl_phdr_info dl_info;
+    dl_info.dlpi_addr = entry.addr;
+    dl_info.dlpi_name = entry.name;
+    dl_info.dlpi_phdr = entry.phdr;
+    dl_info.dlpi_phnum = entry.phnum;
+    dl_info.dlpi_adds = snapshot->adds;
+    dl_info.dlpi_subs = snapshot->subs;
+    dl_info.dlpi_tls_modid = 0;
+    dl_info.dlpi_tls_data = nullptr;
+    if (entry.tls_si != nullptr) {
+      // The module table can be resized by a concurrent dlopen(), and the module of a library
+      // that's being unloaded is unregistered before the library is released.
+      ScopedReadLock locker(&__libc_shared_globals()->tls_modules.rwlock);
+      soinfo_tls* tls_module = entry.tls_si->get_tls();
+      if (tls_module->module_id != kTlsUninitializedModuleId) {
+        dl_info.dlpi_tls_modid = tls_module->module_id;
+        dl_info.dlpi_tls_data = get_tls_block_for_this_thread(tls_module, /*should_alloc=*/false);
+      }
+    }
+
+    rv = cb(&dl_info, sizeof(dl_phdr_info), data);
+    if (rv != 0) {
+      break;
+    }
+  }
+
+  --thread->dl_phdr_snapshot_readers[token & 1];
+  g_phdr_snapshot_epoch.exit(token);
+  *result = rv;
+  return true;
+}
+
+// Any thread may be inside dl_iterate_phdr() when another forks, but only the forking thread
+// continues in the child.
+static void phdr_snapshot_after_fork_in_child() {
+  g_phdr_snapshot_epoch.reset_readers_after_fork(__get_thread()->dl_phdr_snapshot_readers);
+}
+
+static bool g_phdr_snapshot_fork_handler_registered = false;
+
+void update_loader_snapshots() {
+  get_address_index().update();
+  update_phdr_snapshot();
+
+  // libc.so can only register the handler once it's initialized, which is before the lock is first
+  // released after the executable's constructors have run.
+  if (!g_phdr_snapshot_fork_handler_registered) {
+    auto pthread_atfork_hook = __libc_shared_globals()->pthread_atfork_hook;
+    if (pthread_atfork_hook != nullptr &&
+        pthread_atfork_hook(nullptr, nullptr, phdr_snapshot_after_fork_in_child) == 0) {
+      g_phdr_snapshot_fork_handler_registered = true;
+    }
+  }
+
+  g_phdr_snapshot_epoch.reclaim();
+}
+
 ProtectedDataGuard::ProtectedDataGuard() {
   if (ref_count_++ == 0) {
     protect_data(PROT_READ | PROT_WRITE);
@@ -640,6 +797,7 @@ class LoadTask {
     si_->set_gap_start(elf_reader.gap_start());
     si_->set_gap_size(elf_reader.gap_size());
     si_->set_should_pad_segments(elf_reader.should_pad_segments());
+    get_address_index().invalidate();
 
     return true;
   }
@@ -680,7 +838,6 @@ LoadTask::deleter_t LoadTask::deleter;
 template <typename T>
 using linked_list_t = LinkedList<T, TypeBasedAllocator<LinkedListEntry<T>>>;
 
-typedef linked_list_t<soinfo> SoinfoLinkedList;
 typedef linked_list_t<const char> StringLinkedList;
 typedef std::vector<LoadTask*> LoadTaskList;
 
@@ -699,16 +856,19 @@ enum walk_action_result_t : uint32_t {
 //
 // walk_dependencies_tree returns false if walk was terminated
 // by the action and true otherwise.
+//
+// This runs under a shared loader lock for dlsym(), so it keeps its lists on the linker heap
+// (which is locked then) rather than in the unsynchronized block allocators.
 template<typename F>
 static bool walk_dependencies_tree(soinfo* root_soinfo, F action) {
-  SoinfoLinkedList visit_list;
-  SoinfoLinkedList visited;
+  std::vector<soinfo*> visit_list;
+  std::vector<soinfo*> visited;
 
   visit_list.push_back(root_soinfo);
 
-  soinfo* si;
-  while ((si = visit_list.pop_front()) != nullptr) {
-    if (visited.contains(si)) {
+  for (size_t i = 0; i < visit_list.size(); ++i) {
+    soinfo* si = visit_list[i];
+    if (std::find(visited.begin(), visited.end(), si) != visited.end()) {
       continue;
     }
 
@@ -853,65 +1013,7 @@ static const ElfW(Sym)* dlsym_handle_lookup(soinfo* si,
 soinfo* find_containing_library(const void* p) {
   // Addresses within a library may be tagged if they point to globals. Untag
   // them so that the bounds check succeeds.
-  ElfW(Addr) address = reinterpret_cast<ElfW(Addr)>(untag_address(p));
-  for (soinfo* si = solist_get_head(); si != nullptr; si = si->next) {
-    if (address < si->base || address - si->base >= si->size) {
-      continue;
-    }
-    ElfW(Addr) vaddr = address - si->load_bias;
-    for (size_t i = 0; i != si->phnum; ++i) {
-      const ElfW(Phdr)* phdr = &si->phdr[i];
-      if (phdr->p_type != PT_LOAD) {
-        continue;
-      }
-      if (vaddr >= phdr->p_vaddr && vaddr < phdr->p_vaddr + phdr->p_memsz) {
-        return si;
-      }
-    }
-  }
-  return nullptr;
-}
-
-class ZipArchiveCache {
- public:
-  ZipArchiveCache() {}
-  ~ZipArchiveCache();
-
-  bool get_or_open(const char* zip_path, ZipArchiveHandle* handle);
- private:
-  DISALLOW_COPY_AND_ASSIGN(ZipArchiveCache);
-
-  std::unordered_map<std::string, ZipArchiveHandle> cache_;
-};
-
-bool ZipArchiveCache::get_or_open(const char* zip_path, ZipArchiveHandle* handle) {
-  std::string key(zip_path);
-
-  auto it = cache_.find(key);
-  if (it != cache_.end()) {
-    *handle = it->second;
-    return true;
-  }
-
-  int fd = TEMP_FAILURE_RETRY(open(zip_path, O_RDONLY | O_CLOEXEC));
-  if (fd == -1) {
-    return false;
-  }
-
-  if (OpenArchiveFd(fd, "", handle) != 0) {
-    // invalid zip-file (?)
-    CloseArchive(*handle);
-    return false;
-  }
-
-  cache_[key] = *handle;
-  return true;
-}
-
-ZipArchiveCache::~ZipArchiveCache() {
-  for (const auto& it : cache_) {
-    CloseArchive(it.second);
-  }
+  return get_address_index().find_library(reinterpret_cast<ElfW(Addr)>(untag_address(p)));
 }
 
 static int open_library_in_zipfile(ZipArchiveCache* zip_archive_cache,
@@ -950,7 +1052,7 @@ static int open_library_in_zipfile(ZipArchiveCache* zip_archive_cache,
   }
 
   ZipArchiveHandle handle;
-  if (!zip_archive_cache->get_or_open(zip_path, &handle)) {
+  if (!zip_archive_cache->get_or_open(zip_path, fd, &handle)) {
     // invalid zip-file (?)
     close(fd);
     return -1;
@@ -1024,7 +1126,12 @@ static int open_library_on_paths(ZipArchiveCache* zip_archive_cache,
                                  const char* name, off64_t* file_offset,
                                  const std::vector<std::string>& paths,
                                  std::string* realpath) {
+  DirectoryIndex& directory_index = get_directory_index();
   for (const auto& path : paths) {
+    if (!directory_index.may_contain(path, name)) {
+      continue;
+    }
+
     char buf[512];
     if (!format_path(buf, sizeof(buf), path.c_str(), name)) {
       continue;
@@ -1073,8 +1180,7 @@ static int open_library(android_namespace_t* ns,
 }
 
 int open_executable(const char* path, off64_t* file_offset, std::string* realpath) {
-  ZipArchiveCache zip_archive_cache;
-  return open_library_at_path(&zip_archive_cache, path, file_offset, realpath);
+  return open_library_at_path(&ZipArchiveCache::get(), path, file_offset, realpath);
 }
 
 const char* fix_dt_needed(const char* dt_needed, const char* sopath __unused) {
@@ -1268,7 +1374,10 @@ static bool load_library(android_namespace_t* ns,
   task->set_soinfo(si);
 
   // Read the ELF header and some of the segments.
-  if (!task->read(realpath.c_str(), file_stat.st_size)) {
+  LoadPhaseTimer read_timer;
+  bool read_ok = task->read(realpath.c_str(), file_stat.st_size);
+  read_timer.finish(realpath.c_str(), ANDROID_DL_LOAD_PHASE_READ);
+  if (!read_ok) {
     task->remove_cached_elf_reader();
     task->set_soinfo(nullptr);
     soinfo_free(si);
@@ -1351,6 +1460,7 @@ static bool load_library(android_namespace_t* ns,
   // Open the file.
   off64_t file_offset;
   std::string realpath;
+  LoadPhaseTimer open_timer;
   int fd = open_library(ns, zip_archive_cache, name, needed_by, &file_offset, &realpath);
   if (fd == -1) {
     if (task->is_dt_needed()) {
@@ -1366,6 +1476,8 @@ static bool load_library(android_namespace_t* ns,
     return false;
   }
 
+  open_timer.finish(realpath.c_str(), ANDROID_DL_LOAD_PHASE_OPEN);
+
   task->set_fd(fd, true);
   task->set_file_offset(file_offset);
 
@@ -1432,7 +1544,7 @@ static bool find_library_in_linked_namespace(const android_namespace_link_t& nam
     soname = resolve_soname(task->get_name());
   }
 
-  if (!namespace_link.is_accessible(soname.c_str())) {
+  if (!namespace_link.is_accessible(soname)) {
     // the library is not accessible via namespace_link
     LD_LOG(kLogDlopen,
            "find_library_in_linked_namespace(ns=%s, task=%s): Not accessible (soname=%s)",
@@ -1542,6 +1654,38 @@ static void shuffle(std::vector<LoadTask*>* v) {
   }
 }
 
+// Returns the local group rooted at `root`: the root and the dependencies reachable from it
+// that are accessible from the root's namespace.
+static soinfo_list_t get_local_group(soinfo* root) {
+  soinfo_list_t local_group;
+  android_namespace_t* local_group_ns = root->get_primary_namespace();
+
+  walk_dependencies_tree(root,
+    [&] (soinfo* si) {
+      if (local_group_ns->is_accessible(si)) {
+        local_group.push_back(si);
+        return kWalkContinue;
+      } else {
+        return kWalkSkip;
+      }
+    });
+
+  return local_group;
+}
+
+std::unique_ptr<SymbolLookupList> create_lookup_list_for(soinfo* si) {
+  soinfo* root = si->get_local_group_root();
+  soinfo_list_t local_group = get_local_group(root);
+  soinfo_list_t global_group = root->get_primary_namespace()->get_global_group();
+  std::unique_ptr<SymbolLookupList> lookup_list(new SymbolLookupList(global_group, local_group));
+  lookup_list->set_dt_symbolic_lib(si->has_DT_SYMBOLIC ? si : nullptr);
+  return lookup_list;
+}
+
+uint64_t get_module_generation() {
+  return g_module_load_counter + g_module_unload_counter;
+}
+
 // add_as_children - add first-level loaded libraries (i.e. library_names[], but
 // not their transitive dependencies) as children of the start_with library.
 // This is false when find_libraries is called for dlopen(), when newly loaded
@@ -1588,7 +1732,8 @@ bool find_libraries(android_namespace_t* ns,
     }
   });
 
-  ZipArchiveCache zip_archive_cache;
+  ZipArchiveCache& zip_archive_cache = ZipArchiveCache::get();
+  get_directory_index().begin_batch();
   soinfo_list_t new_global_group_members;
 
   // Step 1: expand the list of load_tasks to include
@@ -1774,23 +1919,46 @@ bool find_libraries(android_namespace_t* ns,
 
   // Step 6: Link all local groups
   for (auto root : local_group_roots) {
-    soinfo_list_t local_group;
+    soinfo_list_t local_group = get_local_group(root);
     android_namespace_t* local_group_ns = root->get_primary_namespace();
 
-    walk_dependencies_tree(root,
-      [&] (soinfo* si) {
-        if (local_group_ns->is_accessible(si)) {
-          local_group.push_back(si);
-          return kWalkContinue;
-        } else {
-          return kWalkSkip;
-        }
-      });
-
     soinfo_list_t global_group = local_group_ns->get_global_group();
     SymbolLookupList lookup_list(global_group, local_group);
     soinfo* local_group_root = local_group.front();
 
+    // Relocate the group on several threads if possible. RELRO sharing writes to (or compares
+    // against) a single file in order, so it's never done in parallel.
+    std::vector<soinfo*> unlinked_libs;
+    if (extinfo == nullptr ||
+        (extinfo->flags & (ANDROID_DLEXT_WRITE_RELRO | ANDROID_DLEXT_USE_RELRO)) == 0) {
+      local_group.for_each([&](soinfo* si) {
+        if (!si->is_linked() && si->get_primary_namespace() == local_group_ns &&
+            !si->is_image_linked()) {
+          unlinked_libs.push_back(si);
+        }
+      });
+    }
+    if (can_relocate_in_parallel(unlinked_libs)) {
+      for (soinfo* si : unlinked_libs) {
+        if (__libc_shared_globals()->load_hook) {
+          __libc_shared_globals()->load_hook(si->load_bias, si->phdr, si->phnum);
+        }
+      }
+      lookup_list.set_dt_symbolic_lib(nullptr);
+      lookup_list.set_lookup_cache_enabled(false);
+      size_t relocated = parallel_relocate_images(unlinked_libs, lookup_list, local_group_root);
+      for (size_t i = 0; i < relocated; ++i) {
+        unlinked_libs[i]->publish_image();
+        if (!get_cfi_shadow()->AfterLoad(unlinked_libs[i], solist_get_head())) {
+          return false;
+        }
+      }
+      if (relocated != unlinked_libs.size()) {
+        return false;
+      }
+      continue;
+    }
+
     bool linked = local_group.visit([&](soinfo* si) {
       // Even though local group may contain accessible soinfos from other namespaces
       // we should avoid linking them (because if they are not linked -> they
@@ -1843,6 +2011,10 @@ bool find_libraries(android_namespace_t* ns,
     }
   }
 
+  // Constructors run before the loader lock is released, and may start threads that unwind
+  // through the new libraries or look them up in dl_iterate_phdr(). Publish them now rather than
+  // when the lock is dropped.
+  update_loader_snapshots();
 
   return true;
 }
@@ -2260,7 +2432,7 @@ int do_dladdr(const void* addr, Dl_info* info) {
   info->dli_fbase = reinterpret_cast<void*>(si->base);
 
   // Determine if any symbol in the library contains the specified address.
-  ElfW(Sym)* sym = si->find_symbol_by_address(addr);
+  const ElfW(Sym)* sym = get_address_index().find_symbol(si, reinterpret_cast<ElfW(Addr)>(addr));
   if (sym != nullptr) {
     info->dli_sname = si->get_string(sym->st_name);
     info->dli_saddr = reinterpret_cast<void*>(si->resolve_symbol_address(sym));
@@ -2282,6 +2454,64 @@ static soinfo* soinfo_from_handle(void* handle) {
   return static_cast<soinfo*>(handle);
 }
 
+bool do_dl_get_reloc_stats(void* handle, android_dl_reloc_stats* stats) {
+  soinfo* si = soinfo_from_handle(handle);
+  if (si == nullptr) {
+    DL_ERR("invalid handle: %p", handle);
+    return false;
+  }
+
+  *stats = *si->reloc_stats();
+  return true;
+}
+
+// Version names are interned process-wide, when libraries are prelinked, into ids starting at 1.
+// The names are copied because the libraries that first used them may be unloaded.
+static std::unordered_map<std::string, uint32_t> g_version_ids;
+
+static uint32_t intern_version_name(const char* name) {
+  return g_version_ids.try_emplace(name, g_version_ids.size() + 1).first->second;
+}
+
+static uint32_t find_version_id(const char* name) {
+  auto it = g_version_ids.find(name);
+  return it != g_version_ids.end() ? it->second : 0;
+}
+
+// Returns in `symbol` what dlsym() returns for `sym`, found in `found`. Returns false, with the
+// error set, if `sym` is null or can't be returned.
+static bool get_dlsym_address(const char* sym_name, const char* sym_ver, const ElfW(Sym)* sym,
+                              soinfo* found, void** symbol) {
+  if (sym == nullptr) {
+    DL_SYM_ERR("undefined symbol: %s", symbol_display_name(sym_name, sym_ver).c_str());
+    return false;
+  }
+
+  uint32_t bind = ELF_ST_BIND(sym->st_info);
+  uint32_t type = ELF_ST_TYPE(sym->st_info);
+
+  if ((bind != STB_GLOBAL && bind != STB_WEAK) || sym->st_shndx == 0) {
+    DL_SYM_ERR("symbol \"%s\" found but not global", symbol_display_name(sym_name, sym_ver).c_str());
+    return false;
+  }
+
+  if (type == STT_TLS) {
+    // For a TLS symbol, dlsym returns the address of the current thread's
+    // copy of the symbol.
+    const soinfo_tls* tls_module = found->get_tls();
+    if (tls_module == nullptr) {
+      DL_SYM_ERR("TLS symbol \"%s\" in solib \"%s\" with no TLS segment",
+                 sym_name, found->get_realpath());
+      return false;
+    }
+    void* tls_block = get_tls_block_for_this_thread(tls_module, /*should_alloc=*/true);
+    *symbol = static_cast<char*>(tls_block) + sym->st_value;
+  } else {
+    *symbol = reinterpret_cast<void*>(found->resolve_symbol_address(sym));
+  }
+  return true;
+}
+
 bool do_dlsym(void* handle,
               const char* sym_name,
               const char* sym_ver,
@@ -2328,6 +2558,7 @@ bool do_dlsym(void* handle,
   if (sym_ver != nullptr) {
     vi_instance.name = sym_ver;
     vi_instance.elf_hash = calculate_elf_hash(sym_ver);
+    vi_instance.id = find_version_id(sym_ver);
     vi = &vi_instance;
   }
 
@@ -2341,38 +2572,85 @@ bool do_dlsym(void* handle,
     sym = dlsym_handle_lookup(si, &found, sym_name, vi);
   }
 
-  if (sym != nullptr) {
-    uint32_t bind = ELF_ST_BIND(sym->st_info);
-    uint32_t type = ELF_ST_TYPE(sym->st_info);
-
-    if ((bind == STB_GLOBAL || bind == STB_WEAK) && sym->st_shndx != 0) {
-      if (type == STT_TLS) {
-        // For a TLS symbol, dlsym returns the address of the current thread's
-        // copy of the symbol.
-        const soinfo_tls* tls_module = found->get_tls();
-        if (tls_module == nullptr) {
-          DL_SYM_ERR("TLS symbol \"%s\" in solib \"%s\" with no TLS segment",
-                     sym_name, found->get_realpath());
-          return false;
-        }
-        void* tls_block = get_tls_block_for_this_thread(tls_module, /*should_alloc=*/true);
-        *symbol = static_cast<char*>(tls_block) + sym->st_value;
+  if (!get_dlsym_address(sym_name, sym_ver, sym, found, symbol)) {
+    return false;
+  }
+
+  failure_guard.Disable();
+  LD_LOG(kLogDlsym,
+         "... dlsym successful: sym_name=\"%s\", sym_ver=\"%s\", found in=\"%s\", address=%p",
+         sym_name, sym_ver, found->get_soname(), *symbol);
+  return true;
+}
+
+size_t do_dlsym_batch(void* handle,
+                      const char* const* sym_names,
+                      void** symbols,
+                      size_t count,
+                      const void* caller_addr) {
+  ScopedTrace trace("dlsym batch");
+  soinfo* si = nullptr;
+  if (handle != RTLD_DEFAULT && handle != RTLD_NEXT) {
+    si = soinfo_from_handle(handle);
+  }
+
+  size_t resolved = 0;
+
+  // RTLD_DEFAULT, RTLD_NEXT, and the main executable search the caller's namespace rather than a
+  // dependency tree, and an invalid handle needs reporting for each symbol: look those up one by
+  // one.
+  if (si == nullptr || si == solist_get_somain()) {
+    for (size_t i = 0; i < count; ++i) {
+      if (do_dlsym(handle, sym_names[i], nullptr, caller_addr, &symbols[i])) {
+        ++resolved;
       } else {
-        *symbol = reinterpret_cast<void*>(found->resolve_symbol_address(sym));
+        symbols[i] = nullptr;
       }
-      failure_guard.Disable();
-      LD_LOG(kLogDlsym,
-             "... dlsym successful: sym_name=\"%s\", sym_ver=\"%s\", found in=\"%s\", address=%p",
-             sym_name, sym_ver, found->get_soname(), *symbol);
-      return true;
     }
+    return resolved;
+  }
 
-    DL_SYM_ERR("symbol \"%s\" found but not global", symbol_display_name(sym_name, sym_ver).c_str());
-    return false;
+  LD_LOG(kLogDlsym, "dlsym_batch(handle=%p(\"%s\"), count=%zu) ...",
+         handle, si->get_realpath(), count);
+
+  // Walk the dependency tree once, in the order dlsym_handle_lookup() searches it, rather than
+  // once per symbol.
+  android_namespace_t* ns = si->get_primary_namespace();
+  std::vector<soinfo*> search_list;
+  walk_dependencies_tree(si, [&](soinfo* current_soinfo) {
+    if (!ns->is_accessible(current_soinfo)) {
+      return kWalkSkip;
+    }
+    search_list.push_back(current_soinfo);
+    return kWalkContinue;
+  });
+
+  for (size_t i = 0; i < count; ++i) {
+    symbols[i] = nullptr;
+    const char* sym_name = sym_names[i];
+    if (sym_name == nullptr) {
+      DL_SYM_ERR("dlsym failed: symbol name is null");
+      continue;
+    }
+
+    SymbolName symbol_name(sym_name);
+    const ElfW(Sym)* sym = nullptr;
+    soinfo* found = nullptr;
+    for (soinfo* lib : search_list) {
+      sym = lib->find_symbol_by_name(symbol_name, nullptr);
+      if (sym != nullptr) {
+        found = lib;
+        break;
+      }
+    }
+
+    if (get_dlsym_address(sym_name, nullptr, sym, found, &symbols[i])) {
+      ++resolved;
+    }
   }
 
-  DL_SYM_ERR("undefined symbol: %s", symbol_display_name(sym_name, sym_ver).c_str());
-  return false;
+  LD_LOG(kLogDlsym, "... dlsym_batch resolved %zu of %zu", resolved, count);
+  return resolved;
 }
 
 int do_dlclose(void* handle) {
@@ -2495,6 +2773,8 @@ android_namespace_t* create_namespace(const void* caller_addr,
   ns->set_isolated((type & ANDROID_NAMESPACE_TYPE_ISOLATED) != 0);
   ns->set_exempt_list_enabled((type & ANDROID_NAMESPACE_TYPE_EXEMPT_LIST_ENABLED) != 0);
   ns->set_also_used_as_anonymous((type & ANDROID_NAMESPACE_TYPE_ALSO_USED_AS_ANONYMOUS) != 0);
+  ns->set_lazy_binding_enabled((type & ANDROID_NAMESPACE_TYPE_LAZY_BINDING) != 0);
+  ns->set_hugepage_text_enabled((type & ANDROID_NAMESPACE_TYPE_HUGEPAGE_TEXT) != 0);
 
   if ((type & ANDROID_NAMESPACE_TYPE_SHARED) != 0) {
     // append parent namespace paths.
@@ -2558,8 +2838,8 @@ bool link_namespaces(android_namespace_t* namespace_from,
   }
 
   std::vector<std::string> sonames = android::base::Split(shared_lib_sonames, ":");
-  std::unordered_set<std::string> sonames_set(std::make_move_iterator(sonames.begin()),
-                                              std::make_move_iterator(sonames.end()));
+  soname_set_t sonames_set(std::make_move_iterator(sonames.begin()),
+                           std::make_move_iterator(sonames.end()));
 
   ProtectedDataGuard guard;
   namespace_from->add_linked_namespace(namespace_to, std::move(sonames_set), false);
@@ -2580,7 +2860,7 @@ bool link_namespaces_all_libs(android_namespace_t* namespace_from,
   }
 
   ProtectedDataGuard guard;
-  namespace_from->add_linked_namespace(namespace_to, std::unordered_set<std::string>(), true);
+  namespace_from->add_linked_namespace(namespace_to, soname_set_t(), true);
 
   return true;
 }
@@ -2588,6 +2868,10 @@ bool link_namespaces_all_libs(android_namespace_t* namespace_from,
 ElfW(Addr) call_ifunc_resolver(ElfW(Addr) resolver_addr) {
   if (g_is_ldd) return 0;
 
+  // dlsym(), dladdr() and lazy binding hold the loader lock shared, and a resolver may call
+  // dlopen() or dlclose(). The library defining the resolver stays loaded because the caller
+  // holds a reference to it (a handle, or a library that depends on it).
+  ScopedDlSharedUnlock unlocker;
   ElfW(Addr) ifunc_addr = __bionic_call_ifunc_resolver(resolver_addr);
   TRACE_TYPE(RELO, "Called ifunc_resolver@%p. The result is %p",
       reinterpret_cast<void *>(resolver_addr), reinterpret_cast<void*>(ifunc_addr));
@@ -2608,7 +2892,8 @@ const version_info* VersionTracker::get_version_info(ElfW(Versym) source_symver)
 void VersionTracker::add_version_info(size_t source_index,
                                       ElfW(Word) elf_hash,
                                       const char* ver_name,
-                                      const soinfo* target_si) {
+                                      const soinfo* target_si,
+                                      uint32_t id) {
   if (source_index >= version_infos.size()) {
     version_infos.resize(source_index+1);
   }
@@ -2616,6 +2901,7 @@ void VersionTracker::add_version_info(size_t source_index,
   version_infos[source_index].elf_hash = elf_hash;
   version_infos[source_index].name = ver_name;
   version_infos[source_index].target_si = target_si;
+  version_infos[source_index].id = id;
 }
 
 bool VersionTracker::init_verneed(const soinfo* si_from) {
@@ -2656,7 +2942,8 @@ bool VersionTracker::init_verneed(const soinfo* si_from) {
       const char* ver_name = si_from->get_string(vernaux->vna_name);
       ElfW(Half) source_index = vernaux->vna_other;
 
-      add_version_info(source_index, elf_hash, ver_name, target_si);
+      add_version_info(source_index, elf_hash, ver_name, target_si,
+                       si_from->get_version_id(source_index));
     }
   }
 
@@ -2711,11 +2998,61 @@ static bool for_each_verdef(const soinfo* si, F functor) {
   return true;
 }
 
+void soinfo::init_version_ids() {
+  if (!has_min_version(2)) {
+    return;
+  }
+
+  auto set_version_id = [this](size_t index, uint32_t id) {
+    if (index >= version_ids_.size()) {
+      version_ids_.resize(index + 1);
+    }
+    version_ids_[index] = id;
+  };
+
+  // prelink_image has already validated the verdef section.
+  for_each_verdef(this,
+    [&](size_t, const ElfW(Verdef)* verdef, const ElfW(Verdaux)* verdaux) {
+      uint32_t id = intern_version_name(get_string(verdaux->vda_name));
+      set_version_id(verdef->vd_ndx, id);
+      verdef_ids_.emplace_back(id, verdef->vd_ndx);
+      return false;
+    });
+  // Keep the first definition of a version first, as the linear search did.
+  std::stable_sort(verdef_ids_.begin(), verdef_ids_.end(),
+                   [](const auto& a, const auto& b) { return a.first < b.first; });
+
+  // The verneed section isn't validated until VersionTracker::init_verneed, which reports any
+  // problem, so stop quietly at the first unsupported entry.
+  for (size_t i = 0, offset = 0; verneed_ptr_ != 0 && i < verneed_cnt_; ++i) {
+    const ElfW(Verneed)* verneed = reinterpret_cast<ElfW(Verneed)*>(verneed_ptr_ + offset);
+    if (verneed->vn_version != 1) {
+      break;
+    }
+    size_t vernaux_offset = offset + verneed->vn_aux;
+    offset += verneed->vn_next;
+
+    for (size_t j = 0; j < verneed->vn_cnt; ++j) {
+      const ElfW(Vernaux)* vernaux = reinterpret_cast<ElfW(Vernaux)*>(verneed_ptr_ + vernaux_offset);
+      vernaux_offset += vernaux->vna_next;
+      set_version_id(vernaux->vna_other, intern_version_name(get_string(vernaux->vna_name)));
+    }
+  }
+
+  has_version_ids_ = true;
+}
+
 ElfW(Versym) find_verdef_version_index(const soinfo* si, const version_info* vi) {
   if (vi == nullptr) {
     return kVersymNotNeeded;
   }
 
+  // The linker's own soinfo is prelinked before it can allocate, so it has no interned ids, and
+  // dlvsym() may ask for a version no library has interned.
+  if (vi->id != 0 && si->has_version_ids()) {
+    return si->find_verdef_index(vi->id);
+  }
+
   ElfW(Versym) result = kVersymGlobal;
 
   if (!for_each_verdef(si,
@@ -2749,7 +3086,8 @@ bool VersionTracker::init_verdef(const soinfo* si_from) {
   return for_each_verdef(si_from,
     [&](size_t, const ElfW(Verdef)* verdef, const ElfW(Verdaux)* verdaux) {
       add_version_info(verdef->vd_ndx, verdef->vd_hash,
-          si_from->get_string(verdaux->vda_name), si_from);
+          si_from->get_string(verdaux->vda_name), si_from,
+          si_from->get_version_id(verdef->vd_ndx));
       return false;
     }
   );
@@ -2788,53 +3126,13 @@ bool soinfo::lookup_version_info(const VersionTracker& version_tracker, ElfW(Wor
   return true;
 }
 
-static void apply_relr_reloc(ElfW(Addr) offset, ElfW(Addr) load_bias) {
-  ElfW(Addr) address = offset + load_bias;
-  *reinterpret_cast<ElfW(Addr)*>(address) += load_bias;
-}
-
-// Process relocations in SHT_RELR section (experimental).
-// Details of the encoding are described in this post:
-//   https://groups.google.com/d/msg/generic-abi/bX460iggiKg/Pi9aSwwABgAJ
-bool relocate_relr(const ElfW(Relr)* begin, const ElfW(Relr)* end, ElfW(Addr) load_bias) {
-  constexpr size_t wordsize = sizeof(ElfW(Addr));
-
-  ElfW(Addr) base = 0;
-  for (const ElfW(Relr)* current = begin; current < end; ++current) {
-    ElfW(Relr) entry = *current;
-    ElfW(Addr) offset;
-
-    if ((entry&1) == 0) {
-      // Even entry: encodes the offset for next relocation.
-      offset = static_cast<ElfW(Addr)>(entry);
-      apply_relr_reloc(offset, load_bias);
-      // Set base offset for subsequent bitmap entries.
-      base = offset + wordsize;
-      continue;
-    }
-
-    // Odd entry: encodes bitmap for relocations starting at base.
-    offset = base;
-    while (entry != 0) {
-      entry >>= 1;
-      if ((entry&1) != 0) {
-        apply_relr_reloc(offset, load_bias);
-      }
-      offset += wordsize;
-    }
-
-    // Advance base offset by 63 words for 64-bit platforms,
-    // or 31 words for 32-bit platforms.
-    base += (8*wordsize - 1) * wordsize;
-  }
-  return true;
-}
-
 // An empty list of soinfos
 static soinfo_list_t g_empty_list;
 
 bool soinfo::prelink_image() {
   if (flags_ & FLAG_PRELINKED) return true;
+  ScopedLoadPhase phase(get_realpath(), ANDROID_DL_LOAD_PHASE_PRELINK);
+
   /* Extract dynamic section */
   ElfW(Word) dynamic_flags = 0;
   phdr_table_get_dynamic_section(phdr, phnum, load_bias, &dynamic, &dynamic_flags);
@@ -2970,7 +3268,8 @@ bool soinfo::prelink_image() {
         break;
 
       case DT_PLTGOT:
-        // Ignored (because RTLD_LAZY is not supported).
+        // Only used for lazy binding.
+        plt_got_ = reinterpret_cast<ElfW(Addr)*>(load_bias + d->d_un.d_ptr);
         break;
 
       case DT_DEBUG:
@@ -3162,6 +3461,9 @@ bool soinfo::prelink_image() {
         if (d->d_un.d_val & DF_SYMBOLIC) {
           has_DT_SYMBOLIC = true;
         }
+        if (d->d_un.d_val & DF_BIND_NOW) {
+          has_bind_now_ = true;
+        }
         break;
 
       case DT_FLAGS_1:
@@ -3174,8 +3476,9 @@ bool soinfo::prelink_image() {
         }
         break;
 
-      // Ignored: "Its use has been superseded by the DF_BIND_NOW flag"
+      // "Its use has been superseded by the DF_BIND_NOW flag"
       case DT_BIND_NOW:
+        has_bind_now_ = true;
         break;
 
       case DT_VERSYM:
@@ -3322,6 +3625,10 @@ bool soinfo::prelink_image() {
   // it each time we look up a symbol with a version.
   if (!validate_verdef_section(this)) return false;
 
+  if (!relocating_linker) {
+    init_version_ids();
+  }
+
   flags_ |= FLAG_PRELINKED;
   return true;
 }
@@ -3333,6 +3640,20 @@ bool soinfo::link_image(const SymbolLookupList& lookup_list, soinfo* local_group
     return true;
   }
 
+  if (!relocate_image(lookup_list, local_group_root, extinfo, relro_fd_offset)) {
+    return false;
+  }
+
+  publish_image();
+  return true;
+}
+
+// The part of link_image() that only touches this library: relocation, RELRO protection and
+// RELRO sharing. Libraries in the same local group may be passed to this function concurrently
+// (see linker_parallel_link.cpp), so anything with process-wide side effects belongs in
+// publish_image() instead.
+bool soinfo::relocate_image(const SymbolLookupList& lookup_list, soinfo* local_group_root,
+                            const android_dlextinfo* extinfo, size_t* relro_fd_offset) {
   if (g_is_ldd && !is_main_executable()) {
     async_safe_format_fd(STDOUT_FILENO, "\t%s => %s (%p)\n", get_soname(),
                          get_realpath(), reinterpret_cast<void*>(base));
@@ -3370,8 +3691,11 @@ bool soinfo::link_image(const SymbolLookupList& lookup_list, soinfo* local_group
   }
 #endif
 
-  if (this != solist_get_vdso() && !relocate(lookup_list)) {
-    return false;
+  if (this != solist_get_vdso()) {
+    ScopedLoadPhase phase(get_realpath(), ANDROID_DL_LOAD_PHASE_LINK);
+    if (!relocate(lookup_list)) {
+      return false;
+    }
   }
 
   DEBUG("[ finished linking %s ]", get_realpath());
@@ -3386,6 +3710,8 @@ bool soinfo::link_image(const SymbolLookupList& lookup_list, soinfo* local_group
   }
 #endif
 
+  ScopedLoadPhase relro_phase(get_realpath(), ANDROID_DL_LOAD_PHASE_RELRO);
+
   // We can also turn on GNU RELRO protection if we're not linking the dynamic linker
   // itself --- it can't make system calls yet, and will have to call protect_relro later.
   if (!is_linker() && !protect_relro()) {
@@ -3405,12 +3731,23 @@ bool soinfo::link_image(const SymbolLookupList& lookup_list, soinfo* local_group
       DL_ERR("failed mapping GNU RELRO section for \"%s\": %m", get_realpath());
       return false;
     }
+  } else if (RelroCache::is_enabled() && !is_linker() && this != solist_get_vdso()) {
+    RelroCache::share(this);
+  }
+
+  if (!is_linker() && this != solist_get_vdso() &&
+      ((primary_namespace_ != nullptr && primary_namespace_->is_hugepage_text_enabled()) ||
+       phdr_table_has_hugepage_text_note(phdr, phnum, load_bias))) {
+    phdr_table_collapse_text_segments(phdr, phnum, load_bias, get_realpath());
   }
 
+  return true;
+}
+
+void soinfo::publish_image() {
   ++g_module_load_counter;
   notify_gdb_of_load(this);
   set_image_linked();
-  return true;
 }
 
 bool soinfo::protect_relro() {
@@ -3552,6 +3889,13 @@ std::vector<android_namespace_t*> init_default_namespaces(const char* executable
               strcmp(bname, "linker_hwasan64") == 0) ||
               (hwasan_env != nullptr && !getauxval(AT_SECURE) && strcmp(hwasan_env, "1") == 0);
 #endif
+
+  // The sanitizer runtimes track every thread through their pthread_create() interceptors, which
+  // can't be relied on while the loader lock is held. Always relocate on the calling thread.
+  if (g_is_asan || g_is_hwasan) {
+    set_relocation_thread_count(1);
+  }
+
   const Config* config = nullptr;
 
   {
@@ -3663,6 +4007,17 @@ android_namespace_t* get_exported_namespace(const char* name) {
   return it->second;
 }
 
+void print_linker_allocator_stats() {
+  auto print = [](const char* name, const LinkerBlockAllocatorStats& stats) {
+    PRINT("ALLOCATOR STATS: %s: %zu allocated, %zu free, %zu pages",
+          name, stats.allocated_blocks, stats.free_blocks, stats.pages);
+  };
+  print("soinfo", g_soinfo_allocator.stats());
+  print("soinfo links", g_soinfo_links_allocator.stats());
+  print("namespace", g_namespace_allocator.stats());
+  print("namespace links", g_namespace_list_allocator.stats());
+}
+
 void purge_unused_memory() {
   // For now, we only purge the memory used by LoadTask because we know those
   // are temporary objects.
@@ -3675,4 +4030,7 @@ void purge_unused_memory() {
   // would be already zeroed out, so they compress easily in ZRAM.  Therefore,
   // it is not worth munmap()'ing those pages.
   TypeBasedAllocator<LoadTask>::purge();
+
+  // Close the zip archives that the process didn't ask to keep open for later loads.
+  ZipArchiveCache::get().release();
 }
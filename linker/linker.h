@@ -42,6 +42,7 @@
 #include "linker_logger.h"
 #include "linker_soinfo.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -64,7 +65,7 @@ class VersionTracker {
   bool init_verneed(const soinfo* si_from);
   bool init_verdef(const soinfo* si_from);
   void add_version_info(size_t source_index, ElfW(Word) elf_hash,
-      const char* ver_name, const soinfo* target_si);
+      const char* ver_name, const soinfo* target_si, uint32_t id);
 
   std::vector<version_info> version_infos;
 
@@ -79,6 +80,13 @@ soinfo* get_libdl_info(const soinfo& linker_si);
 
 soinfo* find_containing_library(const void* p);
 
+// Returns a lookup list with the same libraries, in the same order, that were searched when `si`
+// was linked: the global group of its namespace followed by its local group.
+std::unique_ptr<SymbolLookupList> create_lookup_list_for(soinfo* si);
+
+// Returns a value that changes whenever a library is loaded or unloaded.
+uint64_t get_module_generation();
+
 int open_executable(const char* path, off64_t* file_offset, std::string* realpath);
 
 void do_android_get_LD_LIBRARY_PATH(char*, size_t);
@@ -92,6 +100,16 @@ int do_dlclose(void* handle);
 
 int do_dl_iterate_phdr(int (*cb)(dl_phdr_info* info, size_t size, void* data), void* data);
 
+// Iterates over the most recently published snapshot of the loaded libraries without taking the
+// loader lock. Returns false, without calling `cb`, if nothing has been published yet.
+bool do_dl_iterate_phdr_snapshot(int (*cb)(dl_phdr_info* info, size_t size, void* data),
+                                 void* data, int* result);
+
+// Publishes what lock-free readers see (the address index, the dl_iterate_phdr() snapshot) and
+// frees whatever they have finished with. Called by the exclusive holder of the loader lock just
+// before releasing it, and by find_libraries() before any of the new libraries' constructors run.
+void update_loader_snapshots();
+
 #if defined(__arm__)
 _Unwind_Ptr do_dl_unwind_find_exidx(_Unwind_Ptr pc, int* pcount);
 #endif
@@ -101,8 +119,13 @@ bool do_dlsym(void* handle, const char* sym_name,
               const void* caller_addr,
               void** symbol);
 
+size_t do_dlsym_batch(void* handle, const char* const* sym_names, void** symbols, size_t count,
+                      const void* caller_addr);
+
 int do_dladdr(const void* addr, Dl_info* info);
 
+bool do_dl_get_reloc_stats(void* handle, android_dl_reloc_stats* stats);
+
 void set_application_target_sdk_version(int target);
 int get_application_target_sdk_version();
 
@@ -131,6 +154,21 @@ enum {
    */
   ANDROID_NAMESPACE_TYPE_SHARED = 2,
 
+  /* This flag instructs the linker to back the executable segments of libraries in the namespace
+   * with transparent huge pages after they are linked, using MADV_COLLAPSE. Only the parts of a
+   * segment that cover whole PMD-sized (2MiB with 4KiB pages) blocks can be promoted, which in
+   * practice requires linking with -z max-page-size=2097152. Libraries can also opt in themselves
+   * with an NT_ANDROID_TYPE_HUGEPAGE_TEXT note.
+   */
+  ANDROID_NAMESPACE_TYPE_HUGEPAGE_TEXT = 0x02000000,
+
+  /* This flag instructs the linker to bind PLT entries of libraries in the namespace lazily, on
+   * the first call, instead of at load time. Only libraries linked without BIND_NOW whose
+   * .got.plt is outside the RELRO segment are bound lazily, and only on arm64 and x86_64.
+   * Libraries opened with RTLD_NOW are always bound eagerly.
+   */
+  ANDROID_NAMESPACE_TYPE_LAZY_BINDING = 0x04000000,
+
   /* This flag instructs linker to enable exempt-list workaround for the namespace.
    * See http://b/26394120 for details.
    */
@@ -170,6 +208,8 @@ void decrement_dso_handle_reference_counter(void* dso_handle);
 
 void purge_unused_memory();
 
+void print_linker_allocator_stats();
+
 struct address_space_params {
   void* start_addr = nullptr;
   size_t reserved_size = 0;
@@ -179,7 +219,6 @@ struct address_space_params {
 int get_application_target_sdk_version();
 ElfW(Versym) find_verdef_version_index(const soinfo* si, const version_info* vi);
 bool validate_verdef_section(const soinfo* si);
-bool relocate_relr(const ElfW(Relr)* begin, const ElfW(Relr)* end, ElfW(Addr) load_bias);
 
 struct platform_properties {
 #if defined(__aarch64__)
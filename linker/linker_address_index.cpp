@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "linker_address_index.h"
+
+#include <algorithm>
+
+#include "linker_main.h"
+#include "linker_soinfo.h"
+
+// How many times a library is searched for a symbol by address before a sorted table of its
+// symbols is built. Most libraries are never looked up by address, or only a few times for a
+// crash report, so the table (a few dozen bytes per symbol) is only worth it for hot ones.
+static constexpr uint32_t kSymbolTableLookupThreshold = 8;
+
+struct AddressIndex::SymbolTable {
+  struct Entry {
+    ElfW(Addr) start;
+    ElfW(Addr) end;
+    // The largest `end` of this and all preceding entries, which bounds the backwards search for
+    // symbols that overlap the address.
+    ElfW(Addr) max_end;
+    uint32_t index;
+  };
+
+  std::vector<Entry> entries;
+};
+
+void AddressIndex::forget(const soinfo* si) {
+  auto it = libraries_.find(si);
+  if (it != libraries_.end()) {
+    delete it->second.symbols.load(std::memory_order_relaxed);
+    libraries_.erase(it);
+  }
+  dirty_ = true;
+}
+
+void AddressIndex::update() {
+  if (!dirty_) return;
+
+  ranges_.clear();
+  for (soinfo* si = solist_get_head(); si != nullptr; si = si->next) {
+    if (si->base == 0 || si->size == 0) continue;
+    libraries_.try_emplace(si);
+    for (size_t i = 0; i < si->phnum; ++i) {
+      const ElfW(Phdr)* phdr = &si->phdr[i];
+      if (phdr->p_type != PT_LOAD || phdr->p_memsz == 0) continue;
+      // Clamp to the reservation, as find_containing_library() always has.
+      ElfW(Addr) start = std::max(si->load_bias + phdr->p_vaddr, si->base);
+      ElfW(Addr) end = std::min(si->load_bias + phdr->p_vaddr + phdr->p_memsz, si->base + si->size);
+      if (start < end) ranges_.push_back({start, end, si});
+    }
+  }
+  // The segments of different libraries never overlap, since they're all mapped.
+  std::sort(ranges_.begin(), ranges_.end(),
+            [](const Range& a, const Range& b) { return a.start < b.start; });
+  dirty_ = false;
+}
+
+soinfo* AddressIndex::find_library(ElfW(Addr) address) {
+  // Only the exclusive holder of the loader lock can see a stale index: it's always brought up to
+  // date before the lock is released.
+  update();
+
+  auto it = std::upper_bound(ranges_.begin(), ranges_.end(), address,
+                             [](ElfW(Addr) a, const Range& r) { return a < r.start; });
+  if (it == ranges_.begin()) return nullptr;
+  --it;
+  return address < it->end ? it->si : nullptr;
+}
+
+AddressIndex::SymbolTable* AddressIndex::build_symbol_table(soinfo* si) {
+  std::vector<uint32_t> indices;
+  si->get_address_lookup_candidates(&indices);
+
+  SymbolTable* table = new SymbolTable;
+  table->entries.reserve(indices.size());
+  const ElfW(Sym)* symtab = si->get_symtab();
+  for (uint32_t index : indices) {
+    const ElfW(Sym)* sym = symtab + index;
+    table->entries.push_back({sym->st_value, sym->st_value + sym->st_size, 0, index});
+  }
+
+  std::sort(table->entries.begin(), table->entries.end(),
+            [](const SymbolTable::Entry& a, const SymbolTable::Entry& b) {
+              return a.start < b.start || (a.start == b.start && a.index < b.index);
+            });
+  ElfW(Addr) max_end = 0;
+  for (auto& entry : table->entries) {
+    max_end = std::max(max_end, entry.end);
+    entry.max_end = max_end;
+  }
+  return table;
+}
+
+const ElfW(Sym)* AddressIndex::find_symbol(soinfo* si, ElfW(Addr) address) {
+  auto it = libraries_.find(si);
+  if (it == libraries_.end()) {
+    return si->find_symbol_by_address(reinterpret_cast<void*>(address));
+  }
+  Library& library = it->second;
+
+  SymbolTable* table = library.symbols.load(std::memory_order_acquire);
+  if (table == nullptr) {
+    if (library.lookups.fetch_add(1, std::memory_order_relaxed) < kSymbolTableLookupThreshold) {
+      return si->find_symbol_by_address(reinterpret_cast<void*>(address));
+    }
+
+    // Concurrent shared holders may race to build the table; the first one to finish wins.
+    table = build_symbol_table(si);
+    SymbolTable* expected = nullptr;
+    if (!library.symbols.compare_exchange_strong(expected, table, std::memory_order_acq_rel)) {
+      delete table;
+      table = expected;
+    }
+  }
+
+  // find_symbol_by_address() returns the first candidate, in symbol index order, that contains
+  // the address. Entries are sorted by start address, so walk back from the last entry that
+  // starts at or before the address until no earlier entry can reach it.
+  ElfW(Addr) soaddr = address - si->load_bias;
+  const auto& entries = table->entries;
+  auto it_entry = std::upper_bound(entries.begin(), entries.end(), soaddr,
+                                   [](ElfW(Addr) a, const SymbolTable::Entry& e) {
+                                     return a < e.start;
+                                   });
+  uint32_t best = UINT32_MAX;
+  while (it_entry != entries.begin()) {
+    --it_entry;
+    if (it_entry->max_end <= soaddr) break;
+    if (soaddr < it_entry->end) best = std::min(best, it_entry->index);
+  }
+  return best == UINT32_MAX ? nullptr : si->get_symtab() + best;
+}
+
+static AddressIndex g_address_index;
+
+AddressIndex& get_address_index() {
+  return g_address_index;
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <link.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+#include <android-base/macros.h>
+
+struct soinfo;
+
+// Maps addresses to the loaded library, and the dynamic symbol, that contain them.
+//
+// The index holds the PT_LOAD segments of every loaded library in a sorted array, so
+// find_library() is a binary search instead of a walk over the soinfo list. Once a library has
+// been searched for symbols a few times, find_symbol() also builds an address-sorted table of its
+// symbols, so dladdr() on a hot library is two binary searches.
+//
+// The exclusive holder of the loader lock invalidates the index whenever a library is added,
+// mapped or removed, and the index is rebuilt before the lock is released. Shared holders
+// therefore always see a current index. The per-library symbol tables are the only thing they
+// create, and they publish them atomically.
+class AddressIndex {
+ public:
+  AddressIndex() = default;
+
+  void invalidate() { dirty_ = true; }
+
+  // Drops the state kept for `si`, which is about to be freed.
+  void forget(const soinfo* si);
+
+  // Brings the index up to date. Must only be called by the exclusive holder of the loader lock.
+  void update();
+
+  soinfo* find_library(ElfW(Addr) address);
+
+  // Equivalent to si->find_symbol_by_address(address).
+  const ElfW(Sym)* find_symbol(soinfo* si, ElfW(Addr) address);
+
+ private:
+  struct SymbolTable;
+
+  struct Library {
+    std::atomic<uint32_t> lookups{0};
+    std::atomic<SymbolTable*> symbols{nullptr};
+  };
+
+  struct Range {
+    ElfW(Addr) start;
+    ElfW(Addr) end;
+    soinfo* si;
+  };
+
+  static SymbolTable* build_symbol_table(soinfo* si);
+
+  bool dirty_ = true;
+  std::vector<Range> ranges_;
+  std::unordered_map<const soinfo*, Library> libraries_;
+
+  DISALLOW_COPY_AND_ASSIGN(AddressIndex);
+};
+
+AddressIndex& get_address_index();
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "linker_binding_cache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "linker_debug.h"
+#include "linker_globals.h"
+#include "linker_phdr.h"
+#include "linker_soinfo.h"
+#include "linker_utils.h"
+
+namespace {
+
+constexpr uint32_t kBindingCacheMagic = 0x4342444c;  // "LDBC"
+constexpr uint32_t kBindingCacheVersion = 1;
+
+struct BindingCacheHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t key;
+  uint32_t entry_count;
+  uint32_t checksum;
+};
+
+uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ p[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+uint32_t checksum_entries(const void* entries, size_t size) {
+  uint64_t hash = fnv1a(0xcbf29ce484222325ULL, entries, size);
+  return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+}  // namespace
+
+std::vector<uint8_t> encode_binding_cache(uint64_t key,
+                                          const std::vector<BindingCacheEntry>& entries) {
+  const size_t entries_size = entries.size() * sizeof(BindingCacheEntry);
+
+  BindingCacheHeader header = {};
+  header.magic = kBindingCacheMagic;
+  header.version = kBindingCacheVersion;
+  header.key = key;
+  header.entry_count = entries.size();
+  header.checksum = checksum_entries(entries.data(), entries_size);
+
+  std::vector<uint8_t> result(sizeof(header) + entries_size);
+  memcpy(result.data(), &header, sizeof(header));
+  memcpy(result.data() + sizeof(header), entries.data(), entries_size);
+  return result;
+}
+
+bool decode_binding_cache(const void* data, size_t size, uint64_t key,
+                          const BindingCacheEntry** entries, size_t* entry_count) {
+  if (size < sizeof(BindingCacheHeader)) return false;
+
+  const BindingCacheHeader* header = static_cast<const BindingCacheHeader*>(data);
+  const BindingCacheEntry* file_entries = reinterpret_cast<const BindingCacheEntry*>(header + 1);
+  const size_t entries_size = size - sizeof(BindingCacheHeader);
+  // Compare counts rather than sizes: entry_count * sizeof(BindingCacheEntry) can wrap on LP32.
+  if (header->magic != kBindingCacheMagic ||
+      header->version != kBindingCacheVersion ||
+      header->key != key ||
+      entries_size % sizeof(BindingCacheEntry) != 0 ||
+      entries_size / sizeof(BindingCacheEntry) != header->entry_count ||
+      header->checksum != checksum_entries(file_entries, entries_size)) {
+    return false;
+  }
+
+  *entries = file_entries;
+  *entry_count = header->entry_count;
+  return true;
+}
+
+const ElfW(Sym)* find_cached_symbol(const ElfW(Sym)* symtab, size_t sym_count, const char* strtab,
+                                    size_t strtab_size, uint32_t sym_index, const char* sym_name) {
+  if (sym_index >= sym_count) return nullptr;
+
+  const ElfW(Sym)* s = symtab + sym_index;
+  const size_t name_size = strlen(sym_name) + 1;
+  if (s->st_shndx == SHN_UNDEF ||
+      s->st_name >= strtab_size || strtab_size - s->st_name < name_size ||
+      memcmp(strtab + s->st_name, sym_name, name_size) != 0) {
+    return nullptr;
+  }
+  return s;
+}
+
+std::string BindingCache::directory_;
+
+void BindingCache::set_directory(const char* path) {
+  directory_ = (path != nullptr) ? path : "";
+}
+
+BindingCache::~BindingCache() {
+  if (map_start_ != nullptr) {
+    munmap(map_start_, map_size_);
+  }
+}
+
+bool BindingCache::open(soinfo* si, const SymbolLookupList& lookup_list) {
+  if (!is_enabled()) return false;
+
+  const uint8_t* build_id = nullptr;
+  size_t build_id_size = 0;
+  if (!phdr_table_get_build_id(si->phdr, si->phnum, si->load_bias, &build_id, &build_id_size)) {
+    return false;
+  }
+  const uint64_t list_hash = lookup_list.get_build_id_hash();
+  if (list_hash == 0) {
+    return false;
+  }
+
+  uint64_t key = fnv1a(0xcbf29ce484222325ULL, &kBindingCacheVersion, sizeof(kBindingCacheVersion));
+  key = fnv1a(key, &build_id_size, sizeof(build_id_size));
+  key = fnv1a(key, build_id, build_id_size);
+  key = fnv1a(key, &list_hash, sizeof(list_hash));
+
+  char name[32];
+  snprintf(name, sizeof(name), "/%016" PRIx64 ".bindings", key);
+
+  si_ = si;
+  lookup_list_ = &lookup_list;
+  key_ = key;
+  path_ = directory_ + name;
+
+  if (!map_file()) {
+    recording_ = true;
+  }
+  DEBUG("[ binding cache for \"%s\": %s %s ]", si->get_realpath(),
+        recording_ ? "recording" : "using", path_.c_str());
+  return true;
+}
+
+bool BindingCache::map_file() {
+  // The bindings decide which code gets called, so only files that nobody else can write are used.
+  struct stat file_stat;
+  int fd = open_trusted_file(path_, &file_stat);
+  if (fd == -1) {
+    if (errno != ENOENT) {
+      DEBUG("[ couldn't open binding cache file %s: %m ]", path_.c_str());
+    }
+    return false;
+  }
+
+  if (static_cast<size_t>(file_stat.st_size) < sizeof(BindingCacheHeader)) {
+    close(fd);
+    return false;
+  }
+
+  size_t size = file_stat.st_size;
+  void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+
+  if (!decode_binding_cache(map, size, key_, &cached_entries_, &cached_entry_count_)) {
+    DEBUG("[ ignoring invalid binding cache file %s ]", path_.c_str());
+    munmap(map, size);
+    return false;
+  }
+
+  map_start_ = map;
+  map_size_ = size;
+  return true;
+}
+
+void BindingCache::invalidate(const char* sym_name) {
+  // The key already covers every input to symbol resolution, so a binding can only be wrong if the
+  // file was tampered with. Don't trust it for the rest of this library.
+  DL_WARN("binding cache %s for \"%s\" is inconsistent (\"%s\"); ignoring it",
+          path_.c_str(), si_->get_realpath(), sym_name);
+  cached_entry_count_ = 0;
+}
+
+bool BindingCache::lookup(uint32_t r_sym, const char* sym_name, soinfo** found_in,
+                          const ElfW(Sym)** sym) {
+  if (r_sym >= cached_entry_count_) return false;
+
+  const BindingCacheEntry& entry = cached_entries_[r_sym];
+  // The process that wrote the file never looked this symbol up (because it left the PLT to be
+  // bound lazily, say), so there's nothing to reuse, but nothing wrong with the file either.
+  if (entry.lib_index == kUnknown) return false;
+  if (entry.lib_index == kUnresolved) {
+    *found_in = nullptr;
+    *sym = nullptr;
+    return true;
+  }
+
+  const size_t lib_count = lookup_list_->end() - lookup_list_->begin();
+  if (entry.lib_index >= lib_count) {
+    invalidate(sym_name);
+    return false;
+  }
+
+  soinfo* lib = lookup_list_->begin()[entry.lib_index].si_;
+  const ElfW(Sym)* s = find_cached_symbol(lib->get_symtab(), lib->get_symbol_count(),
+                                          lib->get_strtab(), lib->get_strtab_size(),
+                                          entry.sym_index, sym_name);
+  if (s == nullptr) {
+    invalidate(sym_name);
+    return false;
+  }
+
+  *found_in = lib;
+  *sym = s;
+  return true;
+}
+
+void BindingCache::record(uint32_t r_sym, const soinfo* found_in, const ElfW(Sym)* sym) {
+  if (!recording_) return;
+
+  if (r_sym >= recorded_entries_.size()) {
+    recorded_entries_.resize(r_sym + 1, BindingCacheEntry { kUnknown, 0 });
+  }
+
+  BindingCacheEntry& entry = recorded_entries_[r_sym];
+  if (sym == nullptr) {
+    entry = BindingCacheEntry { kUnresolved, 0 };
+    return;
+  }
+
+  const SymbolLookupLib* begin = lookup_list_->begin();
+  for (const SymbolLookupLib* lib = begin; lib != lookup_list_->end(); ++lib) {
+    if (lib->si_ == found_in) {
+      entry.lib_index = lib - begin;
+      entry.sym_index = sym - found_in->get_symtab();
+      return;
+    }
+  }
+}
+
+void BindingCache::commit() {
+  if (!recording_ || recorded_entries_.empty()) return;
+
+  const std::vector<uint8_t> contents = encode_binding_cache(key_, recorded_entries_);
+
+  write_trusted_file(path_, contents.data(), contents.size());
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <link.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <android-base/macros.h>
+
+class SymbolLookupList;
+struct soinfo;
+
+// One binding in a cache file: the index in the lookup list of the library that defined the symbol,
+// and the symbol's index in that library's dynamic symbol table.
+struct BindingCacheEntry {
+  uint32_t lib_index;
+  uint32_t sym_index;
+};
+
+// Returns the contents of a cache file holding `entries`, for the lookup key `key`.
+std::vector<uint8_t> encode_binding_cache(uint64_t key,
+                                          const std::vector<BindingCacheEntry>& entries);
+
+// Checks that `data` is a complete, uncorrupted cache file for `key`, and if so, points `entries`
+// at the `entry_count` bindings in it.
+bool decode_binding_cache(const void* data, size_t size, uint64_t key,
+                          const BindingCacheEntry** entries, size_t* entry_count);
+
+// Returns symbol `sym_index` of a dynamic symbol table with `sym_count` entries if it's a
+// definition of `sym_name`, or nullptr if it's something else or either the index or its name is
+// out of bounds. Cache files are only checked for corruption, so this is what stands between a
+// crafted file and an out-of-bounds read.
+const ElfW(Sym)* find_cached_symbol(const ElfW(Sym)* symtab, size_t sym_count, const char* strtab,
+                                    size_t strtab_size, uint32_t sym_index, const char* sym_name);
+
+// An opt-in, on-disk cache of the symbol bindings made while relocating a library.
+//
+// The first time a library is relocated against a given lookup list, the (library, symbol) pair
+// that each referenced dynamic symbol resolved to is recorded and written to a file in the
+// directory named by LD_BINDING_CACHE_DIR. Later runs that relocate the same library against the
+// same libraries in the same order reuse those bindings instead of searching the lookup list.
+//
+// The file is keyed by the build IDs of the library and of every library in the lookup list, so
+// any change to the inputs of symbol resolution selects a different file. Libraries without a
+// build ID are never cached, and files that anyone other than root or this process's effective uid
+// could have written are ignored; see open_trusted_file().
+class BindingCache {
+ public:
+  BindingCache() = default;
+  ~BindingCache();
+
+  static void set_directory(const char* path);
+  static bool is_enabled() { return !directory_.empty(); }
+
+  // Prepares the cache for relocating `si` against `lookup_list`. Returns false if no cache can be
+  // used for this library, in which case the other methods must not be called.
+  bool open(soinfo* si, const SymbolLookupList& lookup_list);
+
+  // Returns the cached binding for the dynamic symbol `r_sym`, if there is one. `sym` is set to
+  // nullptr for a weak reference that was left unresolved.
+  bool lookup(uint32_t r_sym, const char* sym_name, soinfo** found_in, const ElfW(Sym)** sym);
+
+  // Records the binding for a symbol lookup that missed the cache.
+  void record(uint32_t r_sym, const soinfo* found_in, const ElfW(Sym)* sym);
+
+  // Writes the recorded bindings out, if this library had no cache file yet.
+  void commit();
+
+ private:
+  static constexpr uint32_t kUnknown = UINT32_MAX;
+  static constexpr uint32_t kUnresolved = UINT32_MAX - 1;
+
+  bool map_file();
+  void invalidate(const char* sym_name);
+
+  static std::string directory_;
+
+  soinfo* si_ = nullptr;
+  const SymbolLookupList* lookup_list_ = nullptr;
+  std::string path_;
+  uint64_t key_ = 0;
+
+  // Bindings read from an existing cache file.
+  void* map_start_ = nullptr;
+  size_t map_size_ = 0;
+  const BindingCacheEntry* cached_entries_ = nullptr;
+  size_t cached_entry_count_ = 0;
+
+  // Bindings recorded for a new cache file.
+  bool recording_ = false;
+  std::vector<BindingCacheEntry> recorded_entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(BindingCache);
+};
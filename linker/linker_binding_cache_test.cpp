@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <elf.h>
+#include <link.h>
+#include <string.h>
+
+#include <gtest/gtest.h>
+
+#include "linker_binding_cache.h"
+
+static constexpr uint64_t kKey = 0x0123456789abcdefULL;
+
+// Offsets of fields in the 24-byte file header: magic, version, key, entry_count, checksum.
+static constexpr size_t kMagicOffset = 0;
+static constexpr size_t kEntryCountOffset = 16;
+static constexpr size_t kHeaderSize = 24;
+
+static const std::vector<BindingCacheEntry> kEntries = {{0, 1}, {UINT32_MAX - 1, 0}, {2, 7}};
+
+TEST(linker_binding_cache, round_trip) {
+  std::vector<uint8_t> file = encode_binding_cache(kKey, kEntries);
+  ASSERT_EQ(kHeaderSize + kEntries.size() * sizeof(BindingCacheEntry), file.size());
+
+  const BindingCacheEntry* entries = nullptr;
+  size_t entry_count = 0;
+  ASSERT_TRUE(decode_binding_cache(file.data(), file.size(), kKey, &entries, &entry_count));
+  ASSERT_EQ(kEntries.size(), entry_count);
+  for (size_t i = 0; i < entry_count; ++i) {
+    EXPECT_EQ(kEntries[i].lib_index, entries[i].lib_index) << i;
+    EXPECT_EQ(kEntries[i].sym_index, entries[i].sym_index) << i;
+  }
+}
+
+TEST(linker_binding_cache, wrong_key) {
+  std::vector<uint8_t> file = encode_binding_cache(kKey, kEntries);
+  const BindingCacheEntry* entries = nullptr;
+  size_t entry_count = 0;
+  ASSERT_FALSE(decode_binding_cache(file.data(), file.size(), kKey + 1, &entries, &entry_count));
+}
+
+TEST(linker_binding_cache, corrupted_header) {
+  const BindingCacheEntry* entries = nullptr;
+  size_t entry_count = 0;
+
+  std::vector<uint8_t> file = encode_binding_cache(kKey, kEntries);
+  file[kMagicOffset] ^= 1;
+  ASSERT_FALSE(decode_binding_cache(file.data(), file.size(), kKey, &entries, &entry_count));
+
+  // A count that only matches the file size once multiplied out in 32 bits.
+  file = encode_binding_cache(kKey, kEntries);
+  uint32_t entry_count_field = kEntries.size() + (1U << 29);
+  memcpy(&file[kEntryCountOffset], &entry_count_field, sizeof(entry_count_field));
+  ASSERT_FALSE(decode_binding_cache(file.data(), file.size(), kKey, &entries, &entry_count));
+
+  file = encode_binding_cache(kKey, kEntries);
+  ASSERT_FALSE(decode_binding_cache(file.data(), kHeaderSize - 1, kKey, &entries, &entry_count));
+}
+
+TEST(linker_binding_cache, corrupted_entries) {
+  const BindingCacheEntry* entries = nullptr;
+  size_t entry_count = 0;
+
+  std::vector<uint8_t> file = encode_binding_cache(kKey, kEntries);
+  file[kHeaderSize + sizeof(BindingCacheEntry)] ^= 1;
+  ASSERT_FALSE(decode_binding_cache(file.data(), file.size(), kKey, &entries, &entry_count));
+
+  // Truncated, and with trailing garbage.
+  file = encode_binding_cache(kKey, kEntries);
+  ASSERT_FALSE(decode_binding_cache(file.data(), file.size() - 1, kKey, &entries, &entry_count));
+  file.push_back(0);
+  ASSERT_FALSE(decode_binding_cache(file.data(), file.size(), kKey, &entries, &entry_count));
+}
+
+TEST(linker_binding_cache, find_cached_symbol) {
+  static const char strtab[] = "\0foo\0bar";
+  ElfW(Sym) symtab[3] = {};
+  symtab[1].st_name = 1;
+  symtab[1].st_shndx = 1;
+  symtab[2].st_name = 5;
+  symtab[2].st_shndx = SHN_UNDEF;
+
+  EXPECT_EQ(&symtab[1], find_cached_symbol(symtab, 3, strtab, sizeof(strtab), 1, "foo"));
+  // A different name, an undefined symbol, and an index past the end of the table.
+  EXPECT_EQ(nullptr, find_cached_symbol(symtab, 3, strtab, sizeof(strtab), 1, "fo"));
+  EXPECT_EQ(nullptr, find_cached_symbol(symtab, 3, strtab, sizeof(strtab), 2, "bar"));
+  EXPECT_EQ(nullptr, find_cached_symbol(symtab, 3, strtab, sizeof(strtab), 3, "foo"));
+  EXPECT_EQ(nullptr, find_cached_symbol(symtab, 3, strtab, sizeof(strtab), UINT32_MAX, "foo"));
+}
+
+TEST(linker_binding_cache, find_cached_symbol_name_out_of_range) {
+  static const char strtab[] = "\0foo";
+  ElfW(Sym) symtab[2] = {};
+  symtab[1].st_shndx = 1;
+
+  symtab[1].st_name = sizeof(strtab);
+  EXPECT_EQ(nullptr, find_cached_symbol(symtab, 2, strtab, sizeof(strtab), 1, "foo"));
+  symtab[1].st_name = UINT32_MAX;
+  EXPECT_EQ(nullptr, find_cached_symbol(symtab, 2, strtab, sizeof(strtab), 1, "foo"));
+  // The name would run off the end of the string table.
+  symtab[1].st_name = 1;
+  EXPECT_EQ(nullptr, find_cached_symbol(symtab, 2, strtab, sizeof(strtab) - 1, 1, "foo"));
+}
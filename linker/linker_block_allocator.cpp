@@ -41,9 +41,14 @@ static constexpr size_t kMaxPageSize = 65536;
 static constexpr size_t kAllocateSize = kMaxPageSize * 6;
 static_assert(kAllocateSize % kMaxPageSize == 0, "Invalid kAllocateSize.");
 
+// Each page keeps its own free list and count of allocated blocks, so that a page can be returned
+// to the kernel as soon as its last block is freed.
 struct LinkerBlockAllocatorPage {
   LinkerBlockAllocatorPage* next;
-  uint8_t bytes[kAllocateSize - 16] __attribute__((aligned(16)));
+  LinkerBlockAllocatorPage* prev;
+  void* free_block_list;
+  size_t allocated;
+  uint8_t bytes[kAllocateSize - 4 * sizeof(void*)] __attribute__((aligned(16)));
 };
 
 struct FreeBlockInfo {
@@ -56,30 +61,41 @@ static_assert(kBlockSizeMin == sizeof(FreeBlockInfo));
 
 LinkerBlockAllocator::LinkerBlockAllocator(size_t block_size)
     : block_size_(__BIONIC_ALIGN(MAX(block_size, kBlockSizeMin), kBlockSizeAlign)),
+      blocks_per_page_(sizeof(LinkerBlockAllocatorPage::bytes) / block_size_),
       page_list_(nullptr),
-      free_block_list_(nullptr),
+      alloc_page_(nullptr),
+      page_count_(0),
       allocated_(0) {}
 
 void* LinkerBlockAllocator::alloc() {
-  if (free_block_list_ == nullptr) {
-    create_new_page();
+  if (alloc_page_ == nullptr) {
+    alloc_page_ = find_fullest_page();
+    if (alloc_page_ == nullptr) {
+      create_new_page();
+    }
   }
 
-  FreeBlockInfo* block_info = reinterpret_cast<FreeBlockInfo*>(free_block_list_);
+  LinkerBlockAllocatorPage* page = alloc_page_;
+  FreeBlockInfo* block_info = reinterpret_cast<FreeBlockInfo*>(page->free_block_list);
   if (block_info->num_free_blocks > 1) {
     FreeBlockInfo* next_block_info = reinterpret_cast<FreeBlockInfo*>(
-      reinterpret_cast<char*>(free_block_list_) + block_size_);
+      reinterpret_cast<char*>(block_info) + block_size_);
     next_block_info->next_block = block_info->next_block;
     next_block_info->num_free_blocks = block_info->num_free_blocks - 1;
-    free_block_list_ = next_block_info;
+    page->free_block_list = next_block_info;
   } else {
-    free_block_list_ = block_info->next_block;
+    page->free_block_list = block_info->next_block;
   }
 
   memset(block_info, 0, block_size_);
 
+  ++page->allocated;
   ++allocated_;
 
+  if (page->free_block_list == nullptr) {
+    alloc_page_ = nullptr;
+  }
+
   return block_info;
 }
 
@@ -98,12 +114,24 @@ void LinkerBlockAllocator::free(void* block) {
 
   FreeBlockInfo* block_info = reinterpret_cast<FreeBlockInfo*>(block);
 
-  block_info->next_block = free_block_list_;
+  block_info->next_block = page->free_block_list;
   block_info->num_free_blocks = 1;
 
-  free_block_list_ = block_info;
+  page->free_block_list = block_info;
 
+  --page->allocated;
   --allocated_;
+
+  if (page->allocated == 0 && page_count_ > 1) {
+    // Keep the last page, so that a single allocation and free in a loop doesn't map and unmap a
+    // page each time. purge() releases it.
+    release_page(page);
+  } else if (page == alloc_page_) {
+    // Another page may now be fuller.
+    alloc_page_ = nullptr;
+  } else if (alloc_page_ != nullptr && page->allocated > alloc_page_->allocated) {
+    alloc_page_ = page;
+  }
 }
 
 void LinkerBlockAllocator::protect_all(int prot) {
@@ -125,13 +153,39 @@ void LinkerBlockAllocator::create_new_page() {
   prctl(PR_SET_VMA, PR_SET_VMA_ANON_NAME, page, kAllocateSize, "linker_alloc");
 
   FreeBlockInfo* first_block = reinterpret_cast<FreeBlockInfo*>(page->bytes);
-  first_block->next_block = free_block_list_;
-  first_block->num_free_blocks = sizeof(page->bytes) / block_size_;
+  first_block->next_block = nullptr;
+  first_block->num_free_blocks = blocks_per_page_;
 
-  free_block_list_ = first_block;
+  page->free_block_list = first_block;
+  page->allocated = 0;
 
+  page->prev = nullptr;
   page->next = page_list_;
+  if (page_list_ != nullptr) {
+    page_list_->prev = page;
+  }
   page_list_ = page;
+  ++page_count_;
+
+  alloc_page_ = page;
+}
+
+void LinkerBlockAllocator::release_page(LinkerBlockAllocatorPage* page) {
+  if (page->prev != nullptr) {
+    page->prev->next = page->next;
+  } else {
+    page_list_ = page->next;
+  }
+  if (page->next != nullptr) {
+    page->next->prev = page->prev;
+  }
+  --page_count_;
+
+  if (page == alloc_page_) {
+    alloc_page_ = nullptr;
+  }
+
+  munmap(page, kAllocateSize);
 }
 
 LinkerBlockAllocatorPage* LinkerBlockAllocator::find_page(void* block) {
@@ -140,7 +194,7 @@ LinkerBlockAllocatorPage* LinkerBlockAllocator::find_page(void* block) {
   LinkerBlockAllocatorPage* page = page_list_;
   while (page != nullptr) {
     const uint8_t* page_ptr = reinterpret_cast<const uint8_t*>(page);
-    if (block >= (page_ptr + sizeof(page->next)) && block < (page_ptr + kAllocateSize)) {
+    if (block >= page->bytes && block < (page_ptr + kAllocateSize)) {
       return page;
     }
 
@@ -150,6 +204,17 @@ LinkerBlockAllocatorPage* LinkerBlockAllocator::find_page(void* block) {
   async_safe_fatal("couldn't find page for %p", block);
 }
 
+LinkerBlockAllocatorPage* LinkerBlockAllocator::find_fullest_page() {
+  LinkerBlockAllocatorPage* fullest = nullptr;
+  for (LinkerBlockAllocatorPage* page = page_list_; page != nullptr; page = page->next) {
+    if (page->free_block_list != nullptr &&
+        (fullest == nullptr || page->allocated > fullest->allocated)) {
+      fullest = page;
+    }
+  }
+  return fullest;
+}
+
 void LinkerBlockAllocator::purge() {
   if (allocated_) {
     return;
@@ -162,5 +227,14 @@ void LinkerBlockAllocator::purge() {
     page = next;
   }
   page_list_ = nullptr;
-  free_block_list_ = nullptr;
+  alloc_page_ = nullptr;
+  page_count_ = 0;
+}
+
+LinkerBlockAllocatorStats LinkerBlockAllocator::stats() const {
+  return {
+    .allocated_blocks = allocated_,
+    .free_blocks = page_count_ * blocks_per_page_ - allocated_,
+    .pages = page_count_,
+  };
 }
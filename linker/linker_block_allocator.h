@@ -38,6 +38,14 @@ static constexpr size_t kBlockSizeMin = sizeof(void*) * 2;
 
 struct LinkerBlockAllocatorPage;
 
+struct LinkerBlockAllocatorStats {
+  // Blocks in use, and blocks available without mapping another page.
+  size_t allocated_blocks;
+  size_t free_blocks;
+  // Pages currently mapped. Each allocator page spans several OS pages.
+  size_t pages;
+};
+
 /*
  * This class is a non-template version of the LinkerTypeAllocator
  * It keeps code inside .cpp file by keeping the interface
@@ -56,13 +64,22 @@ class LinkerBlockAllocator {
   // Purge all pages if all previously allocated blocks have been freed.
   void purge();
 
+  LinkerBlockAllocatorStats stats() const;
+
  private:
   void create_new_page();
+  void release_page(LinkerBlockAllocatorPage* page);
   LinkerBlockAllocatorPage* find_page(void* block);
+  LinkerBlockAllocatorPage* find_fullest_page();
 
   size_t block_size_;
+  size_t blocks_per_page_;
   LinkerBlockAllocatorPage* page_list_;
-  void* free_block_list_;
+  // The page that alloc() takes blocks from: the fullest page with a free block, so that
+  // allocations are packed into few pages and the other pages can drain. Null if it needs to be
+  // looked up again.
+  LinkerBlockAllocatorPage* alloc_page_;
+  size_t page_count_;
   size_t allocated_;
 
   DISALLOW_COPY_AND_ASSIGN(LinkerBlockAllocator);
@@ -80,7 +97,9 @@ class LinkerBlockAllocator {
  *    513 this allocator will use 516 (520 for lp64) bytes of data where
  *    generalized implementation is going to use 1024 sized blocks.
  *
- * 2. This allocator does not munmap allocated memory, where BionicAllocator does.
+ * 2. This allocator only munmaps a page once every block in it has been freed
+ *    (and it isn't the last page), where BionicAllocator can munmap any large
+ *    allocation.
  *
  * 3. This allocator provides mprotect services to the user, where BionicAllocator
  *    always treats its memory as READ|WRITE.
@@ -92,6 +111,7 @@ class LinkerTypeAllocator {
   T* alloc() { return reinterpret_cast<T*>(block_allocator_.alloc()); }
   void free(T* t) { block_allocator_.free(t); }
   void protect_all(int prot) { block_allocator_.protect_all(prot); }
+  LinkerBlockAllocatorStats stats() const { return block_allocator_.stats(); }
  private:
   LinkerBlockAllocator block_allocator_;
   DISALLOW_COPY_AND_ASSIGN(LinkerTypeAllocator);
@@ -37,6 +37,8 @@
 
 #include <unistd.h>
 
+#include <vector>
+
 namespace {
 
 struct test_struct_nominal {
@@ -115,6 +117,64 @@ TEST(linker_allocator, test_larger) {
   ASSERT_TRUE(ptr_to_free != nullptr);
 }
 
+// Allocates blocks until the allocator maps its second page, and returns the blocks on the first.
+static std::vector<test_struct_larger*> fill_first_page(
+    LinkerTypeAllocator<test_struct_larger>* allocator, test_struct_larger** second_page_block) {
+  std::vector<test_struct_larger*> blocks;
+  while (true) {
+    test_struct_larger* block = allocator->alloc();
+    if (allocator->stats().pages == 2) {
+      *second_page_block = block;
+      return blocks;
+    }
+    blocks.push_back(block);
+  }
+}
+
+TEST(linker_allocator, test_stats) {
+  LinkerTypeAllocator<test_struct_larger> allocator;
+  ASSERT_EQ(0U, allocator.stats().pages);
+
+  test_struct_larger* ptr1 = allocator.alloc();
+  test_struct_larger* ptr2 = allocator.alloc();
+  LinkerBlockAllocatorStats stats = allocator.stats();
+  ASSERT_EQ(2U, stats.allocated_blocks);
+  ASSERT_EQ(1U, stats.pages);
+  ASSERT_NE(0U, stats.free_blocks);
+
+  allocator.free(ptr1);
+  ASSERT_EQ(1U, allocator.stats().allocated_blocks);
+  ASSERT_EQ(stats.free_blocks + 1, allocator.stats().free_blocks);
+  allocator.free(ptr2);
+}
+
+TEST(linker_allocator, test_release_empty_page) {
+  LinkerTypeAllocator<test_struct_larger> allocator;
+  test_struct_larger* second_page_block;
+  std::vector<test_struct_larger*> blocks = fill_first_page(&allocator, &second_page_block);
+
+  for (test_struct_larger* block : blocks) allocator.free(block);
+  // The first page is unmapped as soon as its last block is freed.
+  ASSERT_EQ(1U, allocator.stats().pages);
+  ASSERT_EQ(1U, allocator.stats().allocated_blocks);
+
+  // The last page is kept.
+  allocator.free(second_page_block);
+  ASSERT_EQ(1U, allocator.stats().pages);
+  ASSERT_EQ(0U, allocator.stats().allocated_blocks);
+}
+
+TEST(linker_allocator, test_prefers_fullest_page) {
+  LinkerTypeAllocator<test_struct_larger> allocator;
+  test_struct_larger* second_page_block;
+  std::vector<test_struct_larger*> blocks = fill_first_page(&allocator, &second_page_block);
+
+  // The first page now has one free block, and the second page has all but one free.
+  test_struct_larger* freed = blocks[blocks.size() / 2];
+  allocator.free(freed);
+  ASSERT_EQ(freed, allocator.alloc());
+}
+
 static void protect_all() {
   LinkerTypeAllocator<test_struct_larger> allocator;
 
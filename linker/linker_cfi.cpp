@@ -205,6 +205,8 @@ bool CFIShadowWriter::NotifyLibDl(soinfo* solist, uintptr_t p) {
   CHECK(shadow_start != nullptr);
   CHECK(*shadow_start == p);
   mprotect(shadow_start, page_size(), PROT_READ);
+  invalidate_slowpath_cache = reinterpret_cast<void (*)()>(
+      soinfo_find_symbol(libdl, "__cfi_slowpath_cache_invalidate"));
   return true;
 }
 
@@ -267,6 +269,8 @@ void CFIShadowWriter::BeforeUnload(soinfo* si) {
        static_cast<uintptr_t>(si->size), si->get_soname());
   AddInvalid(si->base, si->base + si->size);
   FixupVmaName();
+  // Only once the shadow is updated, so that nothing accepted from the old shadow is cached again.
+  if (invalidate_slowpath_cache != nullptr) invalidate_slowpath_cache();
 }
 
 bool CFIShadowWriter::InitialLinkDone(soinfo* solist) {
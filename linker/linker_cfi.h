@@ -81,6 +81,10 @@ class CFIShadowWriter : private CFIShadow {
   // Pointer to the shadow start address.
   uintptr_t *shadow_start;
 
+  // libdl's __cfi_slowpath_cache_invalidate, which forgets the targets its slow path cache has
+  // already accepted.
+  void (*invalidate_slowpath_cache)();
+
   bool initial_link_done;
 
  public:
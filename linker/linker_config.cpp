@@ -28,6 +28,7 @@
 
 #include "linker_config.h"
 
+#include "linker_config_compiled.h"
 #include "linker_globals.h"
 #include "linker_debug.h"
 #include "linker_utils.h"
@@ -41,132 +42,12 @@
 
 #include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <string>
 #include <unordered_map>
 
-class ConfigParser {
- public:
-  enum {
-    kPropertyAssign,
-    kPropertyAppend,
-    kSection,
-    kEndOfFile,
-    kError,
-  };
-
-  explicit ConfigParser(std::string&& content)
-      : content_(std::move(content)), p_(0), lineno_(0), was_end_of_file_(false) {}
-
-  /*
-   * Possible return values
-   * kPropertyAssign: name is set to property name and value is set to property value
-   * kPropertyAppend: same as kPropertyAssign, but the value should be appended
-   * kSection: name is set to section name.
-   * kEndOfFile: reached end of file.
-   * kError: error_msg is set.
-   */
-  int next_token(std::string* name, std::string* value, std::string* error_msg) {
-    std::string line;
-    while(NextLine(&line)) {
-      size_t found = line.find('#');
-      line = android::base::Trim(line.substr(0, found));
-
-      if (line.empty()) {
-        continue;
-      }
-
-      if (line[0] == '[' && line.back() == ']') {
-        *name = line.substr(1, line.size() - 2);
-        return kSection;
-      }
-
-      size_t found_assign = line.find('=');
-      size_t found_append = line.find("+=");
-      if (found_assign != std::string::npos && found_append == std::string::npos) {
-        *name = android::base::Trim(line.substr(0, found_assign));
-        *value = android::base::Trim(line.substr(found_assign + 1));
-        return kPropertyAssign;
-      }
-
-      if (found_append != std::string::npos) {
-        *name = android::base::Trim(line.substr(0, found_append));
-        *value = android::base::Trim(line.substr(found_append + 2));
-        return kPropertyAppend;
-      }
-
-      *error_msg = std::string("invalid format: ") +
-                   line +
-                   ", expected \"name = property\", \"name += property\", or \"[section]\"";
-      return kError;
-    }
-
-    // to avoid infinite cycles when programmer makes a mistake
-    CHECK(!was_end_of_file_);
-    was_end_of_file_ = true;
-    return kEndOfFile;
-  }
-
-  size_t lineno() const {
-    return lineno_;
-  }
-
- private:
-  bool NextLine(std::string* line) {
-    if (p_ == std::string::npos) {
-      return false;
-    }
-
-    size_t found = content_.find('\n', p_);
-    if (found != std::string::npos) {
-      *line = content_.substr(p_, found - p_);
-      p_ = found + 1;
-    } else {
-      *line = content_.substr(p_);
-      p_ = std::string::npos;
-    }
-
-    lineno_++;
-    return true;
-  }
-
-  std::string content_;
-  size_t p_;
-  size_t lineno_;
-  bool was_end_of_file_;
-
-  DISALLOW_IMPLICIT_CONSTRUCTORS(ConfigParser);
-};
-
-class PropertyValue {
- public:
-  PropertyValue() = default;
-
-  PropertyValue(std::string&& value, size_t lineno)
-    : value_(std::move(value)), lineno_(lineno) {}
-
-  const std::string& value() const {
-    return value_;
-  }
-
-  void append_value(std::string&& value) {
-    value_ = value_ + value;
-    // lineno isn't updated as we might have cases like this:
-    // property.x = blah
-    // property.y = blah
-    // property.x += blah
-  }
-
-  size_t lineno() const {
-    return lineno_;
-  }
-
- private:
-  std::string value_;
-  size_t lineno_;
-};
-
 static std::string create_error_msg(const char* file,
                                     size_t lineno,
                                     const std::string& msg) {
@@ -176,12 +57,17 @@ static std::string create_error_msg(const char* file,
   return std::string(buf);
 }
 
+static void print_warning(const char* ld_config_file_path,
+                          const CompiledConfig::Warning& warning) {
+  DL_WARN("%s:%zd: warning: %s", ld_config_file_path, warning.lineno, warning.message);
+}
+
 static bool parse_config_file(const char* ld_config_file_path,
                               const char* binary_realpath,
-                              std::unordered_map<std::string, PropertyValue>* properties,
+                              CompiledConfig* compiled,
+                              uint32_t* section,
                               std::string* error_msg) {
-  std::string content;
-  if (!android::base::ReadFileToString(ld_config_file_path, &content)) {
+  if (!compiled->load(ld_config_file_path)) {
     if (errno != ENOENT) {
       *error_msg = std::string("error reading file \"") +
                    ld_config_file_path + "\": " + strerror(errno);
@@ -189,158 +75,71 @@ static bool parse_config_file(const char* ld_config_file_path,
     return false;
   }
 
-  ConfigParser cp(std::move(content));
-
   std::string section_name;
+  size_t section_lineno = 0;
 
-  while (true) {
-    std::string name;
-    std::string value;
-    std::string error;
-
-    int result = cp.next_token(&name, &value, &error);
-    if (result == ConfigParser::kError) {
-      DL_WARN("%s:%zd: warning: couldn't parse %s (ignoring this line)",
-              ld_config_file_path,
-              cp.lineno(),
-              error.c_str());
-      continue;
-    }
-
-    if (result == ConfigParser::kSection || result == ConfigParser::kEndOfFile) {
-      return false;
-    }
+  for (size_t i = 0; i < compiled->dir_count(); ++i) {
+    CompiledConfig::Dir dir = compiled->dir(i);
 
-    if (result == ConfigParser::kPropertyAssign) {
-      if (!android::base::StartsWith(name, "dir.")) {
-        DL_WARN("%s:%zd: warning: unexpected property name \"%s\", "
-                "expected format dir.<section_name> (ignoring this line)",
-                ld_config_file_path,
-                cp.lineno(),
-                name.c_str());
+    // If the path can be resolved, resolve it
+    char buf[PATH_MAX];
+    std::string resolved_path;
+    if (access(dir.path, R_OK) != 0) {
+      if (errno == ENOENT) {
+        // no need to test for non-existing path. skip.
         continue;
       }
-
-      // remove trailing '/'
-      while (!value.empty() && value.back() == '/') {
-        value.pop_back();
-      }
-
-      if (value.empty()) {
-        DL_WARN("%s:%zd: warning: property value is empty (ignoring this line)",
-                ld_config_file_path,
-                cp.lineno());
-        continue;
-      }
-
-      // If the path can be resolved, resolve it
-      char buf[PATH_MAX];
-      std::string resolved_path;
-      if (access(value.c_str(), R_OK) != 0) {
-        if (errno == ENOENT) {
-          // no need to test for non-existing path. skip.
-          continue;
-        }
-        // If not accessible, don't call realpath as it will just cause
-        // SELinux denial spam. Use the path unresolved.
-        resolved_path = value;
-      } else if (realpath(value.c_str(), buf)) {
-        resolved_path = buf;
-      } else {
-        // realpath is expected to fail with EPERM in some situations, so log
-        // the failure with INFO rather than DL_WARN. e.g. A binary in
-        // /data/local/tmp may attempt to stat /postinstall. See
-        // http://b/120996057.
-        INFO("%s:%zd: warning: path \"%s\" couldn't be resolved: %m",
-             ld_config_file_path,
-             cp.lineno(),
-             value.c_str());
-        resolved_path = value;
-      }
-
-      if (file_is_under_dir(binary_realpath, resolved_path)) {
-        section_name = name.substr(4);
-        break;
-      }
+      // If not accessible, don't call realpath as it will just cause
+      // SELinux denial spam. Use the path unresolved.
+      resolved_path = dir.path;
+    } else if (realpath(dir.path, buf)) {
+      resolved_path = buf;
+    } else {
+      // realpath is expected to fail with EPERM in some situations, so log
+      // the failure with INFO rather than DL_WARN. e.g. A binary in
+      // /data/local/tmp may attempt to stat /postinstall. See
+      // http://b/120996057.
+      INFO("%s:%zd: warning: path \"%s\" couldn't be resolved: %m",
+           ld_config_file_path,
+           dir.lineno,
+           dir.path);
+      resolved_path = dir.path;
     }
-  }
-
-  INFO("[ Using config section \"%s\" ]", section_name.c_str());
 
-  // skip everything until we meet a correct section
-  while (true) {
-    std::string name;
-    std::string value;
-    std::string error;
-
-    int result = cp.next_token(&name, &value, &error);
-
-    if (result == ConfigParser::kSection && name == section_name) {
+    if (file_is_under_dir(binary_realpath, resolved_path)) {
+      section_name = dir.section;
+      section_lineno = dir.lineno;
       break;
     }
+  }
 
-    if (result == ConfigParser::kEndOfFile) {
-      *error_msg = create_error_msg(ld_config_file_path,
-                                    cp.lineno(),
-                                    std::string("section \"") + section_name + "\" not found");
-      return false;
+  // Report the same warnings the text parser did when it stopped at the matching "dir." line.
+  for (size_t i = 0; i < compiled->warning_count(); ++i) {
+    CompiledConfig::Warning warning = compiled->warning(i);
+    if (warning.section == CompiledConfig::kNoSection &&
+        (section_name.empty() || warning.lineno <= section_lineno)) {
+      print_warning(ld_config_file_path, warning);
     }
   }
 
-  // found the section - parse it
-  while (true) {
-    std::string name;
-    std::string value;
-    std::string error;
-
-    int result = cp.next_token(&name, &value, &error);
-
-    if (result == ConfigParser::kEndOfFile || result == ConfigParser::kSection) {
-      break;
-    }
+  if (section_name.empty()) {
+    return false;
+  }
 
-    if (result == ConfigParser::kPropertyAssign) {
-      if (properties->contains(name)) {
-        DL_WARN("%s:%zd: warning: redefining property \"%s\" (overriding previous value)",
-                ld_config_file_path,
-                cp.lineno(),
-                name.c_str());
-      }
+  INFO("[ Using config section \"%s\" ]", section_name.c_str());
 
-      (*properties)[name] = PropertyValue(std::move(value), cp.lineno());
-    } else if (result == ConfigParser::kPropertyAppend) {
-      if (!properties->contains(name)) {
-        DL_WARN("%s:%zd: warning: appending to undefined property \"%s\" (treating as assignment)",
-                ld_config_file_path,
-                cp.lineno(),
-                name.c_str());
-        (*properties)[name] = PropertyValue(std::move(value), cp.lineno());
-      } else {
-        if (android::base::EndsWith(name, ".links") ||
-            android::base::EndsWith(name, ".namespaces")) {
-          value = "," + value;
-          (*properties)[name].append_value(std::move(value));
-        } else if (android::base::EndsWith(name, ".paths") ||
-                   android::base::EndsWith(name, ".shared_libs") ||
-                   android::base::EndsWith(name, ".whitelisted") ||
-                   android::base::EndsWith(name, ".allowed_libs")) {
-          value = ":" + value;
-          (*properties)[name].append_value(std::move(value));
-        } else {
-          DL_WARN("%s:%zd: warning: += isn't allowed for property \"%s\" (ignoring)",
-                  ld_config_file_path,
-                  cp.lineno(),
-                  name.c_str());
-        }
-      }
-    }
+  *section = compiled->find_section(section_name.c_str());
+  if (*section == CompiledConfig::kNoSection) {
+    *error_msg = create_error_msg(ld_config_file_path,
+                                  compiled->line_count(),
+                                  std::string("section \"") + section_name + "\" not found");
+    return false;
+  }
 
-    if (result == ConfigParser::kError) {
-      DL_WARN("%s:%zd: warning: couldn't parse %s (ignoring this line)",
-              ld_config_file_path,
-              cp.lineno(),
-              error.c_str());
-      continue;
+  for (size_t i = 0; i < compiled->warning_count(); ++i) {
+    CompiledConfig::Warning warning = compiled->warning(i);
+    if (warning.section == *section) {
+      print_warning(ld_config_file_path, warning);
     }
   }
 
@@ -354,17 +153,17 @@ static constexpr const char* kPropertyAdditionalNamespaces = "additional.namespa
 
 class Properties {
  public:
-  explicit Properties(std::unordered_map<std::string, PropertyValue>&& properties)
-      : properties_(std::move(properties)), target_sdk_version_(__ANDROID_API__) {}
+  Properties(const CompiledConfig& compiled, uint32_t section)
+      : compiled_(compiled), section_(section), target_sdk_version_(__ANDROID_API__) {}
 
   std::vector<std::string> get_strings(const std::string& name, size_t* lineno = nullptr) const {
-    auto it = find_property(name, lineno);
-    if (it == properties_.end()) {
+    const char* value = find_property(name, lineno);
+    if (value == nullptr) {
       // return empty vector
       return std::vector<std::string>();
     }
 
-    std::vector<std::string> strings = android::base::Split(it->second.value(), ",");
+    std::vector<std::string> strings = android::base::Split(value, ",");
 
     for (size_t i = 0; i < strings.size(); ++i) {
       strings[i] = android::base::Trim(strings[i]);
@@ -374,17 +173,17 @@ class Properties {
   }
 
   bool get_bool(const std::string& name, size_t* lineno = nullptr) const {
-    auto it = find_property(name, lineno);
-    if (it == properties_.end()) {
+    const char* value = find_property(name, lineno);
+    if (value == nullptr) {
       return false;
     }
 
-    return it->second.value() == "true";
+    return strcmp(value, "true") == 0;
   }
 
   std::string get_string(const std::string& name, size_t* lineno = nullptr) const {
-    auto it = find_property(name, lineno);
-    return (it == properties_.end()) ? "" : it->second.value();
+    const char* value = find_property(name, lineno);
+    return (value == nullptr) ? "" : value;
   }
 
   std::vector<std::string> get_paths(const std::string& name, bool resolve, size_t* lineno = nullptr) {
@@ -440,16 +239,20 @@ class Properties {
   }
 
  private:
-  std::unordered_map<std::string, PropertyValue>::const_iterator
-  find_property(const std::string& name, size_t* lineno) const {
-    auto it = properties_.find(name);
-    if (it != properties_.end() && lineno != nullptr) {
-      *lineno = it->second.lineno();
+  const char* find_property(const std::string& name, size_t* lineno) const {
+    CompiledConfig::Property property;
+    if (!compiled_.find_property(section_, name.c_str(), &property)) {
+      return nullptr;
+    }
+
+    if (lineno != nullptr) {
+      *lineno = property.lineno;
     }
 
-    return it;
+    return property.value;
   }
-  std::unordered_map<std::string, PropertyValue> properties_;
+  const CompiledConfig& compiled_;
+  uint32_t section_;
   std::unordered_map<std::string, std::string> resolved_paths_;
   int target_sdk_version_;
 
@@ -464,12 +267,13 @@ bool Config::read_binary_config(const char* ld_config_file_path,
                                       std::string* error_msg) {
   g_config.clear();
 
-  std::unordered_map<std::string, PropertyValue> property_map;
-  if (!parse_config_file(ld_config_file_path, binary_realpath, &property_map, error_msg)) {
+  CompiledConfig compiled;
+  uint32_t section;
+  if (!parse_config_file(ld_config_file_path, binary_realpath, &compiled, &section, error_msg)) {
     return false;
   }
 
-  Properties properties(std::move(property_map));
+  Properties properties(compiled, section);
 
   auto failure_guard = android::base::make_scope_guard([] { g_config.clear(); });
 
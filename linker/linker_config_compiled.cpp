@@ -0,0 +1,620 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "linker_config_compiled.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <map>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/strings.h>
+
+#include "linker_debug.h"
+#include "linker_utils.h"
+
+namespace {
+
+constexpr uint32_t kCompiledConfigMagic = 0x43434c44;  // "LDCC"
+constexpr uint32_t kCompiledConfigVersion = 1;
+
+// An mtime within this many seconds of the cache's creation time might not reflect a later
+// write (filesystem timestamps can be coarse), so the contents are hashed too.
+constexpr int64_t kRacyMtimeSeconds = 2;
+
+struct DirRecord {
+  uint32_t section;
+  uint32_t path;
+  uint32_t lineno;
+};
+
+struct SectionRecord {
+  uint32_t name;
+  uint32_t first_property;
+  uint32_t property_count;
+};
+
+struct PropertyRecord {
+  uint32_t name;
+  uint32_t value;
+  uint32_t lineno;
+};
+
+struct WarningRecord {
+  uint32_t section;
+  uint32_t lineno;
+  uint32_t message;
+};
+
+uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ p[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+uint64_t hash_bytes(const void* data, size_t size) {
+  return fnv1a(0xcbf29ce484222325ULL, data, size);
+}
+
+class ConfigParser {
+ public:
+  enum {
+    kPropertyAssign,
+    kPropertyAppend,
+    kSection,
+    kEndOfFile,
+    kError,
+  };
+
+  explicit ConfigParser(std::string&& content)
+      : content_(std::move(content)), p_(0), lineno_(0), was_end_of_file_(false) {}
+
+  /*
+   * Possible return values
+   * kPropertyAssign: name is set to property name and value is set to property value
+   * kPropertyAppend: same as kPropertyAssign, but the value should be appended
+   * kSection: name is set to section name.
+   * kEndOfFile: reached end of file.
+   * kError: error_msg is set.
+   */
+  int next_token(std::string* name, std::string* value, std::string* error_msg) {
+    std::string line;
+    while(NextLine(&line)) {
+      size_t found = line.find('#');
+      line = android::base::Trim(line.substr(0, found));
+
+      if (line.empty()) {
+        continue;
+      }
+
+      if (line[0] == '[' && line.back() == ']') {
+        *name = line.substr(1, line.size() - 2);
+        return kSection;
+      }
+
+      size_t found_assign = line.find('=');
+      size_t found_append = line.find("+=");
+      if (found_assign != std::string::npos && found_append == std::string::npos) {
+        *name = android::base::Trim(line.substr(0, found_assign));
+        *value = android::base::Trim(line.substr(found_assign + 1));
+        return kPropertyAssign;
+      }
+
+      if (found_append != std::string::npos) {
+        *name = android::base::Trim(line.substr(0, found_append));
+        *value = android::base::Trim(line.substr(found_append + 2));
+        return kPropertyAppend;
+      }
+
+      *error_msg = std::string("invalid format: ") +
+                   line +
+                   ", expected \"name = property\", \"name += property\", or \"[section]\"";
+      return kError;
+    }
+
+    // to avoid infinite cycles when programmer makes a mistake
+    CHECK(!was_end_of_file_);
+    was_end_of_file_ = true;
+    return kEndOfFile;
+  }
+
+  size_t lineno() const {
+    return lineno_;
+  }
+
+ private:
+  bool NextLine(std::string* line) {
+    if (p_ == std::string::npos) {
+      return false;
+    }
+
+    size_t found = content_.find('\n', p_);
+    if (found != std::string::npos) {
+      *line = content_.substr(p_, found - p_);
+      p_ = found + 1;
+    } else {
+      *line = content_.substr(p_);
+      p_ = std::string::npos;
+    }
+
+    lineno_++;
+    return true;
+  }
+
+  std::string content_;
+  size_t p_;
+  size_t lineno_;
+  bool was_end_of_file_;
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(ConfigParser);
+};
+
+class PropertyValue {
+ public:
+  PropertyValue() = default;
+
+  PropertyValue(std::string&& value, size_t lineno)
+    : value_(std::move(value)), lineno_(lineno) {}
+
+  const std::string& value() const {
+    return value_;
+  }
+
+  void append_value(std::string&& value) {
+    value_ = value_ + value;
+    // lineno isn't updated as we might have cases like this:
+    // property.x = blah
+    // property.y = blah
+    // property.x += blah
+  }
+
+  size_t lineno() const {
+    return lineno_;
+  }
+
+ private:
+  std::string value_;
+  size_t lineno_;
+};
+
+}  // namespace
+
+// The records and then the strings follow the header, in this order.
+struct CompiledConfig::Header {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t source_dev;
+  uint64_t source_ino;
+  uint64_t source_size;
+  int64_t source_mtime_sec;
+  int64_t source_mtime_nsec;
+  uint64_t source_hash;
+  int64_t created_sec;
+  uint32_t line_count;
+  uint32_t dir_count;
+  uint32_t section_count;
+  uint32_t property_count;
+  uint32_t warning_count;
+  uint32_t strings_size;
+
+  const DirRecord* dirs() const { return reinterpret_cast<const DirRecord*>(this + 1); }
+  const SectionRecord* sections() const {
+    return reinterpret_cast<const SectionRecord*>(dirs() + dir_count);
+  }
+  const PropertyRecord* properties() const {
+    return reinterpret_cast<const PropertyRecord*>(sections() + section_count);
+  }
+  const WarningRecord* warnings() const {
+    return reinterpret_cast<const WarningRecord*>(properties() + property_count);
+  }
+  const char* strings() const { return reinterpret_cast<const char*>(warnings() + warning_count); }
+
+  size_t total_size() const {
+    return sizeof(*this) + dir_count * sizeof(DirRecord) + section_count * sizeof(SectionRecord) +
+           property_count * sizeof(PropertyRecord) + warning_count * sizeof(WarningRecord) +
+           strings_size;
+  }
+};
+
+std::string CompiledConfig::cache_directory_;
+
+void CompiledConfig::set_cache_directory(const char* path) {
+  cache_directory_ = (path != nullptr) ? path : "";
+}
+
+CompiledConfig::~CompiledConfig() {
+  if (map_start_ != nullptr) {
+    munmap(map_start_, map_size_);
+  }
+}
+
+void CompiledConfig::compile(const std::string& content) {
+  std::vector<DirRecord> dirs;
+  std::vector<SectionRecord> sections;
+  std::vector<PropertyRecord> properties;
+  std::vector<WarningRecord> warnings;
+  std::string strings;
+
+  auto add_string = [&strings](const std::string& s) {
+    uint32_t offset = strings.size();
+    strings.append(s);
+    strings.push_back('\0');
+    return offset;
+  };
+  auto warn = [&](uint32_t section, size_t lineno, const std::string& message) {
+    warnings.push_back({section, static_cast<uint32_t>(lineno), add_string(message)});
+  };
+
+  ConfigParser cp{std::string(content)};
+  std::string name;
+  std::string value;
+  std::string error;
+
+  // The "dir." properties come before the first section.
+  int result;
+  while (true) {
+    result = cp.next_token(&name, &value, &error);
+    if (result == ConfigParser::kSection || result == ConfigParser::kEndOfFile) {
+      break;
+    }
+
+    if (result == ConfigParser::kError) {
+      warn(kNoSection, cp.lineno(), "couldn't parse " + error + " (ignoring this line)");
+      continue;
+    }
+
+    if (result == ConfigParser::kPropertyAssign) {
+      if (!android::base::StartsWith(name, "dir.")) {
+        warn(kNoSection, cp.lineno(),
+             "unexpected property name \"" + name +
+                 "\", expected format dir.<section_name> (ignoring this line)");
+        continue;
+      }
+
+      // remove trailing '/'
+      while (!value.empty() && value.back() == '/') {
+        value.pop_back();
+      }
+
+      if (value.empty()) {
+        warn(kNoSection, cp.lineno(), "property value is empty (ignoring this line)");
+        continue;
+      }
+
+      dirs.push_back({add_string(name.substr(4)), add_string(value),
+                      static_cast<uint32_t>(cp.lineno())});
+    }
+  }
+
+  // Each section runs until the next one, or the end of the file.
+  while (result == ConfigParser::kSection) {
+    const uint32_t section = sections.size();
+    const std::string section_name = name;
+    std::map<std::string, PropertyValue> section_properties;
+
+    while (true) {
+      result = cp.next_token(&name, &value, &error);
+
+      if (result == ConfigParser::kEndOfFile || result == ConfigParser::kSection) {
+        break;
+      }
+
+      if (result == ConfigParser::kPropertyAssign) {
+        if (section_properties.contains(name)) {
+          warn(section, cp.lineno(),
+               "redefining property \"" + name + "\" (overriding previous value)");
+        }
+
+        section_properties[name] = PropertyValue(std::move(value), cp.lineno());
+      } else if (result == ConfigParser::kPropertyAppend) {
+        if (!section_properties.contains(name)) {
+          warn(section, cp.lineno(),
+               "appending to undefined property \"" + name + "\" (treating as assignment)");
+          section_properties[name] = PropertyValue(std::move(value), cp.lineno());
+        } else {
+          if (android::base::EndsWith(name, ".links") ||
+              android::base::EndsWith(name, ".namespaces")) {
+            value = "," + value;
+            section_properties[name].append_value(std::move(value));
+          } else if (android::base::EndsWith(name, ".paths") ||
+                     android::base::EndsWith(name, ".shared_libs") ||
+                     android::base::EndsWith(name, ".whitelisted") ||
+                     android::base::EndsWith(name, ".allowed_libs")) {
+            value = ":" + value;
+            section_properties[name].append_value(std::move(value));
+          } else {
+            warn(section, cp.lineno(),
+                 "+= isn't allowed for property \"" + name + "\" (ignoring)");
+          }
+        }
+      }
+
+      if (result == ConfigParser::kError) {
+        warn(section, cp.lineno(), "couldn't parse " + error + " (ignoring this line)");
+        continue;
+      }
+    }
+
+    // std::map keeps the names in strcmp() order, which find_property() relies on.
+    sections.push_back({add_string(section_name), static_cast<uint32_t>(properties.size()),
+                        static_cast<uint32_t>(section_properties.size())});
+    for (const auto& [property_name, property_value] : section_properties) {
+      properties.push_back({add_string(property_name), add_string(property_value.value()),
+                            static_cast<uint32_t>(property_value.lineno())});
+    }
+  }
+
+  // Keeps the records that follow the header aligned.
+  static_assert(sizeof(Header) % 8 == 0);
+  Header header = {};
+  header.magic = kCompiledConfigMagic;
+  header.version = kCompiledConfigVersion;
+  header.line_count = cp.lineno();
+  header.dir_count = dirs.size();
+  header.section_count = sections.size();
+  header.property_count = properties.size();
+  header.warning_count = warnings.size();
+  header.strings_size = strings.size();
+
+  compiled_.clear();
+  compiled_.reserve(header.total_size());
+  compiled_.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  compiled_.append(reinterpret_cast<const char*>(dirs.data()), dirs.size() * sizeof(DirRecord));
+  compiled_.append(reinterpret_cast<const char*>(sections.data()),
+                   sections.size() * sizeof(SectionRecord));
+  compiled_.append(reinterpret_cast<const char*>(properties.data()),
+                   properties.size() * sizeof(PropertyRecord));
+  compiled_.append(reinterpret_cast<const char*>(warnings.data()),
+                   warnings.size() * sizeof(WarningRecord));
+  compiled_.append(strings);
+  data_ = compiled_.data();
+}
+
+bool CompiledConfig::load(const char* path) {
+  int fd = TEMP_FAILURE_RETRY(open(path, O_RDONLY | O_CLOEXEC));
+  if (fd == -1) {
+    return false;
+  }
+
+  struct stat source_stat;
+  if (TEMP_FAILURE_RETRY(fstat(fd, &source_stat)) != 0) {
+    int saved_errno = errno;
+    close(fd);
+    errno = saved_errno;
+    return false;
+  }
+
+  std::string cache_path;
+  if (!cache_directory_.empty()) {
+    char name[48];
+    snprintf(name, sizeof(name), "/ld.config.%016" PRIx64 ".compiled",
+             hash_bytes(path, strlen(path)));
+    cache_path = cache_directory_ + name;
+    if (map_cache(cache_path, source_stat, fd)) {
+      close(fd);
+      DEBUG("[ using compiled config %s for %s ]", cache_path.c_str(), path);
+      return true;
+    }
+  }
+
+  std::string content;
+  if (lseek(fd, 0, SEEK_SET) == -1 || !android::base::ReadFdToString(fd, &content)) {
+    int saved_errno = errno;
+    close(fd);
+    errno = saved_errno;
+    return false;
+  }
+  close(fd);
+
+  compile(content);
+  if (!cache_path.empty()) {
+    write_cache(cache_path, source_stat, hash_bytes(content.data(), content.size()));
+  }
+  return true;
+}
+
+bool CompiledConfig::map_cache(const std::string& cache_path, const struct stat& source_stat,
+                               int source_fd) {
+  // The cache decides which libraries get loaded, so only files that nobody else can write are
+  // used.
+  struct stat cache_stat;
+  int fd = open_trusted_file(cache_path, &cache_stat);
+  if (fd == -1) {
+    if (errno != ENOENT) {
+      DEBUG("[ couldn't open compiled config %s: %m ]", cache_path.c_str());
+    }
+    return false;
+  }
+
+  if (static_cast<size_t>(cache_stat.st_size) < sizeof(Header)) {
+    close(fd);
+    return false;
+  }
+
+  size_t size = cache_stat.st_size;
+  void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+
+  data_ = static_cast<const char*>(map);
+  const Header* h = header();
+  bool valid = is_valid(size) &&
+               h->source_dev == static_cast<uint64_t>(source_stat.st_dev) &&
+               h->source_ino == static_cast<uint64_t>(source_stat.st_ino) &&
+               h->source_size == static_cast<uint64_t>(source_stat.st_size) &&
+               h->source_mtime_sec == source_stat.st_mtim.tv_sec &&
+               h->source_mtime_nsec == source_stat.st_mtim.tv_nsec;
+  bool racy = valid && source_stat.st_mtim.tv_sec + kRacyMtimeSeconds >= h->created_sec;
+  if (racy) {
+    std::string content;
+    valid = android::base::ReadFdToString(source_fd, &content) &&
+            hash_bytes(content.data(), content.size()) == h->source_hash;
+  }
+  if (!valid) {
+    DEBUG("[ ignoring stale or invalid compiled config %s ]", cache_path.c_str());
+    data_ = nullptr;
+    munmap(map, size);
+    return false;
+  }
+
+  map_start_ = map;
+  map_size_ = size;
+
+  // Once the source is old enough, rewrite the cache so that later processes can trust the mtime
+  // and skip reading the source.
+  timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  if (racy && source_stat.st_mtim.tv_sec + kRacyMtimeSeconds < now.tv_sec) {
+    compiled_.assign(data_, size);
+    write_cache(cache_path, source_stat, h->source_hash);
+    compiled_.clear();
+  }
+  return true;
+}
+
+void CompiledConfig::write_cache(const std::string& cache_path, const struct stat& source_stat,
+                                 uint64_t source_hash) {
+  Header* h = reinterpret_cast<Header*>(compiled_.data());
+  h->source_dev = source_stat.st_dev;
+  h->source_ino = source_stat.st_ino;
+  h->source_size = source_stat.st_size;
+  h->source_mtime_sec = source_stat.st_mtim.tv_sec;
+  h->source_mtime_nsec = source_stat.st_mtim.tv_nsec;
+  h->source_hash = source_hash;
+  timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  h->created_sec = now.tv_sec;
+
+  write_trusted_file(cache_path, compiled_.data(), compiled_.size());
+}
+
+// Even a trusted cache file is only believed as far as its structure goes: every count and string
+// offset has to stay inside the file.
+bool CompiledConfig::is_valid(size_t size) const {
+  const Header* h = header();
+  if (h->magic != kCompiledConfigMagic || h->version != kCompiledConfigVersion) return false;
+
+  // Guard total_size() against overflow before relying on it.
+  constexpr uint32_t kMaxCount = 1 << 24;
+  if (h->dir_count > kMaxCount || h->section_count > kMaxCount ||
+      h->property_count > kMaxCount || h->warning_count > kMaxCount ||
+      h->strings_size > size || h->strings_size == 0 || h->total_size() != size) {
+    return false;
+  }
+
+  const char* strings = h->strings();
+  if (strings[h->strings_size - 1] != '\0') return false;
+  auto valid_string = [h](uint32_t offset) { return offset < h->strings_size; };
+
+  for (size_t i = 0; i < h->dir_count; ++i) {
+    const DirRecord& r = h->dirs()[i];
+    if (!valid_string(r.section) || !valid_string(r.path)) return false;
+  }
+  for (size_t i = 0; i < h->section_count; ++i) {
+    const SectionRecord& r = h->sections()[i];
+    if (!valid_string(r.name) || r.first_property > h->property_count ||
+        r.property_count > h->property_count - r.first_property) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < h->property_count; ++i) {
+    const PropertyRecord& r = h->properties()[i];
+    if (!valid_string(r.name) || !valid_string(r.value)) return false;
+  }
+  for (size_t i = 0; i < h->warning_count; ++i) {
+    const WarningRecord& r = h->warnings()[i];
+    if ((r.section != kNoSection && r.section >= h->section_count) || !valid_string(r.message)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t CompiledConfig::line_count() const {
+  return header()->line_count;
+}
+
+size_t CompiledConfig::dir_count() const {
+  return header()->dir_count;
+}
+
+CompiledConfig::Dir CompiledConfig::dir(size_t i) const {
+  const DirRecord& r = header()->dirs()[i];
+  return {header()->strings() + r.section, header()->strings() + r.path, r.lineno};
+}
+
+uint32_t CompiledConfig::find_section(const char* name) const {
+  const Header* h = header();
+  for (uint32_t i = 0; i < h->section_count; ++i) {
+    if (strcmp(h->strings() + h->sections()[i].name, name) == 0) return i;
+  }
+  return kNoSection;
+}
+
+bool CompiledConfig::find_property(uint32_t section, const char* name,
+                                   Property* property) const {
+  const Header* h = header();
+  const SectionRecord& s = h->sections()[section];
+  const PropertyRecord* lo = h->properties() + s.first_property;
+  const PropertyRecord* hi = lo + s.property_count;
+  while (lo < hi) {
+    const PropertyRecord* mid = lo + (hi - lo) / 2;
+    int cmp = strcmp(h->strings() + mid->name, name);
+    if (cmp == 0) {
+      *property = {h->strings() + mid->value, mid->lineno};
+      return true;
+    }
+    if (cmp < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return false;
+}
+
+size_t CompiledConfig::warning_count() const {
+  return header()->warning_count;
+}
+
+CompiledConfig::Warning CompiledConfig::warning(size_t i) const {
+  const WarningRecord& r = header()->warnings()[i];
+  return {r.section, r.lineno, header()->strings() + r.message};
+}
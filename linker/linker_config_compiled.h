@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#include <string>
+
+#include <android-base/macros.h>
+
+// ld.config.txt in a flat form that is parsed once and then only looked up.
+//
+// compile() tokenizes the text with the same rules the linker has always used. It keeps the
+// "dir." properties before the first section, then every section's properties with any "+="
+// already applied. All strings live in one blob. A section's properties are sorted by name, so a
+// lookup is a binary search that allocates nothing. Warnings are recorded with the section they
+// came from, so a process only reports the ones for the section it uses.
+//
+// If LD_CONFIG_CACHE_DIR is set, load() writes the compiled bytes to a file there, and later
+// processes map that file read-only instead of reading the text. A cache file records the device,
+// inode, size and mtime of its source, and a hash of the source's contents. If the source was
+// modified too close to when the cache was written for its mtime to be trusted, the hash is
+// checked as well. Cache files that anyone other than root or this process's effective uid could
+// have written are ignored; see open_trusted_file().
+class CompiledConfig {
+ public:
+  static constexpr uint32_t kNoSection = UINT32_MAX;
+
+  struct Dir {
+    const char* section;
+    const char* path;
+    size_t lineno;
+  };
+
+  struct Property {
+    const char* value;
+    size_t lineno;
+  };
+
+  struct Warning {
+    // kNoSection for warnings about the "dir." properties.
+    uint32_t section;
+    size_t lineno;
+    const char* message;
+  };
+
+  CompiledConfig() = default;
+  ~CompiledConfig();
+
+  static void set_cache_directory(const char* path);
+
+  // Loads the config file at `path`, from the cache if it has a valid copy and otherwise by
+  // compiling the text (and caching the result). Returns false, with errno set, if the file
+  // can't be read.
+  bool load(const char* path);
+
+  void compile(const std::string& content);
+
+  bool from_cache() const { return map_start_ != nullptr; }
+
+  // The number of lines in the source.
+  size_t line_count() const;
+
+  size_t dir_count() const;
+  Dir dir(size_t i) const;
+
+  // Returns the first section called `name`, or kNoSection.
+  uint32_t find_section(const char* name) const;
+  bool find_property(uint32_t section, const char* name, Property* property) const;
+
+  size_t warning_count() const;
+  Warning warning(size_t i) const;
+
+ private:
+  struct Header;
+
+  const Header* header() const { return reinterpret_cast<const Header*>(data_); }
+  bool map_cache(const std::string& cache_path, const struct stat& source_stat, int source_fd);
+  void write_cache(const std::string& cache_path, const struct stat& source_stat,
+                   uint64_t source_hash);
+  bool is_valid(size_t size) const;
+
+  static std::string cache_directory_;
+
+  // Either compiled_ or the mapping of a cache file.
+  const char* data_ = nullptr;
+  std::string compiled_;
+  void* map_start_ = nullptr;
+  size_t map_size_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(CompiledConfig);
+};
@@ -26,13 +26,16 @@
  * SUCH DAMAGE.
  */
 
+#include <dirent.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <gtest/gtest.h>
 
 #include "linker_config.h"
+#include "linker_config_compiled.h"
 #include "linker_utils.h"
 
 #include <unistd.h>
@@ -40,6 +43,8 @@
 #include <android-base/file.h>
 #include <android-base/scopeguard.h>
 #include <android-base/stringprintf.h>
+#include <memory>
+#include <string>
 #include <vector>
 
 #if defined(__LP64__)
@@ -352,3 +357,115 @@ TEST(linker_config, dir_path_resolve) {
   ASSERT_TRUE(config != nullptr) << error_msg;
   ASSERT_TRUE(error_msg.empty()) << error_msg;
 }
+
+TEST(linker_config, compiled_config) {
+  CompiledConfig compiled;
+  compiled.compile(config_str);
+
+  ASSERT_EQ(1U, compiled.dir_count());
+  ASSERT_STREQ("test", compiled.dir(0).section);
+  ASSERT_STREQ("/data/local/tmp", compiled.dir(0).path);
+  ASSERT_EQ(2U, compiled.dir(0).lineno);
+
+  ASSERT_EQ(CompiledConfig::kNoSection, compiled.find_section("missing"));
+  uint32_t section = compiled.find_section("test");
+  ASSERT_NE(CompiledConfig::kNoSection, section);
+
+  CompiledConfig::Property property;
+  ASSERT_TRUE(compiled.find_property(section, "additional.namespaces", &property));
+  ASSERT_STREQ("system,vndk,vndk_in_system", property.value);
+  ASSERT_TRUE(compiled.find_property(section, "namespace.default.link.system.shared_libs",
+                                     &property));
+  ASSERT_STREQ("libc.so:libm.so:libdl.so:libstdc++.so", property.value);
+  ASSERT_TRUE(compiled.find_property(section, "namespace.vndk.isolated", &property));
+  ASSERT_STREQ("tr", property.value);
+  ASSERT_FALSE(compiled.find_property(section, "namespace.vndk.visible", &property));
+
+  // The ignored "+=" on namespace.vndk.isolated.
+  ASSERT_EQ(1U, compiled.warning_count());
+  ASSERT_EQ(section, compiled.warning(0).section);
+  ASSERT_EQ(37U, compiled.warning(0).lineno);
+}
+
+TEST(linker_config, compiled_config_cache) {
+  TemporaryDir cache_dir;
+  CompiledConfig::set_cache_directory(cache_dir.path);
+  auto cache_guard = android::base::make_scope_guard([] {
+    CompiledConfig::set_cache_directory(nullptr);
+  });
+
+  TemporaryFile tmp_file;
+  close(tmp_file.fd);
+  tmp_file.fd = -1;
+
+  ASSERT_TRUE(android::base::WriteStringToFile(config_str, tmp_file.path));
+
+  CompiledConfig first;
+  ASSERT_TRUE(first.load(tmp_file.path)) << strerror(errno);
+  ASSERT_FALSE(first.from_cache());
+
+  CompiledConfig second;
+  ASSERT_TRUE(second.load(tmp_file.path)) << strerror(errno);
+  ASSERT_TRUE(second.from_cache());
+
+  uint32_t section = second.find_section("test");
+  ASSERT_NE(CompiledConfig::kNoSection, section);
+  CompiledConfig::Property property;
+  ASSERT_TRUE(second.find_property(section, "additional.namespaces", &property));
+  ASSERT_STREQ("system,vndk,vndk_in_system", property.value);
+
+  // A changed source invalidates the cache.
+  ASSERT_TRUE(android::base::WriteStringToFile("dir.other = /data\n"
+                                               "[other]\n"
+                                               "additional.namespaces = sphal\n",
+                                               tmp_file.path));
+
+  CompiledConfig third;
+  ASSERT_TRUE(third.load(tmp_file.path)) << strerror(errno);
+  ASSERT_FALSE(third.from_cache());
+  ASSERT_EQ(CompiledConfig::kNoSection, third.find_section("test"));
+  section = third.find_section("other");
+  ASSERT_NE(CompiledConfig::kNoSection, section);
+  ASSERT_TRUE(third.find_property(section, "additional.namespaces", &property));
+  ASSERT_STREQ("sphal", property.value);
+}
+
+TEST(linker_config, compiled_config_cache_ignores_untrusted_files) {
+  TemporaryDir cache_dir;
+  CompiledConfig::set_cache_directory(cache_dir.path);
+  auto cache_guard = android::base::make_scope_guard([] {
+    CompiledConfig::set_cache_directory(nullptr);
+  });
+
+  TemporaryFile tmp_file;
+  close(tmp_file.fd);
+  tmp_file.fd = -1;
+
+  ASSERT_TRUE(android::base::WriteStringToFile(config_str, tmp_file.path));
+
+  CompiledConfig first;
+  ASSERT_TRUE(first.load(tmp_file.path)) << strerror(errno);
+  ASSERT_FALSE(first.from_cache());
+
+  // Let anyone write to the cache file.
+  std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(cache_dir.path), closedir);
+  ASSERT_TRUE(dir != nullptr);
+  size_t cache_files = 0;
+  while (dirent* e = readdir(dir.get())) {
+    if (e->d_name[0] == '.') continue;
+    std::string path = std::string(cache_dir.path) + "/" + e->d_name;
+    ASSERT_EQ(0, chmod(path.c_str(), 0666)) << strerror(errno);
+    ++cache_files;
+  }
+  ASSERT_EQ(1U, cache_files);
+
+  CompiledConfig second;
+  ASSERT_TRUE(second.load(tmp_file.path)) << strerror(errno);
+  ASSERT_FALSE(second.from_cache());
+  ASSERT_NE(CompiledConfig::kNoSection, second.find_section("test"));
+
+  // The untrusted file was replaced by a fresh one.
+  CompiledConfig third;
+  ASSERT_TRUE(third.load(tmp_file.path)) << strerror(errno);
+  ASSERT_TRUE(third.from_cache());
+}
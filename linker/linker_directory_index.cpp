@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "linker_directory_index.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+
+#include "linker_debug.h"
+#include "linker_gnu_hash.h"
+#include "linker_utils.h"
+
+// How recent a directory's mtime can be, relative to the time it was listed, before the listing
+// stops being trusted across load batches. Filesystem timestamps come from a coarse clock, so an
+// entry created just after the listing may leave the mtime unchanged.
+static constexpr time_t kRacyWindowSeconds = 2;
+
+static bool same_mtime(const timespec& a, const timespec& b) {
+  return a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec;
+}
+
+void DirectoryIndex::refresh(const std::string& dir, Entry* entry) {
+  struct stat sb;
+  if (stat(dir.c_str(), &sb) == -1) {
+    // Anything other than a missing path component might not stop an open() inside the
+    // directory, so don't claim to know.
+    entry->state = (errno == ENOENT || errno == ENOTDIR) ? State::kMissing : State::kUnlistable;
+    entry->dev = 0;
+    entry->ino = 0;
+    entry->hashes.clear();
+    return;
+  }
+  if (!S_ISDIR(sb.st_mode)) {
+    entry->state = State::kMissing;
+    entry->dev = 0;
+    entry->ino = 0;
+    entry->hashes.clear();
+    return;
+  }
+
+  // Don't try again to list a directory that couldn't be listed, unless it changed: in a
+  // directory that is searchable but not readable, each attempt would log another denial.
+  if ((entry->state == State::kUnlistable || (entry->state == State::kListed && !entry->racy)) &&
+      entry->dev == sb.st_dev && entry->ino == sb.st_ino && same_mtime(entry->mtime, sb.st_mtim)) {
+    return;
+  }
+
+  timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+
+  entry->dev = sb.st_dev;
+  entry->ino = sb.st_ino;
+  entry->mtime = sb.st_mtim;
+  entry->racy = sb.st_mtim.tv_sec + kRacyWindowSeconds >= now.tv_sec;
+  entry->hashes.clear();
+
+  DIR* d = opendir(dir.c_str());
+  if (d == nullptr) {
+    // A directory can be searchable without being readable.
+    entry->state = State::kUnlistable;
+    return;
+  }
+
+  errno = 0;
+  bool ok = true;
+  while (dirent* de = readdir(d)) {
+    if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) continue;
+    if (entry->hashes.size() == kMaxNamesPerDirectory) {
+      ok = false;
+      break;
+    }
+    entry->hashes.push_back(calculate_gnu_hash(de->d_name).first);
+  }
+  ok = ok && errno == 0;
+  closedir(d);
+
+  if (!ok) {
+    entry->state = State::kUnlistable;
+    entry->hashes.clear();
+    entry->hashes.shrink_to_fit();
+    return;
+  }
+
+  std::sort(entry->hashes.begin(), entry->hashes.end());
+  entry->state = State::kListed;
+  TRACE("[ indexed %zu entries in \"%s\" ]", entry->hashes.size(), dir.c_str());
+}
+
+bool DirectoryIndex::may_contain(const std::string& dir, const char* name) {
+  // Paths inside zip files and names with a directory component aren't indexed.
+  if (dir.find(kZipFileSeparator) != std::string::npos || strchr(name, '/') != nullptr) {
+    return true;
+  }
+
+  auto it = entries_.find(dir);
+  if (it == entries_.end()) {
+    if (entries_.size() >= kMaxDirectories) {
+      forget_unused_directories();
+      if (entries_.size() >= kMaxDirectories) return true;
+    }
+    it = entries_.emplace(dir, Entry()).first;
+  }
+
+  Entry& entry = it->second;
+  if (entry.validated_batch != batch_) {
+    refresh(dir, &entry);
+    entry.validated_batch = batch_;
+  }
+
+  switch (entry.state) {
+    case State::kMissing:
+      return false;
+    case State::kUnlistable:
+      return true;
+    case State::kListed:
+      return std::binary_search(entry.hashes.begin(), entry.hashes.end(),
+                                calculate_gnu_hash(name).first);
+  }
+  return true;
+}
+
+void DirectoryIndex::forget_unused_directories() {
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->second.validated_batch != batch_) {
+      it = entries_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+static DirectoryIndex g_directory_index;
+
+DirectoryIndex& get_directory_index() {
+  return g_directory_index;
+}
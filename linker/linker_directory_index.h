@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <android-base/macros.h>
+
+// An in-memory index of the file names in library search directories.
+//
+// Searching a namespace's path lists for a DT_NEEDED library tries open() in each directory in
+// turn, and each miss costs a failed path walk. The index lists every directory it is asked about
+// once, keeps the hashes of the names it found, and answers "might `name` be in `dir`" without a
+// syscall for the rest of the load batch. Across load batches a directory's snapshot is reused
+// as long as a stat() shows the same device, inode and mtime.
+//
+// Answers are conservative: a hash collision or an unlistable directory only means that open()
+// is tried as before. A snapshot taken in the same second that the directory was last modified
+// is not trusted beyond the current batch, since a later change might not move the mtime.
+//
+// A directory that can be searched but not read (or that is too large to be worth listing) isn't
+// listed again until it changes, so lookups in it go straight to open() without another denial.
+// The number of directories is bounded too: once the index is full, directories that weren't used
+// in the current batch are forgotten, and if that isn't enough, new directories aren't indexed.
+class DirectoryIndex {
+ public:
+  // The most directories the index keeps track of.
+  static constexpr size_t kMaxDirectories = 128;
+  // The most names a directory can have and still be listed.
+  static constexpr size_t kMaxNamesPerDirectory = 8192;
+
+  DirectoryIndex() = default;
+
+  // Marks the start of a new load batch. Directories are re-validated on their next use.
+  void begin_batch() { ++batch_; }
+
+  // Returns false only if `dir` definitely has no entry called `name`.
+  bool may_contain(const std::string& dir, const char* name);
+
+  size_t directory_count() const { return entries_.size(); }
+
+ private:
+  enum class State : uint8_t {
+    kMissing,     // the directory doesn't exist
+    kUnlistable,  // the directory couldn't be (or wasn't) listed; lookups fall through to open()
+    kListed,
+  };
+
+  struct Entry {
+    State state = State::kMissing;
+    bool racy = false;
+    uint64_t validated_batch = 0;
+    dev_t dev = 0;
+    ino_t ino = 0;
+    timespec mtime = {};
+    // Sorted GNU hashes of the directory's entries.
+    std::vector<uint32_t> hashes;
+  };
+
+  void refresh(const std::string& dir, Entry* entry);
+  void forget_unused_directories();
+
+  uint64_t batch_ = 1;
+  std::unordered_map<std::string, Entry> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(DirectoryIndex);
+};
+
+DirectoryIndex& get_directory_index();
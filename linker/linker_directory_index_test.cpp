@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <android-base/file.h>
+
+#include "linker_directory_index.h"
+
+static void touch(const std::string& path) {
+  ASSERT_TRUE(android::base::WriteStringToFile("", path)) << path;
+}
+
+TEST(linker_directory_index, listed_directory) {
+  TemporaryDir tmp;
+  touch(std::string(tmp.path) + "/libfoo.so");
+
+  DirectoryIndex index;
+  ASSERT_TRUE(index.may_contain(tmp.path, "libfoo.so"));
+  ASSERT_FALSE(index.may_contain(tmp.path, "libbar.so"));
+}
+
+TEST(linker_directory_index, missing_directory) {
+  TemporaryDir tmp;
+  std::string missing = std::string(tmp.path) + "/missing";
+  std::string not_a_dir = std::string(tmp.path) + "/file";
+  touch(not_a_dir);
+
+  DirectoryIndex index;
+  ASSERT_FALSE(index.may_contain(missing, "libfoo.so"));
+  ASSERT_FALSE(index.may_contain(not_a_dir, "libfoo.so"));
+}
+
+TEST(linker_directory_index, zip_paths_are_not_indexed) {
+  TemporaryDir tmp;
+  DirectoryIndex index;
+  ASSERT_TRUE(index.may_contain(std::string(tmp.path) + "/app.apk!/lib/arm64", "libfoo.so"));
+}
+
+TEST(linker_directory_index, snapshot_lasts_for_the_batch) {
+  TemporaryDir tmp;
+  DirectoryIndex index;
+  ASSERT_FALSE(index.may_contain(tmp.path, "libfoo.so"));
+
+  // Within a batch the snapshot is trusted, so a new file isn't seen...
+  touch(std::string(tmp.path) + "/libfoo.so");
+  ASSERT_FALSE(index.may_contain(tmp.path, "libfoo.so"));
+
+  // ...but the next batch revalidates the directory.
+  index.begin_batch();
+  ASSERT_TRUE(index.may_contain(tmp.path, "libfoo.so"));
+}
+
+TEST(linker_directory_index, recently_modified_directory_is_relisted) {
+  TemporaryDir tmp;
+  DirectoryIndex index;
+  ASSERT_FALSE(index.may_contain(tmp.path, "libfoo.so"));
+
+  // Replace the directory's contents without moving its mtime: the listing was taken just after
+  // the directory was created, so it must not be trusted across batches.
+  struct stat sb;
+  ASSERT_EQ(0, stat(tmp.path, &sb));
+  touch(std::string(tmp.path) + "/libfoo.so");
+  timespec times[2] = {sb.st_atim, sb.st_mtim};
+  ASSERT_EQ(0, utimensat(AT_FDCWD, tmp.path, times, 0));
+
+  index.begin_batch();
+  ASSERT_TRUE(index.may_contain(tmp.path, "libfoo.so"));
+}
+
+TEST(linker_directory_index, unreadable_directory_falls_back_to_probing) {
+  if (getuid() == 0) GTEST_SKIP() << "root can list any directory";
+
+  TemporaryDir tmp;
+  std::string dir = std::string(tmp.path) + "/dir";
+  ASSERT_EQ(0, mkdir(dir.c_str(), 0311));
+
+  DirectoryIndex index;
+  ASSERT_TRUE(index.may_contain(dir, "libfoo.so"));
+
+  // Making the directory readable doesn't move its mtime, so it isn't listed again...
+  ASSERT_EQ(0, chmod(dir.c_str(), 0755));
+  index.begin_batch();
+  ASSERT_TRUE(index.may_contain(dir, "libfoo.so"));
+
+  // ...until it's modified.
+  touch(dir + "/libbar.so");
+  index.begin_batch();
+  ASSERT_TRUE(index.may_contain(dir, "libbar.so"));
+  ASSERT_FALSE(index.may_contain(dir, "libfoo.so"));
+}
+
+TEST(linker_directory_index, large_directory_is_not_listed) {
+  TemporaryDir tmp;
+  for (size_t i = 0; i <= DirectoryIndex::kMaxNamesPerDirectory; ++i) {
+    touch(std::string(tmp.path) + "/lib" + std::to_string(i) + ".so");
+  }
+
+  DirectoryIndex index;
+  ASSERT_TRUE(index.may_contain(tmp.path, "libfoo.so"));
+}
+
+TEST(linker_directory_index, directory_count_is_bounded) {
+  TemporaryDir tmp;
+  DirectoryIndex index;
+  for (size_t i = 0; i < DirectoryIndex::kMaxDirectories; ++i) {
+    ASSERT_FALSE(index.may_contain(std::string(tmp.path) + "/missing" + std::to_string(i),
+                                   "libfoo.so"));
+  }
+  ASSERT_EQ(DirectoryIndex::kMaxDirectories, index.directory_count());
+
+  // Every directory was used in this batch, so a new one isn't indexed...
+  ASSERT_TRUE(index.may_contain(tmp.path, "libfoo.so"));
+  ASSERT_EQ(DirectoryIndex::kMaxDirectories, index.directory_count());
+
+  // ...but in the next batch the unused ones make room for it.
+  index.begin_batch();
+  ASSERT_FALSE(index.may_contain(tmp.path, "libfoo.so"));
+  ASSERT_EQ(1U, index.directory_count());
+}
@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "linker_dlopen_async.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "linker.h"
+#include "linker_globals.h"
+#include "linker_logger.h"
+#include "private/ScopedPthreadMutexLocker.h"
+#include "private/bionic_globals.h"
+
+// Enough for every plugin a process is likely to be loading at once.
+static constexpr size_t kMaxRequests = 32;
+
+// dlerror()'s buffer is no bigger than this.
+static constexpr size_t kMaxErrorLength = 512;
+
+enum RequestState {
+  kRequestFree,
+  kRequestQueued,
+  kRequestRunning,
+  // Complete, but notify_fd hasn't been written yet, so the request can't be released.
+  kRequestNotifying,
+  kRequestDone,
+};
+
+struct android_dlopen_async_request {
+  RequestState state;
+  // Queued requests are started in order of this.
+  uint64_t sequence;
+
+  char filename[PATH_MAX];
+  bool has_filename;
+  int flags;
+  android_dlextinfo extinfo;
+  bool has_extinfo;
+  const void* caller_addr;
+  int notify_fd;
+
+  void* handle;
+  char error[kMaxErrorLength];
+};
+
+static android_dlopen_async_request g_requests[kMaxRequests];
+static uint64_t g_next_sequence = 1;
+static bool g_worker_started = false;
+static bool g_fork_handlers_registered = false;
+
+// Protects everything above, and is never held while waiting for the loader lock.
+static pthread_mutex_t g_requests_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Signalled when a request is queued, for the worker.
+static pthread_cond_t g_queued_cond = PTHREAD_COND_INITIALIZER;
+// Broadcast when a request completes, for waiters.
+static pthread_cond_t g_done_cond = PTHREAD_COND_INITIALIZER;
+
+// Runs a request claimed by this thread (whose state is kRequestRunning).
+static void run_request(android_dlopen_async_request* request) {
+  void* handle;
+  {
+    ScopedDlExclusiveLock locker;
+    g_linker_logger.ResetState();
+    handle = do_dlopen(request->has_filename ? request->filename : nullptr, request->flags,
+                       request->has_extinfo ? &request->extinfo : nullptr, request->caller_addr);
+    if (handle == nullptr) {
+      strlcpy(request->error, linker_get_error_buffer(), sizeof(request->error));
+    }
+  }
+
+  int notify_fd;
+  {
+    ScopedPthreadMutexLocker locker(&g_requests_mutex);
+    request->handle = handle;
+    notify_fd = request->notify_fd;
+    if (notify_fd == -1) {
+      request->state = kRequestDone;
+      pthread_cond_broadcast(&g_done_cond);
+      return;
+    }
+    request->state = kRequestNotifying;
+  }
+
+  // The caller may close notify_fd as soon as the request is released, so write it first. The
+  // write can block (on a full pipe, say), so it's not done under the mutex.
+  uint64_t one = 1;
+  TEMP_FAILURE_RETRY(write(notify_fd, &one, sizeof(one)));
+
+  ScopedPthreadMutexLocker locker(&g_requests_mutex);
+  request->state = kRequestDone;
+  pthread_cond_broadcast(&g_done_cond);
+}
+
+// Returns the oldest queued request, claimed for this thread, waiting for one if there are none.
+static android_dlopen_async_request* claim_next_request() {
+  ScopedPthreadMutexLocker locker(&g_requests_mutex);
+  for (;;) {
+    android_dlopen_async_request* oldest = nullptr;
+    for (android_dlopen_async_request& request : g_requests) {
+      if (request.state == kRequestQueued &&
+          (oldest == nullptr || request.sequence < oldest->sequence)) {
+        oldest = &request;
+      }
+    }
+    if (oldest != nullptr) {
+      oldest->state = kRequestRunning;
+      return oldest;
+    }
+    pthread_cond_wait(&g_queued_cond, &g_requests_mutex);
+  }
+}
+
+static void* dlopen_async_worker_main(void*) {
+  for (;;) {
+    run_request(claim_next_request());
+  }
+  return nullptr;
+}
+
+// The worker isn't copied into a child process, and neither is any thread that was running a load
+// inline. The child fails whatever was outstanding, without writing notify_fd (which it shares
+// with the parent), and starts a new worker when it next queues a load.
+static void dlopen_async_before_fork() {
+  pthread_mutex_lock(&g_requests_mutex);
+}
+
+static void dlopen_async_after_fork_in_parent() {
+  pthread_mutex_unlock(&g_requests_mutex);
+}
+
+static void dlopen_async_after_fork_in_child() {
+  for (android_dlopen_async_request& request : g_requests) {
+    if (request.state != kRequestFree && request.state != kRequestDone) {
+      request.handle = nullptr;
+      strlcpy(request.error, "the process forked before the load completed",
+              sizeof(request.error));
+      request.state = kRequestDone;
+    }
+  }
+  g_worker_started = false;
+  pthread_mutex_unlock(&g_requests_mutex);
+}
+
+android_dlopen_async_request* dlopen_async_start(const char* filename, int flags,
+                                                 const android_dlextinfo* extinfo, int notify_fd,
+                                                 const void* caller_addr, const char** error) {
+  if (filename != nullptr && strlen(filename) >= PATH_MAX) {
+    *error = "library name too long";
+    return nullptr;
+  }
+
+  ScopedPthreadMutexLocker locker(&g_requests_mutex);
+
+  if (!g_worker_started) {
+    const libc_shared_globals* globals = __libc_shared_globals();
+    if (!g_fork_handlers_registered) {
+      if (globals->pthread_atfork_hook == nullptr ||
+          globals->pthread_atfork_hook(dlopen_async_before_fork, dlopen_async_after_fork_in_parent,
+                                       dlopen_async_after_fork_in_child) != 0) {
+        *error = "couldn't register the dlopen worker's fork handlers";
+        return nullptr;
+      }
+      g_fork_handlers_registered = true;
+    }
+
+    // The worker thread lives for the rest of the process, so it's never joined.
+    pthread_t thread;
+    if (globals->pthread_create_hook == nullptr ||
+        globals->pthread_create_hook(&thread, nullptr, dlopen_async_worker_main, nullptr) != 0) {
+      *error = "couldn't start the dlopen worker thread";
+      return nullptr;
+    }
+    g_worker_started = true;
+  }
+
+  android_dlopen_async_request* request = nullptr;
+  for (android_dlopen_async_request& candidate : g_requests) {
+    if (candidate.state == kRequestFree) {
+      request = &candidate;
+      break;
+    }
+  }
+  if (request == nullptr) {
+    *error = "too many outstanding requests";
+    return nullptr;
+  }
+
+  request->sequence = g_next_sequence++;
+  request->has_filename = filename != nullptr;
+  if (filename != nullptr) strlcpy(request->filename, filename, sizeof(request->filename));
+  request->flags = flags;
+  request->has_extinfo = extinfo != nullptr;
+  if (extinfo != nullptr) request->extinfo = *extinfo;
+  request->caller_addr = caller_addr;
+  request->notify_fd = notify_fd;
+  request->handle = nullptr;
+  request->error[0] = '\0';
+  request->state = kRequestQueued;
+  pthread_cond_signal(&g_queued_cond);
+  return request;
+}
+
+bool dlopen_async_is_done(android_dlopen_async_request* request) {
+  ScopedPthreadMutexLocker locker(&g_requests_mutex);
+  return request->state == kRequestNotifying || request->state == kRequestDone;
+}
+
+void* dlopen_async_wait(android_dlopen_async_request* request, char* error, size_t error_size) {
+  bool run_here = false;
+  {
+    ScopedPthreadMutexLocker locker(&g_requests_mutex);
+    if (request->state == kRequestQueued) {
+      // Don't wait for the worker: it may be busy with an earlier request, and it would never get
+      // the loader lock if this is a constructor calling back into the loader.
+      request->state = kRequestRunning;
+      run_here = true;
+    }
+  }
+  if (run_here) run_request(request);
+
+  ScopedPthreadMutexLocker locker(&g_requests_mutex);
+  if (request->state == kRequestFree) {
+    strlcpy(error, "invalid request (already waited for?)", error_size);
+    return nullptr;
+  }
+  if (request->state == kRequestRunning && dl_lock_is_held_exclusively()) {
+    // The worker is waiting for the loader lock that this thread holds.
+    strlcpy(error, "can't wait for a load in progress while holding the loader lock", error_size);
+    return nullptr;
+  }
+  while (request->state != kRequestDone) {
+    pthread_cond_wait(&g_done_cond, &g_requests_mutex);
+  }
+
+  void* handle = request->handle;
+  if (handle == nullptr) strlcpy(error, request->error, error_size);
+  request->state = kRequestFree;
+  return handle;
+}
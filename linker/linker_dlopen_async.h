@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <android/dlext.h>
+
+// Asynchronous dlopen(): android_dlopen_async() queues a load and returns at once, and the load
+// (including the constructors, which run in the usual order) happens on a worker thread created
+// from libc.so's pthread_create(), under the loader lock like any other dlopen(). Queued loads
+// run one at a time, in the order they were queued.
+//
+// Requests live in a fixed table rather than on the linker heap, which can only be used under
+// the loader lock, so that starting, polling and waiting never wait for a load in progress.
+
+struct android_dlopen_async_request;
+
+// Queues a load. `filename`, `flags`, `extinfo` and `caller_addr` are as for do_dlopen(), and
+// are copied. If `notify_fd` isn't -1, an 8-byte 1 is written to it (an eventfd, say) when the
+// load completes, before the request can be released. Returns null, and sets `error`, if the
+// request can't be queued. After fork(), the child fails whatever was outstanding.
+android_dlopen_async_request* dlopen_async_start(const char* filename, int flags,
+                                                 const android_dlextinfo* extinfo, int notify_fd,
+                                                 const void* caller_addr, const char** error);
+
+// Returns true if the load has completed, successfully or not.
+bool dlopen_async_is_done(android_dlopen_async_request* request);
+
+// Waits for the load to complete, running it on this thread if the worker hasn't started it yet,
+// and releases the request. Returns the handle, or null with the error copied into `error`. A
+// thread holding the loader lock (a constructor, say) can't wait for a load the worker has
+// started: that fails without releasing the request.
+void* dlopen_async_wait(android_dlopen_async_request* request, char* error, size_t error_size);
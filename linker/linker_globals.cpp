@@ -29,6 +29,9 @@
 #include "linker.h"
 #include "linker_globals.h"
 #include "linker_namespaces.h"
+#include "linker_parallel_link.h"
+
+#include <bionic/pthread_internal.h>
 
 #include "android-base/stringprintf.h"
 
@@ -45,10 +48,23 @@ platform_properties g_platform_properties;
 static char __linker_dl_err_buf[768];
 
 char* linker_get_error_buffer() {
+  char* worker_buffer = parallel_relocation_error_buffer();
+  if (__predict_false(worker_buffer != nullptr)) {
+    return worker_buffer;
+  }
+  // Concurrent shared holders of the loader lock (dlsym etc.) each report errors in a buffer of
+  // their own. No exclusive holder can be running while there are any.
+  if (dl_lock_has_shared_holders()) {
+    char* shared_buffer = __get_thread()->dl_shared_error_buffer;
+    if (shared_buffer != nullptr) return shared_buffer;
+  }
   return &__linker_dl_err_buf[0];
 }
 
 size_t linker_get_error_buffer_size() {
+  if (parallel_relocation_error_buffer() == nullptr && dl_lock_has_shared_holders()) {
+    return ScopedDlSharedLock::kErrorBufferSize;
+  }
   return sizeof(__linker_dl_err_buf);
 }
 
@@ -34,6 +34,7 @@
 #include <string>
 #include <unordered_map>
 
+#include <android-base/macros.h>
 #include <async_safe/log.h>
 
 #define DL_ERR(fmt, x...) \
@@ -91,6 +92,12 @@ extern platform_properties g_platform_properties;
 char* linker_get_error_buffer();
 size_t linker_get_error_buffer_size();
 
+// Serializes the linker heap while helper threads or concurrent readers of the loader state are
+// running (implemented in linker_memory.cpp). Calls nest: locking stays enabled until every
+// enable has been matched by a disable.
+void linker_allocator_enable_locking();
+void linker_allocator_disable_locking();
+
 class DlErrorRestorer {
  public:
   DlErrorRestorer() {
@@ -104,4 +111,91 @@ class DlErrorRestorer {
 };
 
 __LIBC_HIDDEN__ extern bool g_is_ldd;
-__LIBC_HIDDEN__ extern pthread_mutex_t g_dl_mutex;
+
+// The loader lock (implemented in dlfcn.cpp).
+//
+// Entry points that load or unload libraries, or that can run arbitrary code (constructors,
+// callbacks), hold it exclusively. Read-only lookups such as dlsym() and dladdr() share it, so
+// they run concurrently with each other and only wait for an exclusive holder. A thread that
+// holds the lock exclusively may re-enter the loader in either mode. A shared holder may
+// re-enter it shared, which nests without touching the rwlock, but can't take it exclusively:
+// the lookups that run IFUNC resolvers let go of it while they do (see ScopedDlSharedUnlock), so
+// that a resolver can call dlopen(). Taking it exclusively from a shared section that can't be
+// released, such as a signal handler that interrupted one, is a fatal error rather than a
+// deadlock.
+// dl_iterate_phdr() usually doesn't take it at all: it reads a snapshot that the exclusive holder
+// publishes when it releases the lock.
+//
+// dl_lock_init() must be called before any other thread could take the lock.
+void dl_lock_init();
+void dl_lock_exclusive();
+void dl_unlock_exclusive();
+
+// True if the calling thread holds the lock exclusively.
+bool dl_lock_is_held_exclusively();
+
+// Returns false if the calling thread already holds the lock exclusively, in which case the
+// caller already has all the access it needs and must not call dl_unlock_shared().
+bool dl_lock_shared();
+void dl_unlock_shared();
+
+// Releases the lock if the calling thread holds it shared at the outermost level, and returns
+// whether it did. dl_resume_shared() takes it back.
+bool dl_suspend_shared();
+void dl_resume_shared();
+
+// Sets where linker_get_error_buffer() points while the calling thread holds the lock shared, and
+// returns the previous buffer.
+char* dl_set_shared_error_buffer(char* buffer);
+
+// True while any thread holds the lock shared. No exclusive holder can be running then.
+bool dl_lock_has_shared_holders();
+
+class ScopedDlExclusiveLock {
+ public:
+  ScopedDlExclusiveLock() { dl_lock_exclusive(); }
+  ~ScopedDlExclusiveLock() { dl_unlock_exclusive(); }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ScopedDlExclusiveLock);
+};
+
+class ScopedDlSharedLock {
+ public:
+  static constexpr size_t kErrorBufferSize = 512;
+
+  ScopedDlSharedLock() : counted_(dl_lock_shared()) {
+    if (counted_) saved_error_buffer_ = dl_set_shared_error_buffer(error_buffer_);
+  }
+  ~ScopedDlSharedLock() {
+    if (counted_) {
+      dl_set_shared_error_buffer(saved_error_buffer_);
+      dl_unlock_shared();
+    }
+  }
+
+ private:
+  const bool counted_;
+  // Errors are formatted here rather than in the thread's dlerror() buffer, which may still hold
+  // an earlier error that the caller hasn't read.
+  char error_buffer_[kErrorBufferSize];
+  char* saved_error_buffer_ = nullptr;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedDlSharedLock);
+};
+
+// Lets go of a shared hold on the lock while the calling thread runs caller code that may need it
+// exclusively. Anything found while the lock was held must be assumed stale afterwards, unless
+// the caller's own references keep it alive. Does nothing for exclusive holders.
+class ScopedDlSharedUnlock {
+ public:
+  ScopedDlSharedUnlock() : suspended_(dl_suspend_shared()) {}
+  ~ScopedDlSharedUnlock() {
+    if (suspended_) dl_resume_shared();
+  }
+
+ private:
+  const bool suspended_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedDlSharedUnlock);
+};
@@ -28,6 +28,8 @@
 
 #pragma once
 
+#include <link.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include <utility>
@@ -38,10 +40,20 @@
 #define USE_GNU_HASH_NEON 0
 #endif
 
+#if defined(__x86_64__)
+#define USE_GNU_HASH_SSE 1
+#else
+#define USE_GNU_HASH_SSE 0
+#endif
+
 #if USE_GNU_HASH_NEON
 #include "arch/arm_neon/linker_gnu_hash_neon.h"
 #endif
 
+#if USE_GNU_HASH_SSE
+#include "arch/x86_64/linker_gnu_hash_sse.h"
+#endif
+
 __attribute__((unused))
 static std::pair<uint32_t, uint32_t> calculate_gnu_hash_simple(const char* name) {
   uint32_t h = 5381;
@@ -56,7 +68,40 @@ static std::pair<uint32_t, uint32_t> calculate_gnu_hash_simple(const char* name)
 static inline std::pair<uint32_t, uint32_t> calculate_gnu_hash(const char* name) {
 #if USE_GNU_HASH_NEON
   return calculate_gnu_hash_neon(name);
+#elif USE_GNU_HASH_SSE
+  return calculate_gnu_hash_sse(name);
 #else
   return calculate_gnu_hash_simple(name);
 #endif
 }
+
+// The number of libraries whose DT_GNU_HASH Bloom filters gnu_bloom_filter_probe checks at once.
+static constexpr size_t kGnuBloomProbeBatchSize = 4;
+
+// Checks the Bloom filters of `count` (at most kGnuBloomProbeBatchSize) consecutive libraries for
+// a symbol hash, and returns a bitmask with bit i set if libs[i] may define the symbol. Both hash
+// bits are tested with a single mask and no branches, so the filter word loads for the whole
+// batch can be in flight together instead of being serialized behind a branch per library.
+template <typename LookupLib>
+static inline uint32_t gnu_bloom_filter_probe(const LookupLib* libs, size_t count, uint32_t hash) {
+  constexpr uint32_t kBloomMaskBits = sizeof(ElfW(Addr)) * 8;
+  const uint32_t word_index = hash / kBloomMaskBits;
+  const ElfW(Addr) h1_bit = static_cast<ElfW(Addr)>(1) << (hash % kBloomMaskBits);
+  auto probe = [&](size_t i) -> uint32_t {
+    const LookupLib& lib = libs[i];
+    const ElfW(Addr) bloom_word = lib.gnu_bloom_filter_[word_index & lib.gnu_maskwords_];
+    const ElfW(Addr) mask =
+        h1_bit | (static_cast<ElfW(Addr)>(1) << ((hash >> lib.gnu_shift2_) % kBloomMaskBits));
+    return static_cast<uint32_t>((bloom_word & mask) == mask) << i;
+  };
+
+  if (count == kGnuBloomProbeBatchSize) {
+    static_assert(kGnuBloomProbeBatchSize == 4);
+    return probe(0) | probe(1) | probe(2) | probe(3);
+  }
+  uint32_t result = 0;
+  for (size_t i = 0; i < count; ++i) {
+    result |= probe(i);
+  }
+  return result;
+}
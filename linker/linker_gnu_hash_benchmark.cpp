@@ -28,6 +28,9 @@
 
 #include <benchmark/benchmark.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "linker_gnu_hash.h"
 
 // 250 symbols from the relocations of system/lib/libhwbinder.so in aosp/master, aosp_walleye.
@@ -308,4 +311,99 @@ BENCHMARK(BM_gnu_hash_neon);
 
 #endif  // USE_GNU_HASH_NEON
 
+#if USE_GNU_HASH_SSE
+
+static void BM_gnu_hash_sse(benchmark::State& state) {
+  for (auto _ : state) {
+    for (const char* sym_name : kSampleSymbolList) {
+      benchmark::DoNotOptimize(calculate_gnu_hash_sse(sym_name));
+    }
+  }
+}
+
+BENCHMARK(BM_gnu_hash_sse);
+
+#endif  // USE_GNU_HASH_SSE
+
+// A lookup list of libraries whose Bloom filters each define a few of the sample symbols, so that
+// most probes miss, as they do when resolving a symbol against a long global group.
+struct BloomBenchLib {
+  uint32_t gnu_maskwords_;
+  uint32_t gnu_shift2_;
+  ElfW(Addr)* gnu_bloom_filter_;
+};
+
+class BloomBenchLookupList {
+ public:
+  explicit BloomBenchLookupList(size_t lib_count) : words_(lib_count * kWordsPerLib) {
+    constexpr uint32_t kBloomMaskBits = sizeof(ElfW(Addr)) * 8;
+    constexpr size_t kSymbolCount = sizeof(kSampleSymbolList) / sizeof(kSampleSymbolList[0]);
+    for (size_t i = 0; i < lib_count; ++i) {
+      const uint32_t shift2 = 5 + i % 8;
+      libs_.push_back({ kWordsPerLib - 1, shift2, &words_[i * kWordsPerLib] });
+    }
+    for (size_t i = 0; i < kSymbolCount; i += 7) {
+      BloomBenchLib& lib = libs_[i % lib_count];
+      const uint32_t hash = calculate_gnu_hash_simple(kSampleSymbolList[i]).first;
+      ElfW(Addr)& word = lib.gnu_bloom_filter_[(hash / kBloomMaskBits) & lib.gnu_maskwords_];
+      word |= static_cast<ElfW(Addr)>(1) << (hash % kBloomMaskBits);
+      word |= static_cast<ElfW(Addr)>(1) << ((hash >> lib.gnu_shift2_) % kBloomMaskBits);
+    }
+    for (const char* sym_name : kSampleSymbolList) {
+      hashes_.push_back(calculate_gnu_hash_simple(sym_name).first);
+    }
+  }
+
+  const std::vector<BloomBenchLib>& libs() const { return libs_; }
+  const std::vector<uint32_t>& hashes() const { return hashes_; }
+
+ private:
+  static constexpr uint32_t kWordsPerLib = 16;
+  std::vector<ElfW(Addr)> words_;
+  std::vector<BloomBenchLib> libs_;
+  std::vector<uint32_t> hashes_;
+};
+
+// Count the Bloom filter matches one library at a time, the way soinfo_do_lookup's general path
+// does.
+static void BM_gnu_bloom_probe_each(benchmark::State& state) {
+  constexpr uint32_t kBloomMaskBits = sizeof(ElfW(Addr)) * 8;
+  BloomBenchLookupList list(state.range(0));
+  for (auto _ : state) {
+    size_t matches = 0;
+    for (uint32_t hash : list.hashes()) {
+      for (const BloomBenchLib& lib : list.libs()) {
+        const uint32_t word_num = (hash / kBloomMaskBits) & lib.gnu_maskwords_;
+        const ElfW(Addr) bloom_word = lib.gnu_bloom_filter_[word_num];
+        const uint32_t h1 = hash % kBloomMaskBits;
+        const uint32_t h2 = (hash >> lib.gnu_shift2_) % kBloomMaskBits;
+        if ((1 & (bloom_word >> h1) & (bloom_word >> h2)) == 1) {
+          ++matches;
+        }
+      }
+    }
+    benchmark::DoNotOptimize(matches);
+  }
+}
+
+BENCHMARK(BM_gnu_bloom_probe_each)->Arg(8)->Arg(32)->Arg(128);
+
+static void BM_gnu_bloom_probe_batched(benchmark::State& state) {
+  BloomBenchLookupList list(state.range(0));
+  const BloomBenchLib* begin = list.libs().data();
+  const BloomBenchLib* end = begin + list.libs().size();
+  for (auto _ : state) {
+    size_t matches = 0;
+    for (uint32_t hash : list.hashes()) {
+      for (const BloomBenchLib* it = begin; it != end; it += kGnuBloomProbeBatchSize) {
+        const size_t count = std::min<size_t>(end - it, kGnuBloomProbeBatchSize);
+        matches += __builtin_popcount(gnu_bloom_filter_probe(it, count, hash));
+      }
+    }
+    benchmark::DoNotOptimize(matches);
+  }
+}
+
+BENCHMARK(BM_gnu_bloom_probe_batched)->Arg(8)->Arg(32)->Arg(128);
+
 BENCHMARK_MAIN();
@@ -28,6 +28,8 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include "linker_gnu_hash.h"
 
 TEST(linker_gnu_hash, compare_neon_to_simple) {
@@ -57,3 +59,75 @@ TEST(linker_gnu_hash, compare_neon_to_simple) {
   GTEST_SKIP() << "This test is only implemented on arm/arm64";
 #endif
 }
+
+TEST(linker_gnu_hash, compare_sse_to_simple) {
+#if USE_GNU_HASH_SSE
+  auto check_input = [&](const char* name) {
+    auto expected = calculate_gnu_hash_simple(name);
+    auto actual = calculate_gnu_hash_sse(name);
+    EXPECT_EQ(expected.first, actual.first) << name;
+    EXPECT_EQ(expected.second, actual.second) << name;
+  };
+
+  __attribute__((aligned(16))) const char test1[] = "abcdefghijklmnopqrstuvwxyz0123456789\0ABCD";
+  for (size_t i = 0; i < sizeof(test1) - 1; ++i) {
+    check_input(&test1[i]);
+  }
+
+  __attribute__((aligned(16))) const char test2[] = "abcdefghijklmnop\0qrstuvwxyz0123456789ABCD";
+  for (size_t i = 0; i < sizeof(test2) - 1; ++i) {
+    check_input(&test2[i]);
+  }
+
+  __attribute__((aligned(16))) const char test3[] =
+      "\xff\x80\x7f\x01" "abcdefghijklmnopqrstu\0vwxyz";
+  for (size_t i = 0; i < sizeof(test3) - 1; ++i) {
+    check_input(&test3[i]);
+  }
+#else
+  GTEST_SKIP() << "This test is only implemented on x86_64";
+#endif
+}
+
+namespace {
+
+struct TestBloomLib {
+  uint32_t gnu_maskwords_;
+  uint32_t gnu_shift2_;
+  ElfW(Addr)* gnu_bloom_filter_;
+};
+
+constexpr uint32_t kBloomMaskBits = sizeof(ElfW(Addr)) * 8;
+
+void add_to_bloom_filter(TestBloomLib* lib, uint32_t hash) {
+  ElfW(Addr)& word = lib->gnu_bloom_filter_[(hash / kBloomMaskBits) & lib->gnu_maskwords_];
+  word |= static_cast<ElfW(Addr)>(1) << (hash % kBloomMaskBits);
+  word |= static_cast<ElfW(Addr)>(1) << ((hash >> lib->gnu_shift2_) % kBloomMaskBits);
+}
+
+}  // namespace
+
+TEST(linker_gnu_hash, bloom_filter_probe) {
+  std::vector<ElfW(Addr)> words(kGnuBloomProbeBatchSize * 4);
+  TestBloomLib libs[kGnuBloomProbeBatchSize];
+  for (size_t i = 0; i < kGnuBloomProbeBatchSize; ++i) {
+    libs[i] = { 3, static_cast<uint32_t>(6 + i), &words[i * 4] };
+  }
+
+  const uint32_t hash = calculate_gnu_hash("android_dlopen_ext").first;
+  EXPECT_EQ(0U, gnu_bloom_filter_probe(libs, kGnuBloomProbeBatchSize, hash));
+
+  add_to_bloom_filter(&libs[1], hash);
+  add_to_bloom_filter(&libs[3], hash);
+  EXPECT_EQ(0b1010U, gnu_bloom_filter_probe(libs, kGnuBloomProbeBatchSize, hash));
+
+  // Only the first `count` libraries are probed.
+  EXPECT_EQ(0b10U, gnu_bloom_filter_probe(libs, 2, hash));
+  EXPECT_EQ(0U, gnu_bloom_filter_probe(libs + 2, 1, hash));
+
+  // A match requires both bits to be set.
+  const uint32_t h1 = hash % kBloomMaskBits;
+  const uint32_t h2 = (hash >> libs[0].gnu_shift2_) % kBloomMaskBits;
+  libs[0].gnu_bloom_filter_[(hash / kBloomMaskBits) & 3] = static_cast<ElfW(Addr)>(1) << h1;
+  EXPECT_EQ(h1 == h2, (gnu_bloom_filter_probe(libs, 1, hash) & 1) != 0);
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <elf.h>
+#include <link.h>
+#include <string.h>
+
+#include <iterator>
+
+#include <gtest/gtest.h>
+
+#include "linker_phdr.h"
+
+#include "platform/bionic/page.h"
+#include "private/bionic_asm_note.h"
+
+// The same PMD size that the linker uses: one page table's worth of pages.
+static size_t PmdSize() {
+  return (page_size() / sizeof(uint64_t)) * page_size();
+}
+
+static ElfW(Phdr) MakeLoad(ElfW(Word) flags, ElfW(Addr) vaddr, size_t filesz) {
+  ElfW(Phdr) phdr = {};
+  phdr.p_type = PT_LOAD;
+  phdr.p_flags = flags;
+  phdr.p_vaddr = vaddr;
+  phdr.p_filesz = filesz;
+  phdr.p_memsz = filesz;
+  return phdr;
+}
+
+TEST(linker_hugepage_text, aligned_segment) {
+  const size_t pmd = PmdSize();
+  ElfW(Phdr) phdr = MakeLoad(PF_R | PF_X, pmd, 2 * pmd);
+  ElfW(Addr) start, end;
+  ASSERT_TRUE(phdr_get_hugepage_text_range(&phdr, 0, &start, &end));
+  ASSERT_EQ(pmd, start);
+  ASSERT_EQ(3 * pmd, end);
+}
+
+TEST(linker_hugepage_text, unaligned_segment_is_rounded_inwards) {
+  const size_t pmd = PmdSize();
+  ElfW(Phdr) phdr = MakeLoad(PF_R | PF_X, pmd / 2, 3 * pmd);
+  ElfW(Addr) start, end;
+  ASSERT_TRUE(phdr_get_hugepage_text_range(&phdr, 0, &start, &end));
+  ASSERT_EQ(pmd, start);
+  ASSERT_EQ(3 * pmd, end);
+}
+
+TEST(linker_hugepage_text, load_bias) {
+  const size_t pmd = PmdSize();
+  ElfW(Phdr) phdr = MakeLoad(PF_R | PF_X, pmd / 2, 2 * pmd);
+  ElfW(Addr) start, end;
+  // With this bias the segment becomes PMD-aligned, so the whole of it can be promoted.
+  ASSERT_TRUE(phdr_get_hugepage_text_range(&phdr, 8 * pmd + pmd / 2, &start, &end));
+  ASSERT_EQ(9 * pmd, start);
+  ASSERT_EQ(11 * pmd, end);
+}
+
+TEST(linker_hugepage_text, bss_is_not_promoted) {
+  const size_t pmd = PmdSize();
+  ElfW(Phdr) phdr = MakeLoad(PF_R | PF_X, pmd, pmd + page_size());
+  phdr.p_memsz = 4 * pmd;
+  ElfW(Addr) start, end;
+  ASSERT_TRUE(phdr_get_hugepage_text_range(&phdr, 0, &start, &end));
+  ASSERT_EQ(pmd, start);
+  ASSERT_EQ(2 * pmd, end);
+}
+
+TEST(linker_hugepage_text, small_segments_are_skipped) {
+  const size_t pmd = PmdSize();
+  ElfW(Addr) start, end;
+
+  ElfW(Phdr) phdr = MakeLoad(PF_R | PF_X, pmd, pmd - page_size());
+  ASSERT_FALSE(phdr_get_hugepage_text_range(&phdr, 0, &start, &end));
+
+  // Bigger than a PMD, but it doesn't contain a whole aligned one.
+  phdr = MakeLoad(PF_R | PF_X, pmd / 2, pmd + page_size());
+  ASSERT_FALSE(phdr_get_hugepage_text_range(&phdr, 0, &start, &end));
+}
+
+TEST(linker_hugepage_text, only_read_only_text_is_promoted) {
+  const size_t pmd = PmdSize();
+  ElfW(Addr) start, end;
+
+  ElfW(Phdr) phdr = MakeLoad(PF_R, pmd, 2 * pmd);
+  ASSERT_FALSE(phdr_get_hugepage_text_range(&phdr, 0, &start, &end));
+
+  phdr = MakeLoad(PF_R | PF_W, pmd, 2 * pmd);
+  ASSERT_FALSE(phdr_get_hugepage_text_range(&phdr, 0, &start, &end));
+
+  phdr = MakeLoad(PF_R | PF_W | PF_X, pmd, 2 * pmd);
+  ASSERT_FALSE(phdr_get_hugepage_text_range(&phdr, 0, &start, &end));
+
+  phdr = MakeLoad(PF_R | PF_X, pmd, 2 * pmd);
+  phdr.p_type = PT_GNU_RELRO;
+  ASSERT_FALSE(phdr_get_hugepage_text_range(&phdr, 0, &start, &end));
+}
+
+TEST(linker_hugepage_text, collapse_skips_non_text_segments) {
+  const size_t pmd = PmdSize();
+  ElfW(Phdr) phdrs[] = {
+    MakeLoad(PF_R, pmd, 2 * pmd),
+    MakeLoad(PF_R | PF_X, pmd, pmd / 2),
+    MakeLoad(PF_R | PF_W | PF_X, pmd, 2 * pmd),
+  };
+  // None of these are candidates, so nothing is madvise()d.
+  ASSERT_EQ(0U, phdr_table_collapse_text_segments(phdrs, std::size(phdrs), 0, "test"));
+}
+
+// An Android ELF note: the header, the name "Android" padded to 8 bytes, and a one-word value.
+struct HugepageTextNote {
+  ElfW(Nhdr) header;
+  char name[8];
+  ElfW(Word) value;
+};
+
+static bool HasHugepageTextNote(const HugepageTextNote& note) {
+  ElfW(Phdr) phdrs[2] = {};
+  phdrs[0] = MakeLoad(PF_R | PF_X, 0, 0);
+  phdrs[1].p_type = PT_NOTE;
+  phdrs[1].p_vaddr = reinterpret_cast<ElfW(Addr)>(&note);
+  phdrs[1].p_memsz = sizeof(note);
+  return phdr_table_has_hugepage_text_note(phdrs, std::size(phdrs), 0);
+}
+
+static HugepageTextNote MakeHugepageTextNote(ElfW(Word) value) {
+  HugepageTextNote note = {};
+  note.header.n_namesz = strlen("Android") + 1;
+  note.header.n_descsz = sizeof(ElfW(Word));
+  note.header.n_type = NT_ANDROID_TYPE_HUGEPAGE_TEXT;
+  memcpy(note.name, "Android", note.header.n_namesz);
+  note.value = value;
+  return note;
+}
+
+TEST(linker_hugepage_text, note) {
+  ASSERT_TRUE(HasHugepageTextNote(MakeHugepageTextNote(1)));
+}
+
+TEST(linker_hugepage_text, note_with_other_value) {
+  ASSERT_FALSE(HasHugepageTextNote(MakeHugepageTextNote(0)));
+  ASSERT_FALSE(HasHugepageTextNote(MakeHugepageTextNote(2)));
+}
+
+TEST(linker_hugepage_text, note_with_wrong_size) {
+  HugepageTextNote note = MakeHugepageTextNote(1);
+  note.header.n_descsz = 2;
+  ASSERT_FALSE(HasHugepageTextNote(note));
+}
+
+TEST(linker_hugepage_text, note_of_other_type) {
+  HugepageTextNote note = MakeHugepageTextNote(1);
+  note.header.n_type = NT_ANDROID_TYPE_MEMTAG;
+  ASSERT_FALSE(HasHugepageTextNote(note));
+}
+
+TEST(linker_hugepage_text, no_note) {
+  ElfW(Phdr) phdr = MakeLoad(PF_R | PF_X, 0, 0);
+  ASSERT_FALSE(phdr_table_has_hugepage_text_note(&phdr, 1, 0));
+}
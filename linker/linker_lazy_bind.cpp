@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "linker_lazy_bind.h"
+
+#include <elf.h>
+#include <pthread.h>
+
+#include <memory>
+
+#include <async_safe/log.h>
+
+#include "linker.h"
+#include "linker_debug.h"
+#include "linker_globals.h"
+#include "linker_namespaces.h"
+#include "linker_relocs.h"
+#include "linker_soinfo.h"
+#include "platform/bionic/page.h"
+#include "private/ErrnoRestorer.h"
+#include "private/ScopedPthreadMutexLocker.h"
+
+// Everything needed to resolve the PLT slots of a lazily bound library after it was linked. It's
+// allocated while the library is relocated, when its soinfo is still writable.
+struct LazyBindState {
+  VersionTracker version_tracker;
+
+  // Binding only holds the loader lock shared, so threads binding slots of the same library are
+  // serialized here instead. The lookup list and its symbol cache aren't safe to share otherwise.
+  pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+  // The libraries searched for symbols, rebuilt whenever a library has been loaded or unloaded
+  // since it was last used.
+  std::unique_ptr<SymbolLookupList> lookup_list;
+  uint64_t lookup_list_generation = 0;
+};
+
+void free_lazy_bind_state(LazyBindState* state) {
+  delete state;
+}
+
+#if defined(__aarch64__) || defined(__x86_64__)
+static bool is_in_relro(const soinfo* si, ElfW(Addr) addr) {
+  for (size_t i = 0; i < si->phnum; ++i) {
+    const ElfW(Phdr)* phdr = &si->phdr[i];
+    if (phdr->p_type != PT_GNU_RELRO) {
+      continue;
+    }
+    const ElfW(Addr) start = page_start(phdr->p_vaddr) + si->load_bias;
+    const ElfW(Addr) end = page_end(phdr->p_vaddr + phdr->p_memsz) + si->load_bias;
+    if (addr >= start && addr < end) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool soinfo::can_bind_lazily() const {
+  if (plt_got_ == nullptr || plt_rela_ == nullptr || plt_rela_count_ == 0) {
+    return false;
+  }
+  if (primary_namespace_ == nullptr || !primary_namespace_->is_lazy_binding_enabled()) {
+    return false;
+  }
+  if (has_bind_now_ || (get_dt_flags_1() & DF_1_NOW) != 0 || (rtld_flags_ & RTLD_NOW) != 0) {
+    return false;
+  }
+  if (is_linker() || is_main_executable() || should_pad_segments_) {
+    return false;
+  }
+
+  // The slots are written long after RELRO has been applied, so every one of them (and the
+  // reserved entries) must be outside of it. Otherwise, fall back to binding eagerly.
+  if (is_in_relro(this, reinterpret_cast<ElfW(Addr)>(plt_got_ + 1)) ||
+      is_in_relro(this, reinterpret_cast<ElfW(Addr)>(plt_got_ + 2))) {
+    return false;
+  }
+  for (size_t i = 0; i < plt_rela_count_; ++i) {
+    const ElfW(Rela)& reloc = plt_rela_[i];
+    if (ELFW(R_TYPE)(reloc.r_info) == R_GENERIC_JUMP_SLOT &&
+        is_in_relro(this, reloc.r_offset + load_bias)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool soinfo::prepare_lazy_binding() {
+  std::unique_ptr<LazyBindState> state(new LazyBindState);
+  if (!state->version_tracker.init(this)) {
+    return false;
+  }
+
+  free_lazy_bind_state(lazy_bind_state_);
+  lazy_bind_state_ = state.release();
+
+  plt_got_[1] = reinterpret_cast<ElfW(Addr)>(this);
+  plt_got_[2] = reinterpret_cast<ElfW(Addr)>(&__linker_lazy_bind_trampoline);
+  return true;
+}
+
+ElfW(Addr) soinfo::bind_lazy_plt_slot(size_t reloc_index) {
+  LazyBindState* state = lazy_bind_state_;
+  CHECK(state != nullptr);
+
+#if defined(__aarch64__)
+  // The arm64 PLT only tells us which GOT slot is being bound. The JUMP_SLOT relocations are
+  // normally in the same order as the slots, but search for the right one if they aren't.
+  const ElfW(Addr) slot = reinterpret_cast<ElfW(Addr)>(plt_got_ + kLazyBindReservedGotEntries +
+                                                       reloc_index);
+  if (reloc_index >= plt_rela_count_ || plt_rela_[reloc_index].r_offset + load_bias != slot) {
+    for (reloc_index = 0; reloc_index < plt_rela_count_; ++reloc_index) {
+      if (plt_rela_[reloc_index].r_offset + load_bias == slot) break;
+    }
+  }
+#endif
+  if (reloc_index >= plt_rela_count_ ||
+      ELFW(R_TYPE)(plt_rela_[reloc_index].r_info) != R_GENERIC_JUMP_SLOT) {
+    async_safe_fatal("\"%s\": invalid lazy binding request for PLT relocation %zu",
+                     get_realpath(), reloc_index);
+  }
+
+  const ElfW(Rela)& reloc = plt_rela_[reloc_index];
+  const ElfW(Word) r_sym = ELFW(R_SYM)(reloc.r_info);
+  const char* sym_name = get_string(symtab_[r_sym].st_name);
+
+  const version_info* vi = nullptr;
+  if (!lookup_version_info(state->version_tracker, r_sym, sym_name, &vi)) {
+    async_safe_fatal("\"%s\": %s", get_realpath(), linker_get_error_buffer());
+  }
+
+  soinfo* found_in = nullptr;
+  const ElfW(Sym)* sym;
+  {
+    ScopedPthreadMutexLocker locker(&state->mutex);
+    const uint64_t generation = get_module_generation();
+    if (state->lookup_list == nullptr || state->lookup_list_generation != generation) {
+      state->lookup_list = create_lookup_list_for(this);
+      state->lookup_list_generation = generation;
+    }
+    sym = soinfo_do_lookup(sym_name, vi, &found_in, *state->lookup_list);
+  }
+
+  // Not under the mutex: an IFUNC resolver may call through this library's own lazy slots.
+  ElfW(Addr) sym_addr = 0;
+  if (sym != nullptr) {
+    sym_addr = found_in->resolve_symbol_address(sym);
+  } else if (ELF_ST_BIND(symtab_[r_sym].st_info) != STB_WEAK) {
+    async_safe_fatal("cannot locate symbol \"%s\" referenced by \"%s\"...",
+                     sym_name, get_realpath());
+  }
+
+  const ElfW(Addr) value = sym_addr + reloc.r_addend;
+  TRACE("[ lazily bound %s in \"%s\" to %p ]", sym_name, get_realpath(),
+        reinterpret_cast<void*>(value));
+
+  // Other threads may be calling through the same slot. They either see the old value and come
+  // here too (and store the same value), or see the new one.
+  __atomic_store_n(reinterpret_cast<ElfW(Addr)*>(reloc.r_offset + load_bias), value,
+                   __ATOMIC_RELEASE);
+  return value;
+}
+
+extern "C" ElfW(Addr) __linker_lazy_bind(soinfo* si, size_t reloc_index) {
+  // The caller is in the middle of a call and expects errno to be left alone.
+  ErrnoRestorer errno_restorer;
+  // Libraries can't be loaded or unloaded while this is held, which is all the lookup needs. The
+  // lock is re-entrant, so a constructor run by dlopen() can call through its own lazy slots.
+  ScopedDlSharedLock locker;
+  return si->bind_lazy_plt_slot(reloc_index);
+}
+#else
+bool soinfo::can_bind_lazily() const {
+  return false;
+}
+
+bool soinfo::prepare_lazy_binding() {
+  async_safe_fatal("lazy binding is not supported on this architecture");
+}
+
+ElfW(Addr) soinfo::bind_lazy_plt_slot(size_t) {
+  async_safe_fatal("lazy binding is not supported on this architecture");
+}
+#endif
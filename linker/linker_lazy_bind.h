@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <link.h>
+#include <stddef.h>
+
+struct soinfo;
+struct LazyBindState;
+
+// Lazy PLT binding for libraries loaded into a namespace created with
+// ANDROID_NAMESPACE_TYPE_LAZY_BINDING.
+//
+// The JUMP_SLOT relocations of such a library are not resolved at load time. Instead, each
+// .got.plt slot keeps pointing back into the PLT (plus the load bias), and GOT[1] and GOT[2] are
+// set to the soinfo and to __linker_lazy_bind_trampoline. The first call through a PLT entry
+// reaches the trampoline via PLT0, which saves the argument registers and calls
+// __linker_lazy_bind() to look up the symbol and patch the slot, then jumps to the target.
+//
+// Binding takes the loader lock shared, so it can run concurrently with dlsym() and with other
+// bindings, and from constructors on the thread that is running dlopen(). It still waits for a
+// dlopen() or dlclose() in progress on another thread, so a constructor must not wait for another
+// thread that makes its first call through a lazily bound PLT entry.
+
+// The number of reserved entries at the start of .got.plt: GOT[0] is the address of _DYNAMIC,
+// GOT[1] and GOT[2] are filled in by the dynamic linker.
+static constexpr size_t kLazyBindReservedGotEntries = 3;
+
+// Entry point from PLT0, implemented in arch/<arch>/lazy_bind_trampoline.S.
+extern "C" void __linker_lazy_bind_trampoline();
+
+// Called by __linker_lazy_bind_trampoline. On x86_64, reloc_index is the index pushed by the PLT
+// entry; on arm64, it's the index of the GOT slot after the reserved entries. Returns the address
+// of the function to call. Aborts if a non-weak symbol can't be resolved.
+extern "C" ElfW(Addr) __linker_lazy_bind(soinfo* si, size_t reloc_index);
+
+void free_lazy_bind_state(LazyBindState* state);
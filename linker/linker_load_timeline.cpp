@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "linker_load_timeline.h"
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <async_safe/log.h>
+
+#include "linker_debug.h"
+#include "private/ScopedPthreadMutexLocker.h"
+
+// Enough for every phase of a few thousand libraries. Later phases are dropped (and counted).
+static constexpr size_t kMaxRecords = 16384;
+
+static const char* const kPhaseNames[ANDROID_DL_LOAD_PHASE_COUNT] = {
+  "open", "read", "reserve", "load_segments", "prelink", "link", "relro", "constructors",
+};
+
+namespace {
+
+struct Record {
+  std::string library;
+  int phase;
+  pid_t tid;
+  uint64_t start_ns;
+  uint64_t wall_ns;
+  uint64_t cpu_ns;
+};
+
+}  // anonymous namespace
+
+std::atomic<bool> g_load_timeline_enabled(false);
+
+// Phases can finish concurrently on relocation helper threads.
+static pthread_mutex_t g_records_mutex = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<Record> g_records;
+static size_t g_dropped_records = 0;
+
+static uint64_t now_ns(clockid_t clock) {
+  timespec ts;
+  clock_gettime(clock, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void load_timeline_set_enabled(bool enabled) {
+  g_load_timeline_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void LoadPhaseTimer::start() {
+  start_wall_ns_ = now_ns(CLOCK_MONOTONIC);
+  start_cpu_ns_ = now_ns(CLOCK_THREAD_CPUTIME_ID);
+}
+
+void LoadPhaseTimer::record(const char* library, int phase) {
+  uint64_t wall_ns = now_ns(CLOCK_MONOTONIC) - start_wall_ns_;
+  uint64_t cpu_ns = now_ns(CLOCK_THREAD_CPUTIME_ID) - start_cpu_ns_;
+
+  ScopedPthreadMutexLocker locker(&g_records_mutex);
+  if (g_records.size() >= kMaxRecords) {
+    ++g_dropped_records;
+    return;
+  }
+  g_records.push_back({library, phase, gettid(), start_wall_ns_, wall_ns, cpu_ns});
+}
+
+int load_timeline_iterate(int (*cb)(const android_dl_load_phase_info* info, void* data),
+                          void* data) {
+  // The callback may load libraries, so it mustn't run with the mutex held.
+  std::vector<Record> records;
+  {
+    ScopedPthreadMutexLocker locker(&g_records_mutex);
+    records = g_records;
+  }
+
+  int rv = 0;
+  for (const Record& record : records) {
+    android_dl_load_phase_info info = {
+      .library = record.library.c_str(),
+      .phase = record.phase,
+      .phase_name = kPhaseNames[record.phase],
+      .tid = record.tid,
+      .start_ns = record.start_ns,
+      .wall_ns = record.wall_ns,
+      .cpu_ns = record.cpu_ns,
+    };
+    rv = cb(&info, data);
+    if (rv != 0) break;
+  }
+  return rv;
+}
+
+// Library paths are the only strings that need escaping.
+static std::string json_escape(const std::string& s) {
+  std::string result;
+  for (char ch : s) {
+    if (ch == '"' || ch == '\\') {
+      result += '\\';
+      result += ch;
+    } else if (static_cast<unsigned char>(ch) < 0x20) {
+      char buf[8];
+      async_safe_format_buffer(buf, sizeof(buf), "\\u%04x", ch);
+      result += buf;
+    } else {
+      result += ch;
+    }
+  }
+  return result;
+}
+
+bool load_timeline_write_json(const char* path) {
+  int fd = TEMP_FAILURE_RETRY(open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+  if (fd == -1) {
+    PRINT("unable to open load timeline file \"%s\": %m", path);
+    return false;
+  }
+
+  ScopedPthreadMutexLocker locker(&g_records_mutex);
+  pid_t pid = getpid();
+  // Trace event timestamps are in microseconds. Complete ("X") events carry their own duration.
+  async_safe_format_fd(fd, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+  for (size_t i = 0; i < g_records.size(); ++i) {
+    const Record& record = g_records[i];
+    async_safe_format_fd(fd,
+                         "%s\n{\"name\":\"%s\",\"cat\":\"linker\",\"ph\":\"X\",\"pid\":%d,"
+                         "\"tid\":%d,\"ts\":%" PRIu64 ".%03" PRIu64 ",\"dur\":%" PRIu64
+                         ".%03" PRIu64 ",\"args\":{\"library\":\"%s\",\"cpu_ns\":%" PRIu64 "}}",
+                         i == 0 ? "" : ",", kPhaseNames[record.phase], pid, record.tid,
+                         record.start_ns / 1000, record.start_ns % 1000, record.wall_ns / 1000,
+                         record.wall_ns % 1000, json_escape(record.library).c_str(),
+                         record.cpu_ns);
+  }
+  async_safe_format_fd(fd, "\n],\"otherData\":{\"dropped_records\":%zu}}\n",
+                       g_dropped_records);
+  close(fd);
+  return true;
+}
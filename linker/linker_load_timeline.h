@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include <android-base/macros.h>
+
+#include "private/bionic_dl_load_timeline.h"
+
+// Records how long each phase of loading each library takes, so startup regressions can be
+// pinned on a library (and a phase) instead of on the process as a whole.
+//
+// Recording is off by default and costs a relaxed load per phase then. It is turned on by
+// LD_LOAD_TIMELINE, which also names a file that the timeline is written to, as Chrome trace
+// event JSON (which Perfetto and chrome://tracing import), once the executable's own libraries
+// have been loaded. At runtime it can be turned on, and read, with
+// android_dl_set_load_timeline_enabled() and android_dl_iterate_load_timeline().
+
+extern std::atomic<bool> g_load_timeline_enabled;
+
+void load_timeline_set_enabled(bool enabled);
+
+// Measures one phase. start() and finish() do nothing if recording is off when start() runs.
+class LoadPhaseTimer {
+ public:
+  LoadPhaseTimer() {
+    if (g_load_timeline_enabled.load(std::memory_order_relaxed)) start();
+  }
+
+  void finish(const char* library, int phase) {
+    if (start_wall_ns_ != 0) record(library, phase);
+  }
+
+ private:
+  void start();
+  void record(const char* library, int phase);
+
+  uint64_t start_wall_ns_ = 0;
+  uint64_t start_cpu_ns_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(LoadPhaseTimer);
+};
+
+// Measures a phase that lasts until the end of the enclosing scope, whether it succeeds or not.
+class ScopedLoadPhase {
+ public:
+  ScopedLoadPhase(const char* library, int phase) : library_(library), phase_(phase) {}
+  ~ScopedLoadPhase() { timer_.finish(library_, phase_); }
+
+ private:
+  LoadPhaseTimer timer_;
+  const char* library_;
+  int phase_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedLoadPhase);
+};
+
+// Calls `cb` on each recorded phase, in the order the phases finished, until it returns non-zero.
+// Returns the last value `cb` returned, or 0.
+int load_timeline_iterate(int (*cb)(const android_dl_load_phase_info* info, void* data),
+                          void* data);
+
+// Writes the timeline to `path` as a Chrome trace event JSON object.
+bool load_timeline_write_json(const char* path);
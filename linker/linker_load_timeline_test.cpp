@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <android-base/file.h>
+
+#include "linker_load_timeline.h"
+
+struct Phase {
+  std::string library;
+  std::string phase_name;
+  int phase;
+};
+
+static std::vector<Phase> get_timeline() {
+  std::vector<Phase> result;
+  load_timeline_iterate([](const android_dl_load_phase_info* info, void* data) {
+    static_cast<std::vector<Phase>*>(data)->push_back({info->library, info->phase_name,
+                                                       info->phase});
+    return 0;
+  }, &result);
+  return result;
+}
+
+TEST(linker_load_timeline, disabled) {
+  load_timeline_set_enabled(false);
+  size_t count = get_timeline().size();
+  { ScopedLoadPhase phase("/system/lib64/libdisabled.so", ANDROID_DL_LOAD_PHASE_LINK); }
+  ASSERT_EQ(count, get_timeline().size());
+}
+
+TEST(linker_load_timeline, records_phases) {
+  load_timeline_set_enabled(true);
+  { ScopedLoadPhase phase("/system/lib64/libfoo.so", ANDROID_DL_LOAD_PHASE_PRELINK); }
+  LoadPhaseTimer timer;
+  timer.finish("/system/lib64/libbar.so", ANDROID_DL_LOAD_PHASE_CONSTRUCTORS);
+  load_timeline_set_enabled(false);
+
+  std::vector<Phase> timeline = get_timeline();
+  ASSERT_GE(timeline.size(), 2U);
+  const Phase& foo = timeline[timeline.size() - 2];
+  ASSERT_EQ("/system/lib64/libfoo.so", foo.library);
+  ASSERT_EQ(ANDROID_DL_LOAD_PHASE_PRELINK, foo.phase);
+  ASSERT_EQ("prelink", foo.phase_name);
+  const Phase& bar = timeline.back();
+  ASSERT_EQ("/system/lib64/libbar.so", bar.library);
+  ASSERT_EQ("constructors", bar.phase_name);
+}
+
+TEST(linker_load_timeline, iterate_stops) {
+  load_timeline_set_enabled(true);
+  { ScopedLoadPhase phase("/system/lib64/libfoo.so", ANDROID_DL_LOAD_PHASE_OPEN); }
+  { ScopedLoadPhase phase("/system/lib64/libfoo.so", ANDROID_DL_LOAD_PHASE_READ); }
+  load_timeline_set_enabled(false);
+
+  size_t calls = 0;
+  ASSERT_EQ(7, load_timeline_iterate([](const android_dl_load_phase_info*, void* data) {
+    ++*static_cast<size_t*>(data);
+    return 7;
+  }, &calls));
+  ASSERT_EQ(1U, calls);
+}
+
+TEST(linker_load_timeline, json) {
+  load_timeline_set_enabled(true);
+  { ScopedLoadPhase phase("/data/app/lib\"quoted\".so", ANDROID_DL_LOAD_PHASE_RELRO); }
+  load_timeline_set_enabled(false);
+
+  TemporaryFile tf;
+  ASSERT_TRUE(load_timeline_write_json(tf.path));
+  std::string json;
+  ASSERT_TRUE(android::base::ReadFileToString(tf.path, &json));
+  ASSERT_EQ(0U, json.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[")) << json;
+  ASSERT_NE(std::string::npos, json.find("\"name\":\"relro\",\"cat\":\"linker\",\"ph\":\"X\""))
+      << json;
+  ASSERT_NE(std::string::npos, json.find("\"library\":\"/data/app/lib\\\"quoted\\\".so\""))
+      << json;
+}
@@ -34,17 +34,27 @@
 #include <sys/prctl.h>
 
 #include "linker.h"
+#include "linker_address_index.h"
 #include "linker_auxv.h"
+#include "linker_binding_cache.h"
 #include "linker_cfi.h"
+#include "linker_config_compiled.h"
 #include "linker_debug.h"
 #include "linker_debuggerd.h"
 #include "linker_gdb_support.h"
 #include "linker_globals.h"
+#include "linker_load_timeline.h"
+#include "linker_parallel_link.h"
 #include "linker_phdr.h"
+#include "linker_reloc_stats.h"
 #include "linker_relocate.h"
+#include "linker_relro_cache.h"
+#include "linker_reservation_pool.h"
 #include "linker_relocs.h"
+#include "linker_relr.h"
 #include "linker_tls.h"
 #include "linker_utils.h"
+#include "linker_zip_archive_cache.h"
 
 #include "private/KernelArgumentBlock.h"
 #include "private/bionic_call_ifunc_resolver.h"
@@ -106,6 +116,7 @@ static soinfo* vdso; // vdso if present
 void solist_add_soinfo(soinfo* si) {
   sonext->next = si;
   sonext = si;
+  get_address_index().invalidate();
 }
 
 bool solist_remove_soinfo(soinfo* si) {
@@ -130,6 +141,7 @@ bool solist_remove_soinfo(soinfo* si) {
   if (si == sonext) {
     sonext = prev;
   }
+  get_address_index().forget(si);
 
   return true;
 }
@@ -329,6 +341,8 @@ static ElfW(Addr) linker_main(KernelArgumentBlock& args, const char* exe_to_load
   // doesn't cost us anything.
   const char* ldpath_env = nullptr;
   const char* ldpreload_env = nullptr;
+  const char* load_timeline_path = nullptr;
+  const char* reloc_stats_path = nullptr;
   if (!getauxval(AT_SECURE)) {
     ldpath_env = getenv("LD_LIBRARY_PATH");
     if (ldpath_env != nullptr) {
@@ -338,6 +352,45 @@ static ElfW(Addr) linker_main(KernelArgumentBlock& args, const char* exe_to_load
     if (ldpreload_env != nullptr) {
       INFO("[ LD_PRELOAD set to \"%s\" ]", ldpreload_env);
     }
+    const char* binding_cache_dir = getenv("LD_BINDING_CACHE_DIR");
+    if (binding_cache_dir != nullptr) {
+      INFO("[ LD_BINDING_CACHE_DIR set to \"%s\" ]", binding_cache_dir);
+      BindingCache::set_directory(binding_cache_dir);
+    }
+    const char* config_cache_dir = getenv("LD_CONFIG_CACHE_DIR");
+    if (config_cache_dir != nullptr) {
+      INFO("[ LD_CONFIG_CACHE_DIR set to \"%s\" ]", config_cache_dir);
+      CompiledConfig::set_cache_directory(config_cache_dir);
+    }
+    const char* relro_cache_dir = getenv("LD_RELRO_CACHE_DIR");
+    if (relro_cache_dir != nullptr) {
+      INFO("[ LD_RELRO_CACHE_DIR set to \"%s\" ]", relro_cache_dir);
+      RelroCache::set_directory(relro_cache_dir);
+    }
+    const char* relocation_threads = getenv("LD_RELOCATION_THREADS");
+    if (relocation_threads != nullptr) {
+      INFO("[ LD_RELOCATION_THREADS set to \"%s\" ]", relocation_threads);
+      set_relocation_thread_count(strtoul(relocation_threads, nullptr, 10));
+    }
+    load_timeline_path = getenv("LD_LOAD_TIMELINE");
+    if (load_timeline_path != nullptr) {
+      INFO("[ LD_LOAD_TIMELINE set to \"%s\" ]", load_timeline_path);
+      load_timeline_set_enabled(true);
+    }
+    reloc_stats_path = getenv("LD_RELOC_STATS");
+    if (reloc_stats_path != nullptr) {
+      INFO("[ LD_RELOC_STATS set to \"%s\" ]", reloc_stats_path);
+      reloc_stats_set_enabled(true);
+    }
+    const char* reservation_pool = getenv("LD_RESERVATION_POOL");
+    if (reservation_pool != nullptr) {
+      INFO("[ LD_RESERVATION_POOL set to \"%s\" ]", reservation_pool);
+      reservation_pool_set_limits(strtoul(reservation_pool, nullptr, 10), SIZE_MAX);
+    }
+    if (getenv("LD_EAGER_DYNAMIC_TLS") != nullptr) {
+      INFO("[ LD_EAGER_DYNAMIC_TLS set ]");
+      linker_set_eager_dynamic_tls(true);
+    }
   }
 
   const ExecutableInfo exe_info = exe_to_load ? load_executable(exe_to_load) :
@@ -506,7 +559,11 @@ static ElfW(Addr) linker_main(KernelArgumentBlock& args, const char* exe_to_load
 #endif
 #if STATS
   print_linker_stats();
+  print_linker_allocator_stats();
+  ZipArchiveCache::get().print_stats();
 #endif
+  if (load_timeline_path != nullptr) load_timeline_write_json(load_timeline_path);
+  if (reloc_stats_path != nullptr) reloc_stats_write(reloc_stats_path);
 #if TIMING || STATS
   fflush(stdout);
 #endif
@@ -705,7 +762,7 @@ extern "C" ElfW(Addr) __linker_init(void* raw_args) {
   // entry point. This must happen after destructors are called in this function
   // (e.g. ~soinfo), so declare this variable very early.
   struct DlMutexUnlocker {
-    ~DlMutexUnlocker() { pthread_mutex_unlock(&g_dl_mutex); }
+    ~DlMutexUnlocker() { dl_unlock_exclusive(); }
   } unlocker;
 
   // Initialize TLS early so system calls and errno work.
@@ -776,7 +833,8 @@ __linker_init_post_relocation(KernelArgumentBlock& args, soinfo& tmp_linker_so)
   // A constructor could spawn a thread that calls into the loader, so as soon
   // as we've called a constructor, we need to hold the lock until transferring
   // to the entry point.
-  pthread_mutex_lock(&g_dl_mutex);
+  dl_lock_init();
+  dl_lock_exclusive();
 
   // Initialize the linker's own global variables
   tmp_linker_so.call_constructors();
@@ -28,6 +28,7 @@
 
 #include "private/bionic_allocator.h"
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <sys/cdefs.h>
 #include <unistd.h>
@@ -68,23 +69,55 @@ static BionicAllocator& get_allocator() {
   return g_bionic_allocator;
 }
 
+// The linker heap is normally only used by the exclusive holder of the loader lock. While the
+// linker runs work on helper threads (see linker_parallel_link.cpp), or while threads share the
+// loader lock, allocations have to be serialized explicitly.
+static std::atomic<size_t> g_allocator_locking(0);
+static pthread_mutex_t g_allocator_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void linker_allocator_enable_locking() {
+  g_allocator_locking.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void linker_allocator_disable_locking() {
+  g_allocator_locking.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+class ScopedAllocatorLock {
+ public:
+  ScopedAllocatorLock() : locked_(g_allocator_locking.load(std::memory_order_acquire) != 0) {
+    if (__predict_false(locked_)) pthread_mutex_lock(&g_allocator_lock);
+  }
+  ~ScopedAllocatorLock() {
+    if (__predict_false(locked_)) pthread_mutex_unlock(&g_allocator_lock);
+  }
+
+ private:
+  const bool locked_;
+};
+
 void* malloc(size_t byte_count) {
+  ScopedAllocatorLock lock;
   return get_allocator().alloc(byte_count);
 }
 
 void* memalign(size_t alignment, size_t byte_count) {
+  ScopedAllocatorLock lock;
   return get_allocator().memalign(alignment, byte_count);
 }
 
 void* aligned_alloc(size_t alignment, size_t byte_count) {
+  ScopedAllocatorLock lock;
   return get_allocator().memalign(alignment, byte_count);
 }
 
 void* calloc(size_t item_count, size_t item_size) {
+  ScopedAllocatorLock lock;
   return get_allocator().alloc(item_count*item_size);
 }
 
 void* realloc(void* p, size_t byte_count) {
+  ScopedAllocatorLock lock;
   return get_allocator().realloc(p, byte_count);
 }
 
@@ -94,9 +127,11 @@ void* reallocarray(void* p, size_t item_count, size_t item_size) {
     errno = ENOMEM;
     return nullptr;
   }
+  ScopedAllocatorLock lock;
   return get_allocator().realloc(p, byte_count);
 }
 
 void free(void* ptr) {
+  ScopedAllocatorLock lock;
   get_allocator().free(ptr);
 }
@@ -41,7 +41,7 @@ bool android_namespace_t::is_accessible(const std::string& file) {
 
   if (!allowed_libs_.empty()) {
     const char *lib_name = basename(file.c_str());
-    if (std::find(allowed_libs_.begin(), allowed_libs_.end(), lib_name) == allowed_libs_.end()) {
+    if (allowed_libs_.find(std::string_view(lib_name)) == allowed_libs_.end()) {
       return false;
     }
   }
@@ -30,18 +30,28 @@
 
 #include "linker_common_types.h"
 
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_set>
 
 std::vector<std::string> fix_lib_paths(std::vector<std::string> paths);
 
+// A set of library names that can be searched with a const char* or std::string_view without
+// copying the name into a std::string first.
+struct soname_hash {
+  using is_transparent = void;
+  size_t operator()(std::string_view name) const { return std::hash<std::string_view>()(name); }
+};
+using soname_set_t = std::unordered_set<std::string, soname_hash, std::equal_to<>>;
+
 struct android_namespace_t;
 
 struct android_namespace_link_t {
  public:
   android_namespace_link_t(android_namespace_t* linked_namespace,
-                           std::unordered_set<std::string> shared_lib_sonames,
+                           soname_set_t shared_lib_sonames,
                            bool allow_all_shared_libs)
       : linked_namespace_(linked_namespace),
         shared_lib_sonames_(std::move(shared_lib_sonames)),
@@ -51,11 +61,11 @@ struct android_namespace_link_t {
     return linked_namespace_;
   }
 
-  const std::unordered_set<std::string>& shared_lib_sonames() const {
+  const soname_set_t& shared_lib_sonames() const {
     return shared_lib_sonames_;
   }
 
-  bool is_accessible(const char* soname) const {
+  bool is_accessible(std::string_view soname) const {
     return allow_all_shared_libs_ || shared_lib_sonames_.find(soname) != shared_lib_sonames_.end();
   }
 
@@ -65,7 +75,7 @@ struct android_namespace_link_t {
 
  private:
   android_namespace_t* const linked_namespace_;
-  const std::unordered_set<std::string> shared_lib_sonames_;
+  const soname_set_t shared_lib_sonames_;
   bool allow_all_shared_libs_;
 };
 
@@ -74,7 +84,9 @@ struct android_namespace_t {
   android_namespace_t() :
     is_isolated_(false),
     is_exempt_list_enabled_(false),
-    is_also_used_as_anonymous_(false) {}
+    is_also_used_as_anonymous_(false),
+    is_lazy_binding_enabled_(false),
+    is_hugepage_text_enabled_(false) {}
 
   const char* get_name() const { return name_.c_str(); }
   void set_name(const char* name) { name_ = name; }
@@ -88,6 +100,12 @@ struct android_namespace_t {
   bool is_also_used_as_anonymous() const { return is_also_used_as_anonymous_; }
   void set_also_used_as_anonymous(bool yes) { is_also_used_as_anonymous_ = yes; }
 
+  bool is_lazy_binding_enabled() const { return is_lazy_binding_enabled_; }
+  void set_lazy_binding_enabled(bool enabled) { is_lazy_binding_enabled_ = enabled; }
+
+  bool is_hugepage_text_enabled() const { return is_hugepage_text_enabled_; }
+  void set_hugepage_text_enabled(bool enabled) { is_hugepage_text_enabled_ = enabled; }
+
   const std::vector<std::string>& get_ld_library_paths() const {
     return ld_library_paths_;
   }
@@ -115,19 +133,16 @@ struct android_namespace_t {
     permitted_paths_ = permitted_paths;
   }
 
-  const std::vector<std::string>& get_allowed_libs() const { return allowed_libs_; }
-  void set_allowed_libs(std::vector<std::string>&& allowed_libs) {
-    allowed_libs_ = std::move(allowed_libs);
-  }
+  const soname_set_t& get_allowed_libs() const { return allowed_libs_; }
   void set_allowed_libs(const std::vector<std::string>& allowed_libs) {
-    allowed_libs_ = allowed_libs;
+    allowed_libs_ = soname_set_t(allowed_libs.begin(), allowed_libs.end());
   }
 
   const std::vector<android_namespace_link_t>& linked_namespaces() const {
     return linked_namespaces_;
   }
   void add_linked_namespace(android_namespace_t* linked_namespace,
-                            std::unordered_set<std::string> shared_lib_sonames,
+                            soname_set_t shared_lib_sonames,
                             bool allow_all_shared_libs) {
     linked_namespaces_.emplace_back(linked_namespace, std::move(shared_lib_sonames),
                                     allow_all_shared_libs);
@@ -168,10 +183,12 @@ struct android_namespace_t {
   bool is_isolated_;
   bool is_exempt_list_enabled_;
   bool is_also_used_as_anonymous_;
+  bool is_lazy_binding_enabled_;
+  bool is_hugepage_text_enabled_;
   std::vector<std::string> ld_library_paths_;
   std::vector<std::string> default_library_paths_;
   std::vector<std::string> permitted_paths_;
-  std::vector<std::string> allowed_libs_;
+  soname_set_t allowed_libs_;
   // Loader looks into linked namespace if it was not able
   // to find a library in this namespace. Note that library
   // lookup in linked namespaces are limited by the list of
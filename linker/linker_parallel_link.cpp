@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "linker_parallel_link.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+
+#include "linker_binding_cache.h"
+#include "linker_debug.h"
+#include "linker_globals.h"
+#include "linker_reloc_stats.h"
+#include "linker_soinfo.h"
+#include "private/bionic_globals.h"
+
+// Relocating a library only writes to that library's own pages (and its soinfo), and symbol
+// lookup only reads the symbol tables of the libraries in the lookup list. The libraries of a
+// local group can therefore be relocated concurrently, as long as everything with process-wide
+// side effects (gdb notification, the module counter, CFI shadow updates) is done afterwards,
+// in the usual order, by the thread holding the loader lock.
+//
+// The linker can't create threads by itself, so the helper threads come from libc.so's
+// pthread_create(). They are therefore only available once libc.so has been initialized, i.e.
+// for dlopen() but not for the executable's initial set of libraries.
+
+static constexpr size_t kMaxRelocationThreads = 16;
+
+// Not worth the thread creation for smaller groups.
+static constexpr size_t kMinParallelLibraries = 4;
+
+static size_t g_relocation_thread_count = 1;
+
+namespace {
+
+struct RelocationWorker {
+  std::atomic<pthread_t> thread;
+  char* error_buffer;
+};
+
+struct RelocationBatch {
+  const std::vector<soinfo*>* libs;
+  const SymbolLookupList* lookup_list;
+  soinfo* local_group_root;
+  std::atomic<size_t> next_index;
+  // The lowest index of a library that failed to relocate.
+  std::atomic<size_t> first_failure;
+  std::vector<std::string> errors;
+};
+
+}  // namespace
+
+static RelocationWorker g_workers[kMaxRelocationThreads];
+static size_t g_worker_count = 0;
+static std::atomic<bool> g_batch_active(false);
+static RelocationBatch* g_batch = nullptr;
+
+void set_relocation_thread_count(size_t count) {
+  g_relocation_thread_count = count < 1 ? 1 : (count > kMaxRelocationThreads ?
+                                               kMaxRelocationThreads : count);
+}
+
+bool can_relocate_in_parallel(const std::vector<soinfo*>& libs) {
+  if (g_relocation_thread_count < 2 || libs.size() < kMinParallelLibraries) return false;
+
+  const libc_shared_globals* globals = __libc_shared_globals();
+  if (globals->pthread_create_hook == nullptr || globals->pthread_join_hook == nullptr) {
+    return false;
+  }
+
+  // Keep the output of ldd, relocation tracing, and statistics deterministic.
+  if (g_is_ldd || STATS || g_reloc_stats_enabled || g_ld_debug_verbosity > LINKER_VERBOSITY_TRACE) return false;
+
+  for (const soinfo* si : libs) {
+    // DT_SYMBOLIC libraries need their own view of the lookup list.
+    if (si->has_DT_SYMBOLIC) return false;
+#if !defined(__LP64__)
+    // Text relocations change the protection of the library's segments while relocating.
+    if (si->has_text_relocations) return false;
+#endif
+    // The library's own ifunc resolvers can't be expected to cope with running on another thread
+    // before anything else in the library has been set up.
+    if (si->has_irelative_relocs()) return false;
+  }
+  return true;
+}
+
+static void run_relocation_worker(size_t slot) {
+  RelocationWorker& worker = g_workers[slot];
+  worker.thread.store(pthread_self(), std::memory_order_release);
+
+  RelocationBatch* batch = g_batch;
+  const std::vector<soinfo*>& libs = *batch->libs;
+  for (;;) {
+    size_t i = batch->next_index.fetch_add(1, std::memory_order_relaxed);
+    if (i >= libs.size()) break;
+
+    // Serial relocation would have stopped at an earlier failure.
+    if (i > batch->first_failure.load(std::memory_order_relaxed)) continue;
+
+    worker.error_buffer[0] = '\0';
+    if (!libs[i]->relocate_image(*batch->lookup_list, batch->local_group_root, nullptr, nullptr)) {
+      batch->errors[i] = worker.error_buffer;
+      size_t first_failure = batch->first_failure.load(std::memory_order_relaxed);
+      while (i < first_failure &&
+             !batch->first_failure.compare_exchange_weak(first_failure, i,
+                                                         std::memory_order_relaxed)) {
+      }
+    }
+  }
+}
+
+static void* relocation_worker_main(void* arg) {
+  run_relocation_worker(reinterpret_cast<size_t>(arg));
+  return nullptr;
+}
+
+size_t parallel_relocate_images(const std::vector<soinfo*>& libs,
+                                const SymbolLookupList& lookup_list,
+                                soinfo* local_group_root) {
+  const libc_shared_globals* globals = __libc_shared_globals();
+  const size_t thread_count = std::min(g_relocation_thread_count, libs.size());
+
+  // Anything computed lazily from the lookup list must be computed before it's shared.
+  if (BindingCache::is_enabled()) {
+    lookup_list.get_build_id_hash();
+  }
+
+  RelocationBatch batch;
+  batch.libs = &libs;
+  batch.lookup_list = &lookup_list;
+  batch.local_group_root = local_group_root;
+  batch.next_index = 0;
+  batch.first_failure = libs.size();
+  batch.errors.resize(libs.size());
+
+  const size_t error_buffer_size = linker_get_error_buffer_size();
+  for (size_t i = 0; i < thread_count; ++i) {
+    g_workers[i].thread.store(0, std::memory_order_relaxed);
+    g_workers[i].error_buffer = static_cast<char*>(malloc(error_buffer_size));
+  }
+  g_workers[0].thread.store(pthread_self(), std::memory_order_relaxed);
+  g_worker_count = thread_count;
+  g_batch = &batch;
+
+  linker_allocator_enable_locking();
+  g_batch_active.store(true, std::memory_order_release);
+
+  pthread_t threads[kMaxRelocationThreads];
+  size_t started = 0;
+  for (size_t slot = 1; slot < thread_count; ++slot) {
+    if (globals->pthread_create_hook(&threads[started], nullptr, relocation_worker_main,
+                                     reinterpret_cast<void*>(slot)) != 0) {
+      // The remaining libraries will be picked up by the threads we have.
+      break;
+    }
+    ++started;
+  }
+  DEBUG("[ relocating %zu libraries with %zu threads ]", libs.size(), started + 1);
+
+  run_relocation_worker(0);
+  for (size_t i = 0; i < started; ++i) {
+    globals->pthread_join_hook(threads[i], nullptr);
+  }
+
+  g_batch_active.store(false, std::memory_order_release);
+  linker_allocator_disable_locking();
+  g_batch = nullptr;
+  g_worker_count = 0;
+  for (size_t i = 0; i < thread_count; ++i) {
+    free(g_workers[i].error_buffer);
+    g_workers[i].error_buffer = nullptr;
+  }
+
+  const size_t first_failure = batch.first_failure.load(std::memory_order_relaxed);
+  if (first_failure < libs.size()) {
+    strlcpy(linker_get_error_buffer(), batch.errors[first_failure].c_str(), error_buffer_size);
+  }
+  return first_failure;
+}
+
+char* parallel_relocation_error_buffer() {
+  if (__predict_true(!g_batch_active.load(std::memory_order_acquire))) return nullptr;
+
+  pthread_t self = pthread_self();
+  for (size_t i = 0; i < g_worker_count; ++i) {
+    if (g_workers[i].thread.load(std::memory_order_acquire) == self) {
+      return g_workers[i].error_buffer;
+    }
+  }
+  return nullptr;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#include <vector>
+
+class SymbolLookupList;
+struct soinfo;
+
+// Sets the maximum number of threads (including the calling thread) used to relocate the
+// libraries of a local group. The default of 1 disables parallel relocation.
+void set_relocation_thread_count(size_t count);
+
+// Returns true if the libraries in `libs` may be handed to parallel_relocate_images().
+bool can_relocate_in_parallel(const std::vector<soinfo*>& libs);
+
+// Calls soinfo::relocate_image() for each library in `libs`, spread across helper threads.
+// Returns the number of leading libraries that were relocated successfully; if that is less
+// than libs.size(), the error buffer holds the error for the first library that failed, exactly
+// as if the libraries had been relocated one after the other.
+size_t parallel_relocate_images(const std::vector<soinfo*>& libs,
+                                const SymbolLookupList& lookup_list,
+                                soinfo* local_group_root);
+
+// Returns the calling thread's private error buffer while it relocates a library on behalf of
+// parallel_relocate_images(), or nullptr otherwise.
+char* parallel_relocation_error_buffer();
@@ -29,6 +29,7 @@
 #include "linker_phdr.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <string.h>
 #include <sys/mman.h>
 #include <sys/prctl.h>
@@ -40,6 +41,8 @@
 #include "linker_dlwarning.h"
 #include "linker_globals.h"
 #include "linker_debug.h"
+#include "linker_load_timeline.h"
+#include "linker_reservation_pool.h"
 #include "linker_utils.h"
 
 #include "private/bionic_asm_note.h"
@@ -173,10 +176,13 @@ bool ElfReader::Read(const char* name, int fd, off64_t file_offset, off64_t file
   file_offset_ = file_offset;
   file_size_ = file_size;
 
-  if (ReadElfHeader() &&
-      VerifyElfHeader() &&
-      ReadProgramHeaders() &&
-      ReadSectionHeaders() &&
+  if (!ReadElfHeader() || !VerifyElfHeader() || !ReadProgramHeaders()) {
+    return false;
+  }
+
+  Readahead();
+
+  if (ReadSectionHeaders() &&
       ReadDynamicSection() &&
       ReadPadSegmentNote()) {
     did_read_ = true;
@@ -190,9 +196,16 @@ bool ElfReader::Load(address_space_params* address_space) {
   if (did_load_) {
     return true;
   }
+  LoadPhaseTimer reserve_timer;
   bool reserveSuccess = ReserveAddressSpace(address_space);
-  if (reserveSuccess && LoadSegments() && FindPhdr() &&
-      FindGnuPropertySection()) {
+  reserve_timer.finish(name_.c_str(), ANDROID_DL_LOAD_PHASE_RESERVE);
+  bool segmentsLoaded = false;
+  if (reserveSuccess) {
+    LoadPhaseTimer load_timer;
+    segmentsLoaded = LoadSegments();
+    load_timer.finish(name_.c_str(), ANDROID_DL_LOAD_PHASE_LOAD_SEGMENTS);
+  }
+  if (segmentsLoaded && FindPhdr() && FindGnuPropertySection()) {
     did_load_ = true;
 #if defined(__aarch64__)
     // For Armv8.5-A loaded executable segments may require PROT_BTI.
@@ -204,7 +217,8 @@ bool ElfReader::Load(address_space_params* address_space) {
   }
   if (reserveSuccess && !did_load_) {
     if (load_start_ != nullptr && load_size_ != 0) {
-      if (!mapped_by_caller_) {
+      if (!mapped_by_caller_ &&
+          !reservation_pool_put(load_start_, load_size_, gap_start_, gap_size_)) {
         munmap(load_start_, load_size_);
       }
     }
@@ -371,6 +385,30 @@ bool ElfReader::ReadProgramHeaders() {
   return true;
 }
 
+// Libraries are read in dependency order, but their segments aren't mapped until every
+// DT_NEEDED library has been found. Ask the kernel to start reading everything that will be
+// mapped now, so that on a cold page cache the I/O for all of them overlaps instead of
+// stalling each mapping in turn.
+void ElfReader::Readahead() {
+  ElfW(Addr) file_end = 0;
+  for (size_t i = 0; i < phdr_num_; ++i) {
+    const ElfW(Phdr)* phdr = &phdr_table_[i];
+    if (phdr->p_type == PT_LOAD && phdr->p_offset + phdr->p_filesz > file_end) {
+      file_end = phdr->p_offset + phdr->p_filesz;
+    }
+  }
+
+  // This is only a hint, so a bad program header is reported later, by LoadSegments.
+  if (file_end == 0 || file_end > static_cast<ElfW(Addr)>(file_size_ - file_offset_)) {
+    return;
+  }
+
+  int rc = posix_fadvise64(fd_, file_offset_, file_end, POSIX_FADV_WILLNEED);
+  if (rc != 0) {
+    DEBUG("\"%s\": posix_fadvise(WILLNEED) failed: %s", name_.c_str(), strerror(rc));
+  }
+}
+
 bool ElfReader::ReadSectionHeaders() {
   shdr_num_ = header_.e_shnum;
 
@@ -706,8 +744,11 @@ bool ElfReader::ReserveAddressSpace(address_space_params* address_space) {
       // bits available for ASLR for no benefit.
       start_alignment = maximum_alignment == kPmdSize ? kPmdSize : page_size();
     }
-    start = ReserveWithAlignmentPadding(load_size_, kLibraryAlignment, start_alignment, &gap_start_,
-                                        &gap_size_);
+    start = reservation_pool_take(load_size_, start_alignment, &gap_start_, &gap_size_);
+    if (start == nullptr) {
+      start = ReserveWithAlignmentPadding(load_size_, kLibraryAlignment, start_alignment,
+                                          &gap_start_, &gap_size_);
+    }
     if (start == nullptr) {
       DL_ERR("couldn't reserve %zd bytes of address space for \"%s\"", load_size_, name_.c_str());
       return false;
@@ -1440,6 +1481,120 @@ const char* phdr_table_get_interpreter_name(const ElfW(Phdr)* phdr_table, size_t
   return nullptr;
 }
 
+/* Return the GNU build ID of a loaded ELF file.
+ *
+ * Input:
+ *   phdr_table  -> program header table
+ *   phdr_count  -> number of entries in tables
+ *   load_bias   -> load bias
+ * Output:
+ *   build_id      -> address of the build ID bytes
+ *   build_id_size -> length of the build ID in bytes
+ * Return:
+ *   true if an NT_GNU_BUILD_ID note was found, false otherwise.
+ */
+bool phdr_table_get_build_id(const ElfW(Phdr)* phdr_table, size_t phdr_count,
+                             ElfW(Addr) load_bias, const uint8_t** build_id,
+                             size_t* build_id_size) {
+  const ElfW(Nhdr)* note_hdr = nullptr;
+  const char* note_desc = nullptr;
+  if (!__find_elf_note(NT_GNU_BUILD_ID, "GNU", phdr_table, phdr_count,
+                       &note_hdr, &note_desc, load_bias) ||
+      note_hdr->n_descsz == 0) {
+    return false;
+  }
+  *build_id = reinterpret_cast<const uint8_t*>(note_desc);
+  *build_id_size = note_hdr->n_descsz;
+  return true;
+}
+
+/* Return true if the loaded ELF image asks for its text to be backed by huge
+ * pages, with an NT_ANDROID_TYPE_HUGEPAGE_TEXT note whose value is 1.
+ *
+ * Input:
+ *   phdr_table  -> program header table
+ *   phdr_count  -> number of entries in tables
+ *   load_bias   -> load bias
+ */
+bool phdr_table_has_hugepage_text_note(const ElfW(Phdr)* phdr_table, size_t phdr_count,
+                                       ElfW(Addr) load_bias) {
+  const ElfW(Nhdr)* note_hdr = nullptr;
+  const char* note_desc = nullptr;
+  if (!__find_elf_note(NT_ANDROID_TYPE_HUGEPAGE_TEXT, "Android", phdr_table, phdr_count,
+                       &note_hdr, &note_desc, load_bias) ||
+      note_hdr->n_descsz != sizeof(ElfW(Word))) {
+    return false;
+  }
+  return *reinterpret_cast<const ElfW(Word)*>(note_desc) == 1;
+}
+
+/* Find the part of a loadable segment that can be promoted to huge pages: an
+ * executable, read-only segment's file-backed part, rounded inwards to PMD
+ * boundaries.
+ *
+ * Input:
+ *   phdr        -> program header
+ *   load_bias   -> load bias
+ * Output:
+ *   start       -> start of the range
+ *   end         -> end of the range
+ * Return:
+ *   false if the segment isn't text, or doesn't span a whole PMD.
+ */
+bool phdr_get_hugepage_text_range(const ElfW(Phdr)* phdr, ElfW(Addr) load_bias,
+                                  ElfW(Addr)* start, ElfW(Addr)* end) {
+  if (phdr->p_type != PT_LOAD || (phdr->p_flags & (PF_X | PF_W)) != PF_X) {
+    return false;
+  }
+
+  *start = align_up(phdr->p_vaddr + load_bias, kPmdSize);
+  *end = align_down(phdr->p_vaddr + phdr->p_filesz + load_bias, kPmdSize);
+  return *start < *end;
+}
+
+/* Collapse the executable, read-only loadable segments into huge pages with
+ * MADV_COLLAPSE, so that hot code in large binaries doesn't need one iTLB
+ * entry per small page. See phdr_get_hugepage_text_range() for which part of
+ * each segment is promoted. For file-backed text, the kernel also needs the
+ * file offset and the address to be congruent modulo the PMD size, which is
+ * what linking with -z max-page-size=2097152 gives.
+ *
+ * Failures aren't errors: the pages just stay small. Each segment's outcome
+ * is logged.
+ *
+ * Input:
+ *   phdr_table  -> program header table
+ *   phdr_count  -> number of entries in tables
+ *   load_bias   -> load bias
+ *   name        -> name of the library, for logging
+ * Return:
+ *   The number of bytes that were promoted.
+ */
+size_t phdr_table_collapse_text_segments(const ElfW(Phdr)* phdr_table, size_t phdr_count,
+                                         ElfW(Addr) load_bias, const char* name) {
+  size_t promoted = 0;
+  for (size_t i = 0; i < phdr_count; ++i) {
+    ElfW(Addr) start;
+    ElfW(Addr) end;
+    if (!phdr_get_hugepage_text_range(&phdr_table[i], load_bias, &start, &end)) {
+      continue;
+    }
+
+    void* addr = reinterpret_cast<void*>(start);
+    size_t size = end - start;
+    if (madvise(addr, size, MADV_HUGEPAGE) == -1 || madvise(addr, size, MADV_COLLAPSE) == -1) {
+      INFO("[ \"%s\": couldn't promote segment %zu (%p-%p) to huge pages: %m ]", name, i, addr,
+           reinterpret_cast<void*>(end));
+      continue;
+    }
+
+    INFO("[ \"%s\": promoted segment %zu (%p-%p) to huge pages ]", name, i, addr,
+         reinterpret_cast<void*>(end));
+    promoted += size;
+  }
+  return promoted;
+}
+
 // Sets loaded_phdr_ to the address of the program header table as it appears
 // in the loaded segments in memory. This is in contrast with phdr_table_,
 // which is temporary and will be released before the library is relocated.
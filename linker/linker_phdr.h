@@ -64,6 +64,7 @@ class ElfReader {
   [[nodiscard]] bool ReadElfHeader();
   [[nodiscard]] bool VerifyElfHeader();
   [[nodiscard]] bool ReadProgramHeaders();
+  void Readahead();
   [[nodiscard]] bool ReadSectionHeaders();
   [[nodiscard]] bool ReadDynamicSection();
   [[nodiscard]] bool ReadPadSegmentNote();
@@ -156,4 +157,17 @@ void phdr_table_get_dynamic_section(const ElfW(Phdr)* phdr_table, size_t phdr_co
 const char* phdr_table_get_interpreter_name(const ElfW(Phdr)* phdr_table, size_t phdr_count,
                                             ElfW(Addr) load_bias);
 
+bool phdr_table_get_build_id(const ElfW(Phdr)* phdr_table, size_t phdr_count,
+                             ElfW(Addr) load_bias, const uint8_t** build_id,
+                             size_t* build_id_size);
+
+bool phdr_table_has_hugepage_text_note(const ElfW(Phdr)* phdr_table, size_t phdr_count,
+                                       ElfW(Addr) load_bias);
+
+bool phdr_get_hugepage_text_range(const ElfW(Phdr)* phdr, ElfW(Addr) load_bias,
+                                  ElfW(Addr)* start, ElfW(Addr)* end);
+
+size_t phdr_table_collapse_text_segments(const ElfW(Phdr)* phdr_table, size_t phdr_count,
+                                         ElfW(Addr) load_bias, const char* name);
+
 bool page_size_migration_supported();
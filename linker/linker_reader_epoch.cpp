@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "linker_reader_epoch.h"
+
+uint64_t ReaderEpoch::enter() {
+  while (true) {
+    uint64_t epoch = epoch_.load();
+    readers_[epoch & 1].fetch_add(1);
+    // If the epoch moved on between the load and the increment, the writer may already have
+    // checked this slot and found it empty, so register again in the current slot.
+    if (epoch_.load() == epoch) return epoch;
+    readers_[epoch & 1].fetch_sub(1);
+  }
+}
+
+void ReaderEpoch::exit(uint64_t token) {
+  readers_[token & 1].fetch_sub(1);
+}
+
+void ReaderEpoch::reset_readers_after_fork(const uint32_t readers[2]) {
+  readers_[0].store(readers[0]);
+  readers_[1].store(readers[1]);
+}
+
+void ReaderEpoch::retire(void (*release)(void*), void* arg) {
+  retired_.push_back({epoch_.load(std::memory_order_relaxed), release, arg});
+}
+
+void ReaderEpoch::reclaim() {
+  while (!retired_.empty()) {
+    uint64_t epoch = epoch_.load(std::memory_order_relaxed);
+    // Readers in the previous epoch may hold anything retired before the epoch advanced.
+    if (readers_[(epoch - 1) & 1].load() != 0) return;
+
+    // Everything retired in an earlier epoch is now unreachable. Releasing may retire more
+    // objects, so take the ready ones out of the list first.
+    std::vector<Retired> ready;
+    size_t kept = 0;
+    for (const Retired& r : retired_) {
+      if (r.epoch < epoch) {
+        ready.push_back(r);
+      } else {
+        retired_[kept++] = r;
+      }
+    }
+    retired_.resize(kept);
+    for (const Retired& r : ready) {
+      r.release(r.arg);
+    }
+
+    if (retired_.empty()) return;
+    // The rest was retired in the current epoch, and current readers may hold it. Move new readers
+    // to the slot that was just found empty; when the current slot drains, the rest can go too.
+    epoch_.store(epoch + 1);
+  }
+}
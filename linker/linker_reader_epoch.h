@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <vector>
+
+#include <android-base/macros.h>
+
+// Epoch-based reclamation for data that is read without the loader lock.
+//
+// A reader brackets its accesses with enter() and exit(). The exclusive holder of the loader lock
+// unpublishes an object (so no new reader can find it) and then retire()s it. The object is only
+// released once every reader that might still have it in hand has called exit().
+//
+// Readers are counted in two slots selected by the parity of the current epoch. Advancing the
+// epoch moves all new readers to the other slot, so once the old slot drains, everything retired
+// before the advance is unreachable. The writer never waits: reclaim() releases what it can and
+// leaves the rest for a later call. Readers may call back into the loader (a dl_iterate_phdr()
+// callback may dlclose() a library), which is why reclaim() mustn't block on them.
+class ReaderEpoch {
+ public:
+  ReaderEpoch() = default;
+
+  // Reader side. May be called on any thread, without the loader lock, and from signal handlers.
+  // enter() returns a token that must be passed to the matching exit().
+  uint64_t enter();
+  void exit(uint64_t token);
+
+  // Writer side. Must only be called by the exclusive holder of the loader lock.
+  //
+  // Arranges for release(arg) to be called once no reader can be using `arg`.
+  void retire(void (*release)(void*), void* arg);
+  // Releases every retired object whose readers are gone.
+  void reclaim();
+
+  size_t pending() const { return retired_.size(); }
+
+  // For the child of fork(), which only has the thread that forked: replaces the reader counts
+  // with that thread's own. `readers[i]` is how many of its enter() tokens `t` with `(t & 1) == i`
+  // haven't been passed to exit() yet. Readers on other threads never exit in the child, and
+  // would otherwise keep reclaim() from releasing anything again.
+  void reset_readers_after_fork(const uint32_t readers[2]);
+
+ private:
+  struct Retired {
+    uint64_t epoch;
+    void (*release)(void*);
+    void* arg;
+  };
+
+  std::atomic<uint64_t> epoch_{1};
+  std::atomic<size_t> readers_[2] = {};
+  std::vector<Retired> retired_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReaderEpoch);
+};
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "linker_reader_epoch.h"
+
+static void record_release(void* arg) {
+  ++*static_cast<int*>(arg);
+}
+
+TEST(linker_reader_epoch, no_readers) {
+  ReaderEpoch epoch;
+  int released = 0;
+  epoch.retire(record_release, &released);
+  epoch.retire(record_release, &released);
+  epoch.reclaim();
+  ASSERT_EQ(2, released);
+  ASSERT_EQ(0U, epoch.pending());
+}
+
+TEST(linker_reader_epoch, active_reader) {
+  ReaderEpoch epoch;
+  uint64_t token = epoch.enter();
+
+  int released = 0;
+  epoch.retire(record_release, &released);
+  epoch.reclaim();
+  epoch.reclaim();
+  ASSERT_EQ(0, released);
+  ASSERT_EQ(1U, epoch.pending());
+
+  epoch.exit(token);
+  epoch.reclaim();
+  ASSERT_EQ(1, released);
+  ASSERT_EQ(0U, epoch.pending());
+}
+
+TEST(linker_reader_epoch, later_reader_does_not_block) {
+  ReaderEpoch epoch;
+  uint64_t old_token = epoch.enter();
+  int first = 0;
+  epoch.retire(record_release, &first);
+  epoch.reclaim();
+
+  // This reader arrived after `first` was retired, so it can't be holding it.
+  uint64_t new_token = epoch.enter();
+  epoch.exit(old_token);
+  epoch.reclaim();
+  ASSERT_EQ(1, first);
+
+  // But it may hold anything retired now.
+  int second = 0;
+  epoch.retire(record_release, &second);
+  epoch.reclaim();
+  ASSERT_EQ(0, second);
+
+  epoch.exit(new_token);
+  epoch.reclaim();
+  ASSERT_EQ(1, second);
+}
+
+struct Chain {
+  ReaderEpoch* epoch;
+  int released;
+};
+
+static void release_and_retire(void* arg) {
+  Chain* chain = static_cast<Chain*>(arg);
+  if (chain->released++ == 0) chain->epoch->retire(release_and_retire, chain);
+}
+
+TEST(linker_reader_epoch, retire_while_releasing) {
+  ReaderEpoch epoch;
+  Chain chain = {&epoch, 0};
+  epoch.retire(release_and_retire, &chain);
+  epoch.reclaim();
+  ASSERT_EQ(2, chain.released);
+  ASSERT_EQ(0U, epoch.pending());
+}
+
+TEST(linker_reader_epoch, reset_readers_after_fork) {
+  ReaderEpoch epoch;
+  // Two readers on "other threads", and one on the thread that forks.
+  epoch.enter();
+  epoch.enter();
+  uint64_t own_token = epoch.enter();
+  uint32_t own_readers[2] = {};
+  ++own_readers[own_token & 1];
+
+  int released = 0;
+  epoch.retire(record_release, &released);
+  epoch.reclaim();
+  ASSERT_EQ(0, released);
+
+  // In the child, only the forking thread's reader is left to exit.
+  epoch.reset_readers_after_fork(own_readers);
+  epoch.reclaim();
+  ASSERT_EQ(0, released);
+
+  epoch.exit(own_token);
+  epoch.reclaim();
+  ASSERT_EQ(1, released);
+  ASSERT_EQ(0U, epoch.pending());
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "linker_reloc_stats.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <async_safe/log.h>
+
+#include "linker_debug.h"
+#include "linker_main.h"
+#include "linker_soinfo.h"
+
+bool g_reloc_stats_enabled = false;
+
+void reloc_stats_set_enabled(bool enabled) {
+  g_reloc_stats_enabled = enabled;
+}
+
+size_t DirtyPageSet::count() {
+  std::sort(pages_.begin(), pages_.end());
+  return std::unique(pages_.begin(), pages_.end()) - pages_.begin();
+}
+
+bool reloc_stats_write(const char* path) {
+  int fd = TEMP_FAILURE_RETRY(open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+  if (fd == -1) {
+    PRINT("unable to open relocation statistics file \"%s\": %m", path);
+    return false;
+  }
+
+  async_safe_format_fd(fd,
+                       "dirty_pages\tabsolute\trelative\trelr\tsymbol_lookups\tcached\tlibrary\n");
+  for (soinfo* si = solist_get_head(); si != nullptr; si = si->next) {
+    if (!si->is_linked()) continue;
+    const android_dl_reloc_stats* stats = si->reloc_stats();
+    async_safe_format_fd(fd, "%zu\t%zu\t%zu\t%zu\t%zu\t%zu\t%s\n", stats->dirty_pages,
+                         stats->absolute, stats->relative, stats->relr, stats->symbol_lookups,
+                         stats->symbol_lookups_cached, si->get_realpath());
+  }
+  close(fd);
+  return true;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <link.h>
+#include <stddef.h>
+
+#include <vector>
+
+#include "platform/bionic/page.h"
+#include "private/bionic_dl_reloc_stats.h"
+
+// Per-library relocation statistics: how many relocations of each kind were applied, and how many
+// distinct pages they dirtied, which shows the libraries that would gain most from RELR, from
+// -Bsymbolic, or from sharing their RELRO.
+//
+// Recording is off by default. While it is on, libraries are relocated with the general
+// relocation loop, one at a time. It is turned on by LD_RELOC_STATS, which also names a file that
+// the statistics of every library are written to once the executable's own libraries have been
+// linked. At runtime it can be turned on with android_dl_set_reloc_stats_enabled(), and each
+// library's statistics read with android_dl_get_reloc_stats().
+
+extern bool g_reloc_stats_enabled;
+
+void reloc_stats_set_enabled(bool enabled);
+
+// The set of pages written while relocating one library.
+class DirtyPageSet {
+ public:
+  void add(ElfW(Addr) address) {
+    // Relocations mostly come in address order, so this filters out most duplicates.
+    ElfW(Addr) page = page_start(address);
+    if (page != last_page_) {
+      pages_.push_back(page);
+      last_page_ = page;
+    }
+  }
+
+  // Returns the number of distinct pages added.
+  size_t count();
+
+ private:
+  std::vector<ElfW(Addr)> pages_;
+  ElfW(Addr) last_page_ = 0;
+};
+
+// Writes the statistics of every linked library to `path`, one tab-separated line per library.
+bool reloc_stats_write(const char* path);
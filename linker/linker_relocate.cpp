@@ -30,16 +30,20 @@
 
 #include <elf.h>
 #include <link.h>
+#include <string.h>
 
 #include <type_traits>
 
 #include "linker.h"
+#include "linker_binding_cache.h"
 #include "linker_debug.h"
 #include "linker_globals.h"
 #include "linker_gnu_hash.h"
 #include "linker_phdr.h"
 #include "linker_relocs.h"
 #include "linker_reloc_iterators.h"
+#include "linker_reloc_stats.h"
+#include "linker_relr.h"
 #include "linker_sleb128.h"
 #include "linker_soinfo.h"
 #include "private/bionic_globals.h"
@@ -78,6 +82,12 @@ class Relocator {
   const ElfW(Sym)* cache_sym = nullptr;
   soinfo* cache_si = nullptr;
 
+  // Persistent bindings from LD_BINDING_CACHE_DIR, if enabled for this library.
+  BindingCache* binding_cache = nullptr;
+
+  // The pages written so far, if relocation statistics are on.
+  DirtyPageSet* dirty_pages = nullptr;
+
   std::vector<TlsDynamicResolverArg>* tlsdesc_args;
   std::vector<std::pair<TlsDescriptor*, size_t>> deferred_tlsdesc_relocs;
   size_t tls_tp_base = 0;
@@ -99,15 +109,25 @@ static inline bool lookup_symbol(Relocator& relocator, uint32_t r_sym, const cha
   if (r_sym == relocator.cache_sym_val) {
     *found_in = relocator.cache_si;
     *sym = relocator.cache_sym;
-    count_relocation_if<DoLogging>(kRelocSymbolCached);
+    count_relocation_if<DoLogging>(relocator.si, kRelocSymbolCached);
   } else {
-    const version_info* vi = nullptr;
-    if (!relocator.si->lookup_version_info(relocator.version_tracker, r_sym, sym_name, &vi)) {
-      return false;
-    }
-
     soinfo* local_found_in = nullptr;
-    const ElfW(Sym)* local_sym = soinfo_do_lookup(sym_name, vi, &local_found_in, relocator.lookup_list);
+    const ElfW(Sym)* local_sym = nullptr;
+    BindingCache* binding_cache = relocator.binding_cache;
+    if (binding_cache != nullptr &&
+        binding_cache->lookup(r_sym, sym_name, &local_found_in, &local_sym)) {
+      count_relocation_if<DoLogging>(relocator.si, kRelocSymbolBindingCache);
+    } else {
+      const version_info* vi = nullptr;
+      if (!relocator.si->lookup_version_info(relocator.version_tracker, r_sym, sym_name, &vi)) {
+        return false;
+      }
+
+      local_sym = soinfo_do_lookup(sym_name, vi, &local_found_in, relocator.lookup_list);
+      if (binding_cache != nullptr) {
+        binding_cache->record(r_sym, local_found_in, local_sym);
+      }
+    }
 
     relocator.cache_sym_val = r_sym;
     relocator.cache_si = local_found_in;
@@ -123,7 +143,7 @@ static inline bool lookup_symbol(Relocator& relocator, uint32_t r_sym, const cha
     }
   }
 
-  count_relocation_if<DoLogging>(kRelocSymbol);
+  count_relocation_if<DoLogging>(relocator.si, kRelocSymbol);
   return true;
 }
 
@@ -142,8 +162,19 @@ struct linker_stats_t {
 
 static linker_stats_t linker_stats;
 
-void count_relocation(RelocationKind kind) {
+void count_relocation(soinfo* si, RelocationKind kind) {
   ++linker_stats.count[kind];
+  if (!g_reloc_stats_enabled) return;
+
+  android_dl_reloc_stats* stats = si->reloc_stats();
+  switch (kind) {
+    case kRelocAbsolute: ++stats->absolute; break;
+    case kRelocRelative: ++stats->relative; break;
+    case kRelocSymbol: ++stats->symbol_lookups; break;
+    case kRelocSymbolCached: ++stats->symbol_lookups_cached; break;
+    case kRelocSymbolBindingCache: ++stats->symbol_lookups_from_binding_cache; break;
+    case kRelocMax: break;
+  }
 }
 
 void print_linker_stats() {
@@ -224,6 +255,10 @@ static bool process_relocation_impl(Relocator& relocator, const rel_t& reloc) {
     return true;
   }
 
+  if (IsGeneral && relocator.dirty_pages != nullptr) {
+    relocator.dirty_pages->add(reinterpret_cast<ElfW(Addr)>(rel_target));
+  }
+
 #if defined(USE_RELA)
   auto get_addend_rel   = [&]() -> ElfW(Addr) { return reloc.r_addend; };
   auto get_addend_norel = [&]() -> ElfW(Addr) { return reloc.r_addend; };
@@ -311,7 +346,7 @@ static bool process_relocation_impl(Relocator& relocator, const rel_t& reloc) {
 
   if constexpr (IsGeneral || Mode == RelocMode::JumpTable) {
     if (r_type == R_GENERIC_JUMP_SLOT) {
-      count_relocation_if<IsGeneral>(kRelocAbsolute);
+      count_relocation_if<IsGeneral>(relocator.si, kRelocAbsolute);
       const ElfW(Addr) result = sym_addr + get_addend_norel();
       trace_reloc("RELO JMP_SLOT %16p <- %16p %s",
                   rel_target, reinterpret_cast<void*>(result), sym_name);
@@ -325,7 +360,7 @@ static bool process_relocation_impl(Relocator& relocator, const rel_t& reloc) {
     // R_GENERIC_ABSOLUTE. The platform typically uses RELR instead, but R_GENERIC_RELATIVE is
     // common in non-platform binaries.
     if (r_type == R_GENERIC_ABSOLUTE) {
-      count_relocation_if<IsGeneral>(kRelocAbsolute);
+      count_relocation_if<IsGeneral>(relocator.si, kRelocAbsolute);
       const ElfW(Addr) result = sym_addr + get_addend_rel();
       trace_reloc("RELO ABSOLUTE %16p <- %16p %s",
                   rel_target, reinterpret_cast<void*>(result), sym_name);
@@ -335,7 +370,7 @@ static bool process_relocation_impl(Relocator& relocator, const rel_t& reloc) {
       // The i386 psABI specifies that R_386_GLOB_DAT doesn't have an addend. The ARM ELF ABI
       // document (IHI0044F) specifies that R_ARM_GLOB_DAT has an addend, but Bionic isn't adding
       // it.
-      count_relocation_if<IsGeneral>(kRelocAbsolute);
+      count_relocation_if<IsGeneral>(relocator.si, kRelocAbsolute);
       const ElfW(Addr) result = sym_addr + get_addend_norel();
       trace_reloc("RELO GLOB_DAT %16p <- %16p %s",
                   rel_target, reinterpret_cast<void*>(result), sym_name);
@@ -344,7 +379,7 @@ static bool process_relocation_impl(Relocator& relocator, const rel_t& reloc) {
     } else if (r_type == R_GENERIC_RELATIVE) {
       // In practice, r_sym is always zero, but if it weren't, the linker would still look up the
       // referenced symbol (and abort if the symbol isn't found), even though it isn't used.
-      count_relocation_if<IsGeneral>(kRelocRelative);
+      count_relocation_if<IsGeneral>(relocator.si, kRelocRelative);
       const ElfW(Addr) result = relocator.si->load_bias + get_addend_rel();
       trace_reloc("RELO RELATIVE %16p <- %16p",
                   rel_target, reinterpret_cast<void*>(result));
@@ -366,7 +401,7 @@ static bool process_relocation_impl(Relocator& relocator, const rel_t& reloc) {
       // not call them again. (e.g. On arm32, resolving an ifunc changes the meaning of the addend
       // from a resolver function to the implementation.)
       if (!relocator.si->is_linker()) {
-        count_relocation_if<IsGeneral>(kRelocRelative);
+        count_relocation_if<IsGeneral>(relocator.si, kRelocRelative);
         const ElfW(Addr) ifunc_addr = relocator.si->load_bias + get_addend_rel();
         trace_reloc("RELO IRELATIVE %16p <- %16p",
                     rel_target, reinterpret_cast<void*>(ifunc_addr));
@@ -388,7 +423,7 @@ static bool process_relocation_impl(Relocator& relocator, const rel_t& reloc) {
       DL_ERR("%s COPY relocations are not supported", relocator.si->get_realpath());
       return false;
     case R_GENERIC_TLS_TPREL:
-      count_relocation_if<IsGeneral>(kRelocRelative);
+      count_relocation_if<IsGeneral>(relocator.si, kRelocRelative);
       {
         ElfW(Addr) tpoff = 0;
         if (found_in == nullptr) {
@@ -412,7 +447,7 @@ static bool process_relocation_impl(Relocator& relocator, const rel_t& reloc) {
       }
       break;
     case R_GENERIC_TLS_DTPMOD:
-      count_relocation_if<IsGeneral>(kRelocRelative);
+      count_relocation_if<IsGeneral>(relocator.si, kRelocRelative);
       {
         size_t module_id = 0;
         if (found_in == nullptr) {
@@ -428,7 +463,7 @@ static bool process_relocation_impl(Relocator& relocator, const rel_t& reloc) {
       }
       break;
     case R_GENERIC_TLS_DTPREL:
-      count_relocation_if<IsGeneral>(kRelocRelative);
+      count_relocation_if<IsGeneral>(relocator.si, kRelocRelative);
       {
         const ElfW(Addr) result = sym_addr + get_addend_rel() - TLS_DTV_OFFSET;
         trace_reloc("RELO TLS_DTPREL %16p <- %16p %s",
@@ -441,7 +476,7 @@ static bool process_relocation_impl(Relocator& relocator, const rel_t& reloc) {
     // Bionic currently implements TLSDESC for arm64 and riscv64. This implementation should work
     // with other architectures, as long as the resolver functions are implemented.
     case R_GENERIC_TLSDESC:
-      count_relocation_if<IsGeneral>(kRelocRelative);
+      count_relocation_if<IsGeneral>(relocator.si, kRelocRelative);
       {
         ElfW(Addr) addend = reloc.r_addend;
         TlsDescriptor* desc = static_cast<TlsDescriptor*>(rel_target);
@@ -485,7 +520,7 @@ static bool process_relocation_impl(Relocator& relocator, const rel_t& reloc) {
 
 #if defined(__x86_64__)
     case R_X86_64_32:
-      count_relocation_if<IsGeneral>(kRelocAbsolute);
+      count_relocation_if<IsGeneral>(relocator.si, kRelocAbsolute);
       {
         const Elf32_Addr result = sym_addr + reloc.r_addend;
         trace_reloc("RELO R_X86_64_32 %16p <- 0x%08x %s",
@@ -494,7 +529,7 @@ static bool process_relocation_impl(Relocator& relocator, const rel_t& reloc) {
       }
       break;
     case R_X86_64_PC32:
-      count_relocation_if<IsGeneral>(kRelocRelative);
+      count_relocation_if<IsGeneral>(relocator.si, kRelocRelative);
       {
         const ElfW(Addr) target = sym_addr + reloc.r_addend;
         const ElfW(Addr) base = reinterpret_cast<ElfW(Addr)>(rel_target);
@@ -507,7 +542,7 @@ static bool process_relocation_impl(Relocator& relocator, const rel_t& reloc) {
       break;
 #elif defined(__i386__)
     case R_386_PC32:
-      count_relocation_if<IsGeneral>(kRelocRelative);
+      count_relocation_if<IsGeneral>(relocator.si, kRelocRelative);
       {
         const ElfW(Addr) target = sym_addr + get_addend_rel();
         const ElfW(Addr) base = reinterpret_cast<ElfW(Addr)>(rel_target);
@@ -559,10 +594,10 @@ static bool packed_relocate_impl(Relocator& relocator, sleb128_decoder decoder)
 }
 
 static bool needs_slow_relocate_loop(const Relocator& relocator __unused) {
-#if STATS
-  // TODO: This could become a run-time flag.
-  return true;
-#endif
+  if (STATS || g_reloc_stats_enabled) {
+    // Only the general loop counts relocations.
+    return true;
+  }
 #if !defined(__LP64__)
   if (relocator.si->has_text_relocations) return true;
 #endif
@@ -587,6 +622,50 @@ static bool packed_relocate(Relocator& relocator, Args ...args) {
       packed_relocate_impl<OptMode>(relocator, args...);
 }
 
+#if defined(USE_RELA)
+// Leaves the JUMP_SLOT relocations for __linker_lazy_bind to resolve on the first call. Until
+// then, each slot points back into the PLT, which only needs the load bias added. The other PLT
+// relocations (IRELATIVE, TLSDESC) are still applied now.
+static bool lazy_plt_relocate(Relocator& relocator, rel_t* rels, size_t rel_count) {
+  const ElfW(Addr) load_bias = relocator.si->load_bias;
+  for (size_t i = 0; i < rel_count; ++i) {
+    if (ELFW(R_TYPE)(rels[i].r_info) == R_GENERIC_JUMP_SLOT) {
+      ElfW(Addr) slot = rels[i].r_offset + load_bias;
+      *reinterpret_cast<ElfW(Addr)*>(slot) += load_bias;
+      if (relocator.dirty_pages != nullptr) relocator.dirty_pages->add(slot);
+    } else if (!process_relocation<RelocMode::General>(relocator, rels[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+#endif
+
+static bool has_irelative(const rel_t* rels, size_t rel_count) {
+  for (size_t i = 0; i < rel_count; ++i) {
+    if (ELFW(R_TYPE)(rels[i].r_info) == R_GENERIC_IRELATIVE) return true;
+  }
+  return false;
+}
+
+bool soinfo::has_irelative_relocs() const {
+  if (android_relocs_ != nullptr && android_relocs_size_ > 3 &&
+      memcmp(android_relocs_, "APS2", 4) == 0) {
+    bool found = false;
+    for_all_packed_relocs(sleb128_decoder(android_relocs_ + 4, android_relocs_size_ - 4),
+                          [&](const rel_t& reloc) {
+      found = ELFW(R_TYPE)(reloc.r_info) == R_GENERIC_IRELATIVE;
+      return !found;
+    });
+    if (found) return true;
+  }
+#if defined(USE_RELA)
+  return has_irelative(rela_, rela_count_) || has_irelative(plt_rela_, plt_rela_count_);
+#else
+  return has_irelative(rel_, rel_count_) || has_irelative(plt_rel_, plt_rel_count_);
+#endif
+}
+
 bool soinfo::relocate(const SymbolLookupList& lookup_list) {
   // For ldd, don't apply relocations because TLS segments are not registered.
   // We don't care whether ldd diagnoses unresolved symbols.
@@ -608,6 +687,17 @@ bool soinfo::relocate(const SymbolLookupList& lookup_list) {
   relocator.tlsdesc_args = &tlsdesc_args_;
   relocator.tls_tp_base = __libc_shared_globals()->static_tls_layout.offset_thread_pointer();
 
+  BindingCache binding_cache;
+  if (BindingCache::is_enabled() && binding_cache.open(this, lookup_list)) {
+    relocator.binding_cache = &binding_cache;
+  }
+
+  DirtyPageSet dirty_pages;
+  if (g_reloc_stats_enabled) {
+    reloc_stats_ = {};
+    relocator.dirty_pages = &dirty_pages;
+  }
+
   // The linker already applied its RELR relocations in an earlier pass, so
   // skip the RELR relocations for the linker.
   if (relr_ != nullptr && !is_linker()) {
@@ -617,6 +707,12 @@ bool soinfo::relocate(const SymbolLookupList& lookup_list) {
     if (!relocate_relr(begin, end, load_bias)) {
       return false;
     }
+    if (relocator.dirty_pages != nullptr) {
+      for_each_relr_offset(begin, end, [&](ElfW(Addr) offset) {
+        ++reloc_stats_.relr;
+        dirty_pages.add(offset + load_bias);
+      });
+    }
   }
 
   if (android_relocs_ != nullptr) {
@@ -648,7 +744,12 @@ bool soinfo::relocate(const SymbolLookupList& lookup_list) {
       return false;
     }
   }
-  if (plt_rela_ != nullptr) {
+  if (plt_rela_ != nullptr && can_bind_lazily()) {
+    DEBUG("[ relocating %s plt rela for lazy binding ]", get_realpath());
+    if (!lazy_plt_relocate(relocator, plt_rela_, plt_rela_count_) || !prepare_lazy_binding()) {
+      return false;
+    }
+  } else if (plt_rela_ != nullptr) {
     DEBUG("[ relocating %s plt rela ]", get_realpath());
     if (!plain_relocate<RelocMode::JumpTable>(relocator, plt_rela_, plt_rela_count_)) {
       return false;
@@ -680,5 +781,13 @@ bool soinfo::relocate(const SymbolLookupList& lookup_list) {
   }
 #endif // defined(__aarch64__) || defined(__riscv)
 
+  if (relocator.binding_cache != nullptr) {
+    binding_cache.commit();
+  }
+
+  if (relocator.dirty_pages != nullptr) {
+    reloc_stats_.dirty_pages = dirty_pages.count();
+  }
+
   return true;
 }
@@ -46,13 +46,14 @@ enum RelocationKind {
   kRelocRelative,
   kRelocSymbol,
   kRelocSymbolCached,
+  kRelocSymbolBindingCache,
   kRelocMax
 };
 
-void count_relocation(RelocationKind kind);
+void count_relocation(soinfo* si, RelocationKind kind);
 
-template <bool Enabled> void count_relocation_if(RelocationKind kind) {
-  if (Enabled) count_relocation(kind);
+template <bool Enabled> void count_relocation_if(soinfo* si, RelocationKind kind) {
+  if (Enabled) count_relocation(si, kind);
 }
 
 void print_linker_stats();
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "linker_relr.h"
+
+// Encodes the word offsets in `offsets` (sorted, word-aligned) as SHT_RELR, as lld does.
+static std::vector<ElfW(Relr)> encode_relr(const std::vector<ElfW(Addr)>& offsets) {
+  constexpr size_t wordsize = sizeof(ElfW(Addr));
+  constexpr size_t nbits = 8 * wordsize - 1;
+
+  std::vector<ElfW(Relr)> relr;
+  for (size_t i = 0; i < offsets.size();) {
+    relr.push_back(offsets[i]);
+    ElfW(Addr) base = offsets[i] + wordsize;
+    ++i;
+    while (true) {
+      ElfW(Relr) bitmap = 0;
+      for (; i < offsets.size(); ++i) {
+        ElfW(Addr) delta = offsets[i] - base;
+        if (delta >= nbits * wordsize) break;
+        bitmap |= static_cast<ElfW(Relr)>(1) << (delta / wordsize);
+      }
+      if (bitmap == 0) break;
+      relr.push_back((bitmap << 1) | 1);
+      base += nbits * wordsize;
+    }
+  }
+  return relr;
+}
+
+static void check_relr(const std::vector<size_t>& word_indices, size_t word_count) {
+  std::vector<ElfW(Addr)> offsets;
+  for (size_t index : word_indices) offsets.push_back(index * sizeof(ElfW(Addr)));
+  std::vector<ElfW(Relr)> relr = encode_relr(offsets);
+
+  std::vector<ElfW(Addr)> words(word_count, 0);
+  ElfW(Addr) load_bias = reinterpret_cast<ElfW(Addr)>(words.data());
+  ASSERT_TRUE(relocate_relr(relr.data(), relr.data() + relr.size(), load_bias));
+
+  std::vector<ElfW(Addr)> expected(word_count, 0);
+  for (size_t index : word_indices) expected[index] = load_bias;
+  ASSERT_EQ(expected, words);
+}
+
+TEST(linker_relr, empty) {
+  check_relr({}, 4);
+}
+
+TEST(linker_relr, single) {
+  check_relr({3}, 4);
+}
+
+TEST(linker_relr, dense) {
+  std::vector<size_t> indices;
+  for (size_t i = 0; i < 500; ++i) indices.push_back(i);
+  check_relr(indices, 500);
+}
+
+TEST(linker_relr, sparse) {
+  // Covers both ends of each bitmap and gaps larger than a bitmap.
+  std::vector<size_t> indices = {0, 1, 8 * sizeof(ElfW(Addr)) - 1, 8 * sizeof(ElfW(Addr)),
+                                 2 * 8 * sizeof(ElfW(Addr)) - 2, 300, 301, 1000};
+  check_relr(indices, 1001);
+}
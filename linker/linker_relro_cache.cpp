@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "linker_relro_cache.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/personality.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "linker_debug.h"
+#include "linker_phdr.h"
+#include "linker_soinfo.h"
+#include "linker_utils.h"
+
+std::string RelroCache::directory_;
+bool RelroCache::aslr_disabled_ = false;
+
+static bool is_aslr_disabled() {
+  int persona = personality(0xffffffff);
+  if (persona != -1 && (persona & ADDR_NO_RANDOMIZE) != 0) return true;
+
+  int fd = TEMP_FAILURE_RETRY(open("/proc/sys/kernel/randomize_va_space", O_RDONLY | O_CLOEXEC));
+  if (fd == -1) return false;
+  char level = 0;
+  bool disabled = TEMP_FAILURE_RETRY(read(fd, &level, 1)) == 1 && level == '0';
+  close(fd);
+  return disabled;
+}
+
+void RelroCache::set_directory(const char* path) {
+  directory_ = (path != nullptr) ? path : "";
+  if (!directory_.empty()) aslr_disabled_ = is_aslr_disabled();
+}
+
+void RelroCache::trim_directory() {
+  DIR* dir = opendir(directory_.c_str());
+  if (dir == nullptr) return;
+
+  std::vector<std::pair<timespec, std::string>> files;
+  dirent* entry;
+  while ((entry = readdir(dir)) != nullptr) {
+    size_t length = strlen(entry->d_name);
+    if (length < 6 || strcmp(entry->d_name + length - 6, ".relro") != 0) continue;
+    struct stat file_stat;
+    if (fstatat(dirfd(dir), entry->d_name, &file_stat, AT_SYMLINK_NOFOLLOW) == 0) {
+      files.emplace_back(file_stat.st_mtim, entry->d_name);
+    }
+  }
+
+  if (files.size() >= kMaxFiles) {
+    auto older = [](const std::pair<timespec, std::string>& a,
+                    const std::pair<timespec, std::string>& b) {
+      return a.first.tv_sec != b.first.tv_sec ? a.first.tv_sec < b.first.tv_sec
+                                              : a.first.tv_nsec < b.first.tv_nsec;
+    };
+    std::sort(files.begin(), files.end(), older);
+    // Processes that have already mapped a removed file keep their mapping.
+    for (size_t i = 0; i <= files.size() - kMaxFiles; ++i) {
+      unlinkat(dirfd(dir), files[i].second.c_str(), 0);
+    }
+  }
+  closedir(dir);
+}
+
+void RelroCache::share(const soinfo* si) {
+  // A library at a randomized address would get a file of its own in every process.
+  if (!aslr_disabled_ && !si->is_mapped_by_caller()) return;
+
+  const uint8_t* build_id;
+  size_t build_id_size;
+  if (!phdr_table_get_build_id(si->phdr, si->phnum, si->load_bias, &build_id, &build_id_size)) {
+    return;
+  }
+
+  bool has_relro = false;
+  for (size_t i = 0; i < si->phnum; ++i) {
+    if (si->phdr[i].p_type == PT_GNU_RELRO && si->phdr[i].p_memsz != 0) {
+      has_relro = true;
+      break;
+    }
+  }
+  if (!has_relro) return;
+
+  std::string path = directory_ + "/";
+  for (size_t i = 0; i < build_id_size && i < 64; ++i) {
+    char hex[3];
+    snprintf(hex, sizeof(hex), "%02x", build_id[i]);
+    path += hex;
+  }
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), "-%" PRIxPTR ".relro", static_cast<uintptr_t>(si->load_bias));
+  path += suffix;
+
+  // The file is mapped over the library's RELRO, and later changes to it show through pages that
+  // haven't been written to, so only files that nobody else can write are used.
+  size_t file_offset = 0;
+  struct stat file_stat;
+  int fd = open_trusted_file(path, &file_stat);
+  if (fd != -1) {
+    if (phdr_table_map_gnu_relro(si->phdr, si->phnum, si->load_bias, fd, &file_offset) == -1) {
+      DEBUG("[ couldn't map RELRO cache file %s: %m ]", path.c_str());
+    } else {
+      DEBUG("[ mapped RELRO cache file %s for %s ]", path.c_str(), si->get_realpath());
+      // Record the use, for trim_directory().
+      futimens(fd, nullptr);
+    }
+    close(fd);
+    return;
+  }
+  if (errno != ENOENT) {
+    DEBUG("[ couldn't open RELRO cache file %s: %m ]", path.c_str());
+    return;
+  }
+
+  trim_directory();
+
+  // The mapping made by phdr_table_serialize_gnu_relro() stays valid even if the file can't be
+  // renamed into place.
+  write_trusted_file(path, 0444, [](int fd, const void* arg) {
+    const soinfo* si = static_cast<const soinfo*>(arg);
+    size_t file_offset = 0;
+    return phdr_table_serialize_gnu_relro(si->phdr, si->phnum, si->load_bias, fd,
+                                          &file_offset) == 0;
+  }, si);
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#include <string>
+
+struct soinfo;
+
+// An opt-in, linker-managed version of ANDROID_DLEXT_WRITE_RELRO/ANDROID_DLEXT_USE_RELRO.
+//
+// When LD_RELRO_CACHE_DIR names a directory, the relocated GNU_RELRO pages of libraries with a
+// build ID are shared through a file in it. The file is keyed by the build ID and the load
+// address. The first process to relocate a library at a given address writes its RELRO there and
+// maps the file over its own pages. Later processes that load the same library at the same address
+// map the file over every page that matches what they relocated themselves. Pages that differ,
+// because a dependency was loaded somewhere else, stay private, so a stale or foreign file can
+// only cost memory, never change behavior.
+//
+// Relocated RELRO holds absolute addresses, so it can only be shared between processes that load
+// a library at the same address. Libraries are therefore only cached if their address doesn't
+// depend on ASLR: they were loaded into a caller-reserved region (ANDROID_DLEXT_RESERVED_ADDRESS,
+// which zygote children inherit), or address randomization is off. The directory holds at most
+// kMaxFiles files; the least recently used are removed to make room for new ones.
+//
+// The pages are mapped MAP_PRIVATE from the file, so changes to the file show through pages that
+// haven't been written to since. Files are therefore only used if they, and the directory, belong
+// to root or to this process's effective uid and aren't writable by anyone else; see
+// open_trusted_file().
+class RelroCache {
+ public:
+  static void set_directory(const char* path);
+  static bool is_enabled() { return !directory_.empty(); }
+
+  // Shares the RELRO of `si`, which must already be relocated and read-only.
+  static void share(const soinfo* si);
+
+  static constexpr size_t kMaxFiles = 256;
+
+ private:
+  static void trim_directory();
+
+  static std::string directory_;
+  // Whether this process loads libraries at the same addresses every time.
+  static bool aslr_disabled_;
+};
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "linker_reservation_pool.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// The pool is a small array in the linker's .bss, ordered from the least to the most recently
+// returned reservation, so it never needs the linker's allocator.
+static constexpr size_t kMaxPooledRegions = 64;
+
+struct PooledRegion {
+  void* start;
+  size_t size;
+  void* gap_start;
+  size_t gap_size;
+
+  size_t total_size() const { return size + gap_size; }
+};
+
+static PooledRegion g_regions[kMaxPooledRegions];
+static android_dl_reservation_pool_stats g_stats;
+
+static void unmap_region(const PooledRegion& region) {
+  munmap(region.start, region.size);
+  if (region.gap_size != 0) {
+    munmap(region.gap_start, region.gap_size);
+  }
+}
+
+static void remove_region(size_t i) {
+  g_stats.bytes -= g_regions[i].total_size();
+  --g_stats.regions;
+  memmove(&g_regions[i], &g_regions[i + 1], (g_stats.regions - i) * sizeof(PooledRegion));
+}
+
+// Evicts the least recently returned reservations until the pool fits its limits.
+static void trim_pool() {
+  while (g_stats.regions > g_stats.max_regions || g_stats.bytes > g_stats.max_bytes) {
+    unmap_region(g_regions[0]);
+    remove_region(0);
+    ++g_stats.evictions;
+  }
+}
+
+void reservation_pool_set_limits(size_t max_regions, size_t max_bytes) {
+  g_stats.max_regions = max_regions < kMaxPooledRegions ? max_regions : kMaxPooledRegions;
+  g_stats.max_bytes = g_stats.max_regions != 0 ? max_bytes : 0;
+  trim_pool();
+}
+
+void reservation_pool_get_stats(android_dl_reservation_pool_stats* stats) {
+  *stats = g_stats;
+}
+
+void* reservation_pool_take(size_t size, size_t alignment, void** gap_start, size_t* gap_size) {
+  if (g_stats.max_regions == 0) return nullptr;
+
+  // Search from the most recently returned reservation, which is the likeliest to belong to the
+  // library being loaded again.
+  for (size_t i = g_stats.regions; i-- > 0;) {
+    const PooledRegion& region = g_regions[i];
+    if (region.size == size && (reinterpret_cast<uintptr_t>(region.start) % alignment) == 0) {
+      void* start = region.start;
+      *gap_start = region.gap_start;
+      *gap_size = region.gap_size;
+      remove_region(i);
+      ++g_stats.hits;
+      return start;
+    }
+  }
+  ++g_stats.misses;
+  return nullptr;
+}
+
+bool reservation_pool_put(void* start, size_t size, void* gap_start, size_t gap_size) {
+  if (g_stats.max_regions == 0 || size + gap_size > g_stats.max_bytes) return false;
+
+  // Replacing the library's mappings with a fresh PROT_NONE one drops its pages and its reference
+  // to the file in the same call, and leaves a single VMA where there was one per segment. The
+  // gap is already PROT_NONE and untouched.
+  if (mmap(start, size, PROT_NONE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1,
+           0) == MAP_FAILED) {
+    return false;
+  }
+
+  if (g_stats.regions == g_stats.max_regions) {
+    unmap_region(g_regions[0]);
+    remove_region(0);
+    ++g_stats.evictions;
+  }
+  g_regions[g_stats.regions++] = {start, size, gap_start, gap_size};
+  g_stats.bytes += size + gap_size;
+  trim_pool();
+  return true;
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#include "private/bionic_dl_reservation_pool.h"
+
+// A pool of address space reservations. When a library is unloaded, its reservation (and any
+// ASLR gap after it) is reset to a single PROT_NONE mapping and kept, instead of being unmapped,
+// and a later load of a library of the same size takes it back instead of reserving new address
+// space. Processes that load and unload the same plugins over and over then skip most of the
+// mmap()/munmap() calls, the VMA churn, and the TLB shootdowns that unmapping causes.
+//
+// A reused reservation keeps its address, so the library doesn't get a fresh random one. The pool
+// is therefore off by default: it's turned on by LD_RESERVATION_POOL=<max regions>, or at runtime
+// by android_dl_set_reservation_pool_limits(). All of these functions must be called with the
+// loader lock held exclusively.
+
+void reservation_pool_set_limits(size_t max_regions, size_t max_bytes);
+void reservation_pool_get_stats(android_dl_reservation_pool_stats* stats);
+
+// Returns a pooled reservation of exactly `size` bytes whose start is aligned to `alignment`, or
+// nullptr if there isn't one (or the pool is off). The reservation's gap, if it has one, is
+// returned in `gap_start` and `gap_size`.
+void* reservation_pool_take(size_t size, size_t alignment, void** gap_start, size_t* gap_size);
+
+// Offers the reservation [start, start + size) and its gap to the pool. Returns true if the pool
+// kept them, and false if the caller should unmap them as usual.
+bool reservation_pool_put(void* start, size_t size, void* gap_start, size_t gap_size);
@@ -29,6 +29,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <sys/types.h>
 
 #include <async_safe/log.h>
 
@@ -43,6 +44,18 @@ class sleb128_decoder {
       : current_(buffer), end_(buffer+count) { }
 
   size_t pop_front() {
+    // Most values in packed relocations (group sizes and flags, and small offset deltas) fit in a
+    // single byte, so decode those inline and leave the rest to the out-of-line loop.
+    if (__predict_true(current_ < end_ && (*current_ & 128) == 0)) {
+      // Sign-extend from bit 6.
+      const int8_t byte = static_cast<int8_t>(*current_++ << 1);
+      return static_cast<size_t>(static_cast<ssize_t>(byte >> 1));
+    }
+    return pop_front_multibyte();
+  }
+
+ private:
+  __attribute__((noinline)) size_t pop_front_multibyte() {
     size_t value = 0;
     static const size_t size = CHAR_BIT * sizeof(value);
 
@@ -65,7 +78,6 @@ class sleb128_decoder {
     return value;
   }
 
- private:
   const uint8_t* current_;
   const uint8_t* const end_;
 };
@@ -34,6 +34,8 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 #include <async_safe/log.h>
 
 #include "linker.h"
@@ -41,7 +43,10 @@
 #include "linker_debug.h"
 #include "linker_globals.h"
 #include "linker_gnu_hash.h"
+#include "linker_lazy_bind.h"
+#include "linker_load_timeline.h"
 #include "linker_logger.h"
+#include "linker_phdr.h"
 #include "linker_relocate.h"
 #include "linker_utils.h"
 
@@ -76,6 +81,9 @@ SymbolLookupList::SymbolLookupList(const soinfo_list_t& global_group, const soin
 
   begin_ = &libs_[1];
   end_ = &libs_[0] + libs_.size();
+
+  // The cache would hide repeated lookups from the lookup trace.
+  lookup_cache_enabled_ = !is_lookup_tracing_enabled();
 }
 
 /* "This element's presence in a shared object library alters the dynamic linker's
@@ -91,10 +99,131 @@ SymbolLookupList::SymbolLookupList(const soinfo_list_t& global_group, const soin
  */
 void SymbolLookupList::set_dt_symbolic_lib(soinfo* lib) {
   CHECK(!libs_.empty());
+  if (lib != libs_[0].si_) {
+    lookup_cache_.clear();
+  }
   slow_path_count_ -= libs_[0].needs_sysv_lookup();
   libs_[0] = lib ? lib->get_lookup_lib() : SymbolLookupLib();
   slow_path_count_ += libs_[0].needs_sysv_lookup();
   begin_ = lib ? &libs_[0] : &libs_[1];
+  has_build_id_hash_ = false;
+}
+
+uint64_t SymbolLookupList::get_build_id_hash() const {
+  if (has_build_id_hash_) return build_id_hash_;
+
+  // 64-bit FNV-1a over the length-prefixed build IDs.
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  auto mix = [&hash](const void* data, size_t size) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+      hash = (hash ^ p[i]) * 0x100000001b3ULL;
+    }
+  };
+
+  for (const SymbolLookupLib* lib = begin_; lib != end_; ++lib) {
+    const uint8_t* build_id = nullptr;
+    size_t build_id_size = 0;
+    if (lib->si_ == nullptr ||
+        !phdr_table_get_build_id(lib->si_->phdr, lib->si_->phnum, lib->si_->load_bias,
+                                 &build_id, &build_id_size)) {
+      hash = 0;
+      break;
+    }
+    mix(&build_id_size, sizeof(build_id_size));
+    mix(build_id, build_id_size);
+  }
+
+  build_id_hash_ = hash;
+  has_build_id_hash_ = true;
+  return build_id_hash_;
+}
+
+void SymbolLookupList::set_lookup_cache_enabled(bool enabled) {
+  lookup_cache_enabled_ = enabled && !is_lookup_tracing_enabled();
+  if (!lookup_cache_enabled_) {
+    lookup_cache_.clear();
+  }
+}
+
+uint32_t soinfo::get_version_id(size_t index) const {
+  return index < version_ids_.size() ? version_ids_[index] : 0;
+}
+
+ElfW(Versym) soinfo::find_verdef_index(uint32_t id) const {
+  auto it = std::lower_bound(verdef_ids_.begin(), verdef_ids_.end(), id,
+                             [](const auto& entry, uint32_t id) { return entry.first < id; });
+  return (it != verdef_ids_.end() && it->first == id) ? it->second : kVersymGlobal;
+}
+
+bool SymbolLookupCache::Entry::matches_version(const version_info* vi) const {
+  if (vi == nullptr) {
+    return version == nullptr;
+  }
+  return version != nullptr && version_hash == vi->elf_hash && strcmp(version, vi->name) == 0;
+}
+
+// Linear probing over a power-of-two table, indexed by the low bits of the GNU hash.
+const SymbolLookupCache::Entry* SymbolLookupCache::find(const char* name, uint32_t hash) const {
+  if (entries_.empty()) {
+    return nullptr;
+  }
+  const size_t mask = entries_.size() - 1;
+  for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+    const Entry& entry = entries_[i];
+    if (entry.name == nullptr) {
+      return nullptr;
+    }
+    if (entry.hash == hash && strcmp(entry.name, name) == 0) {
+      return &entry;
+    }
+  }
+}
+
+SymbolLookupCache::Entry* SymbolLookupCache::find_slot(const char* name, uint32_t hash) {
+  const size_t mask = entries_.size() - 1;
+  for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+    Entry& entry = entries_[i];
+    if (entry.name == nullptr || (entry.hash == hash && strcmp(entry.name, name) == 0)) {
+      return &entry;
+    }
+  }
+}
+
+void SymbolLookupCache::insert(const char* name, uint32_t hash, const version_info* vi,
+                               uint32_t absent_prefix, soinfo* si_found_in,
+                               const ElfW(Sym)* sym) {
+  static constexpr size_t kInitialCapacity = 256;
+
+  // Keep the table at most 3/4 full.
+  if ((size_ + 1) * 4 > entries_.size() * 3) {
+    std::vector<Entry> old_entries(entries_.empty() ? kInitialCapacity : entries_.size() * 2);
+    old_entries.swap(entries_);
+    for (const Entry& entry : old_entries) {
+      if (entry.name != nullptr) {
+        *find_slot(entry.name, entry.hash) = entry;
+      }
+    }
+  }
+
+  Entry* entry = find_slot(name, hash);
+  if (entry->name == nullptr) {
+    ++size_;
+  }
+  *entry = Entry {
+    .name = name,
+    .version = vi != nullptr ? vi->name : nullptr,
+    .hash = hash,
+    .version_hash = vi != nullptr ? vi->elf_hash : 0,
+    .absent_prefix = absent_prefix,
+    .si_found_in = si_found_in,
+    .sym = sym,
+  };
+}
+
+void SymbolLookupCache::clear() {
+  std::vector<Entry>().swap(entries_);
+  size_ = 0;
 }
 
 // Check whether a requested version matches the version on a symbol definition. There are a few
@@ -116,14 +245,20 @@ static inline bool check_symbol_version(const ElfW(Versym)* ver_table, uint32_t
 
 template <bool IsGeneral>
 __attribute__((noinline)) static const ElfW(Sym)*
-soinfo_do_lookup_impl(const char* name, const version_info* vi,
-                      soinfo** si_found_in, const SymbolLookupList& lookup_list) {
-  const auto [ hash, name_len ] = calculate_gnu_hash(name);
+soinfo_do_lookup_impl(const char* name, uint32_t hash, uint32_t name_len, const version_info* vi,
+                      soinfo** si_found_in, const SymbolLookupLib* it, const SymbolLookupLib* end,
+                      const SymbolLookupLib** name_found_in) {
   constexpr uint32_t kBloomMaskBits = sizeof(ElfW(Addr)) * 8;
   SymbolName elf_symbol_name(name);
 
-  const SymbolLookupLib* end = lookup_list.end();
-  const SymbolLookupLib* it = lookup_list.begin();
+  // The first library that may define the name in some version. A library using the SysV hash
+  // table only reports matching versions, so it's treated as defining the name.
+  *name_found_in = end;
+
+  // On the fast path, the Bloom filters are probed a batch at a time. bloom_matches holds the
+  // libraries of the current batch (relative to bloom_batch) that haven't been searched yet.
+  const SymbolLookupLib* bloom_batch = it;
+  uint32_t bloom_matches = 0;
 
   while (true) {
     const SymbolLookupLib* lib;
@@ -132,10 +267,29 @@ soinfo_do_lookup_impl(const char* name, const version_info* vi,
     // Iterate over libraries until we find one whose Bloom filter matches the symbol we're
     // searching for.
     while (true) {
+      if (!IsGeneral) {
+        if (bloom_matches == 0) {
+          if (it == end) return nullptr;
+          const size_t count = std::min<size_t>(end - it, kGnuBloomProbeBatchSize);
+          bloom_batch = it;
+          bloom_matches = gnu_bloom_filter_probe(bloom_batch, count, hash);
+          it += count;
+          continue;
+        }
+        lib = bloom_batch + __builtin_ctz(bloom_matches);
+        bloom_matches &= bloom_matches - 1;
+        sym_idx = lib->gnu_bucket_[hash % lib->gnu_nbucket_];
+        if (sym_idx != 0) {
+          break;
+        }
+        continue;
+      }
+
       if (it == end) return nullptr;
       lib = it++;
 
       if (IsGeneral && lib->needs_sysv_lookup()) {
+        if (*name_found_in == end) *name_found_in = lib;
         if (const ElfW(Sym)* sym = lib->si_->find_symbol_by_name(elf_symbol_name, vi)) {
           *si_found_in = lib->si_;
           return sym;
@@ -171,14 +325,15 @@ soinfo_do_lookup_impl(const char* name, const version_info* vi,
     do {
       sym = lib->symtab_ + sym_idx;
       chain_value = lib->gnu_chain_[sym_idx];
-      if ((chain_value >> 1) == (hash >> 1)) {
+      if ((chain_value >> 1) == (hash >> 1) &&
+          static_cast<size_t>(sym->st_name) + name_len + 1 <= lib->strtab_size_ &&
+          memcmp(lib->strtab_ + sym->st_name, name, name_len + 1) == 0) {
+        if (*name_found_in == end) *name_found_in = lib;
         if (vi != nullptr && !calculated_verneed) {
           calculated_verneed = true;
           verneed = find_verdef_version_index(lib->si_, vi);
         }
         if (check_symbol_version(lib->versym_, sym_idx, verneed) &&
-            static_cast<size_t>(sym->st_name) + name_len + 1 <= lib->strtab_size_ &&
-            memcmp(lib->strtab_ + sym->st_name, name, name_len + 1) == 0 &&
             is_symbol_global_and_defined(lib->si_, sym)) {
           *si_found_in = lib->si_;
           return sym;
@@ -191,9 +346,38 @@ soinfo_do_lookup_impl(const char* name, const version_info* vi,
 
 const ElfW(Sym)* soinfo_do_lookup(const char* name, const version_info* vi,
                                   soinfo** si_found_in, const SymbolLookupList& lookup_list) {
-  return lookup_list.needs_slow_path() ?
-      soinfo_do_lookup_impl<true>(name, vi, si_found_in, lookup_list) :
-      soinfo_do_lookup_impl<false>(name, vi, si_found_in, lookup_list);
+  const auto [ hash, name_len ] = calculate_gnu_hash(name);
+  const SymbolLookupLib* begin = lookup_list.begin();
+  const SymbolLookupLib* end = lookup_list.end();
+
+  // A cached entry for the name either answers the lookup outright or, if it was made for a
+  // different version, tells us which libraries can be skipped.
+  SymbolLookupCache* cache = lookup_list.lookup_cache();
+  const SymbolLookupLib* start = begin;
+  if (cache != nullptr) {
+    if (const SymbolLookupCache::Entry* entry = cache->find(name, hash)) {
+      if (entry->matches_version(vi)) {
+        if (entry->sym != nullptr) {
+          *si_found_in = entry->si_found_in;
+        }
+        return entry->sym;
+      }
+      start += entry->absent_prefix;
+    }
+  }
+
+  const SymbolLookupLib* name_found_in = nullptr;
+  const ElfW(Sym)* sym = lookup_list.needs_slow_path() ?
+      soinfo_do_lookup_impl<true>(name, hash, name_len, vi, si_found_in, start, end,
+                                  &name_found_in) :
+      soinfo_do_lookup_impl<false>(name, hash, name_len, vi, si_found_in, start, end,
+                                   &name_found_in);
+
+  if (cache != nullptr) {
+    cache->insert(name, hash, vi, name_found_in - begin,
+                  sym != nullptr ? *si_found_in : nullptr, sym);
+  }
+  return sym;
 }
 
 soinfo::soinfo(android_namespace_t* ns, const char* realpath, const struct stat* file_stat,
@@ -217,6 +401,7 @@ soinfo::soinfo(android_namespace_t* ns, const char* realpath, const struct stat*
 
 soinfo::~soinfo() {
   g_soinfo_handles_map.erase(handle_);
+  free_lazy_bind_state(lazy_bind_state_);
 }
 
 void soinfo::set_dt_runpath(const char* path) {
@@ -422,6 +607,50 @@ ElfW(Sym)* soinfo::elf_addr_lookup(const void* addr) {
   return nullptr;
 }
 
+static bool symbol_can_contain_address(const ElfW(Sym)* sym) {
+  return sym->st_shndx != SHN_UNDEF && ELF_ST_TYPE(sym->st_info) != STT_TLS && sym->st_size != 0;
+}
+
+void soinfo::get_address_lookup_candidates(std::vector<uint32_t>* indices) const {
+  if (is_gnu_hash()) {
+    for (size_t i = 0; i < gnu_nbucket_; ++i) {
+      uint32_t n = gnu_bucket_[i];
+      if (n == 0) {
+        continue;
+      }
+
+      do {
+        if (symbol_can_contain_address(symtab_ + n)) indices->push_back(n);
+      } while ((gnu_chain_[n++] & 1) == 0);
+    }
+  } else {
+    for (size_t i = 0; i < nchain_; ++i) {
+      if (symbol_can_contain_address(symtab_ + i)) indices->push_back(i);
+    }
+  }
+}
+
+size_t soinfo::get_symbol_count() {
+  if (symbol_count_ != 0) return symbol_count_;
+
+  if (!is_gnu_hash()) {
+    symbol_count_ = nchain_;
+    return symbol_count_;
+  }
+
+  // DT_GNU_HASH doesn't record the size of the symbol table, but every symbol after the first
+  // hashed one is on a chain, and the last chain ends at the last symbol.
+  uint32_t last = 0;
+  for (size_t i = 0; i < gnu_nbucket_; ++i) {
+    last = std::max(last, gnu_bucket_[i]);
+  }
+  if (last != 0) {
+    while ((gnu_chain_[last] & 1) == 0) ++last;
+  }
+  symbol_count_ = last + 1;
+  return symbol_count_;
+}
+
 static void call_function(const char* function_name __unused,
                           linker_ctor_function_t function,
                           const char* realpath __unused) {
@@ -504,8 +733,11 @@ void soinfo::call_constructors() {
   }
 
   // DT_INIT should be called before DT_INIT_ARRAY if both are present.
-  call_function("DT_INIT", init_func_, get_realpath());
-  call_array("DT_INIT_ARRAY", init_array_, init_array_count_, false, get_realpath());
+  {
+    ScopedLoadPhase phase(get_realpath(), ANDROID_DL_LOAD_PHASE_CONSTRUCTORS);
+    call_function("DT_INIT", init_func_, get_realpath());
+    call_array("DT_INIT_ARRAY", init_array_, init_array_count_, false, get_realpath());
+  }
 
   if (!is_linker()) {
     bionic_trace_end();
@@ -37,6 +37,7 @@
 #include "async_safe/CHECK.h"
 #include "linker_namespaces.h"
 #include "linker_tls.h"
+#include "private/bionic_dl_reloc_stats.h"
 #include "private/bionic_elf_tls.h"
 #include "private/bionic_globals.h"
 
@@ -95,6 +96,38 @@ struct SymbolLookupLib {
   bool needs_sysv_lookup() const { return si_ != nullptr && gnu_bloom_filter_ == nullptr; }
 };
 
+struct version_info;
+
+// Remembers the outcome of earlier lookups against a SymbolLookupList, so that a symbol referenced
+// by many libraries of a group (e.g. __cxa_* or operator new) is only searched for once. Entries
+// are keyed by symbol name; each one holds the result for the most recently requested version.
+class SymbolLookupCache {
+ public:
+  struct Entry {
+    const char* name;     // nullptr for an empty slot
+    const char* version;  // nullptr if no version was requested
+    uint32_t hash;
+    uint32_t version_hash;
+    // The number of libraries at the start of the list that don't define the name in any version.
+    uint32_t absent_prefix;
+    soinfo* si_found_in;
+    const ElfW(Sym)* sym;  // nullptr if the symbol wasn't found
+
+    bool matches_version(const version_info* vi) const;
+  };
+
+  const Entry* find(const char* name, uint32_t hash) const;
+  void insert(const char* name, uint32_t hash, const version_info* vi, uint32_t absent_prefix,
+              soinfo* si_found_in, const ElfW(Sym)* sym);
+  void clear();
+
+ private:
+  Entry* find_slot(const char* name, uint32_t hash);
+
+  std::vector<Entry> entries_;
+  size_t size_ = 0;
+};
+
 // A list of libraries to search for a symbol.
 class SymbolLookupList {
   std::vector<SymbolLookupLib> libs_;
@@ -102,6 +135,10 @@ class SymbolLookupList {
   const SymbolLookupLib* begin_;
   const SymbolLookupLib* end_;
   size_t slow_path_count_ = 0;
+  mutable uint64_t build_id_hash_ = 0;
+  mutable bool has_build_id_hash_ = false;
+  mutable SymbolLookupCache lookup_cache_;
+  bool lookup_cache_enabled_ = false;
 
  public:
   explicit SymbolLookupList(soinfo* si);
@@ -111,6 +148,17 @@ class SymbolLookupList {
   const SymbolLookupLib* begin() const { return begin_; }
   const SymbolLookupLib* end() const { return end_; }
   bool needs_slow_path() const { return slow_path_count_ > 0; }
+
+  // Returns the cache of earlier lookups against this list, or nullptr if lookups aren't cached.
+  // The cache isn't thread-safe, so it must be disabled before the list is shared by threads.
+  SymbolLookupCache* lookup_cache() const {
+    return lookup_cache_enabled_ ? &lookup_cache_ : nullptr;
+  }
+  void set_lookup_cache_enabled(bool enabled);
+
+  // Returns a hash of the build IDs of every library in the list (in lookup order), or 0 if any
+  // of them has no build ID. The result is computed once and cached.
+  uint64_t get_build_id_hash() const;
 };
 
 class SymbolName {
@@ -137,15 +185,18 @@ class SymbolName {
 };
 
 struct version_info {
-  constexpr version_info() : elf_hash(0), name(nullptr), target_si(nullptr) {}
+  constexpr version_info() : elf_hash(0), name(nullptr), target_si(nullptr), id(0) {}
 
   uint32_t elf_hash;
   const char* name;
   const soinfo* target_si;
+  // The interned id of `name`, or 0 if it isn't known (see soinfo::init_version_ids).
+  uint32_t id;
 };
 
 // TODO(dimitry): remove reference from soinfo member functions to this class.
 class VersionTracker;
+struct LazyBindState;
 
 struct soinfo_tls {
   TlsSegment segment;
@@ -255,6 +306,9 @@ struct soinfo {
   bool prelink_image();
   bool link_image(const SymbolLookupList& lookup_list, soinfo* local_group_root,
                   const android_dlextinfo* extinfo, size_t* relro_fd_offset);
+  bool relocate_image(const SymbolLookupList& lookup_list, soinfo* local_group_root,
+                      const android_dlextinfo* extinfo, size_t* relro_fd_offset);
+  void publish_image();
   bool protect_relro();
 
   void add_child(soinfo* child);
@@ -277,6 +331,10 @@ struct soinfo {
 
   ElfW(Sym)* find_symbol_by_address(const void* addr);
 
+  // Appends the indices of the symbols that find_symbol_by_address() could return, in the order
+  // it considers them. Used to build an address-sorted table of this library's symbols.
+  void get_address_lookup_candidates(std::vector<uint32_t>* indices) const;
+
   ElfW(Addr) resolve_symbol_address(const ElfW(Sym)* s) const {
     if (ELF_ST_TYPE(s->st_info) == STT_GNU_IFUNC) {
       return call_ifunc_resolver(s->st_value + load_bias);
@@ -286,6 +344,12 @@ struct soinfo {
   }
 
   const char* get_string(ElfW(Word) index) const;
+  const ElfW(Sym)* get_symtab() const { return symtab_; }
+  const char* get_strtab() const { return strtab_; }
+  size_t get_strtab_size() const { return strtab_size_; }
+  // The number of entries in the dynamic symbol table, for checking indices that don't come from
+  // the library itself.
+  size_t get_symbol_count();
   bool can_unload() const;
   bool is_gnu_hash() const;
 
@@ -302,6 +366,7 @@ struct soinfo {
   }
 
   bool is_linked() const;
+  bool is_image_linked() const;
   bool is_linker() const;
   bool is_main_executable() const;
 
@@ -326,6 +391,17 @@ struct soinfo {
   ElfW(Addr) get_verdef_ptr() const;
   size_t get_verdef_cnt() const;
 
+  // Interns the names of the versions this library defines and needs, so that version matching
+  // during symbol lookup compares integers instead of strings.
+  void init_version_ids();
+  bool has_version_ids() const { return has_version_ids_; }
+  // Returns the interned id of the version with index `index` in this library's versym table, or
+  // 0 if there is none.
+  uint32_t get_version_id(size_t index) const;
+  // Returns the index of the version defined by this library with the interned id `id`, or
+  // kVersymGlobal if it doesn't define that version.
+  ElfW(Versym) find_verdef_index(uint32_t id) const;
+
   int get_target_sdk_version() const;
 
   void set_dt_runpath(const char *);
@@ -369,8 +445,18 @@ struct soinfo {
   }
   bool should_pad_segments() const { return should_pad_segments_; }
 
+  // Lazy PLT binding (see linker_lazy_bind.cpp).
+  bool can_bind_lazily() const;
+  bool prepare_lazy_binding();
+  ElfW(Addr) bind_lazy_plt_slot(size_t reloc_index);
+
+  // Whether any of this library's relocations runs one of its own ifunc resolvers.
+  bool has_irelative_relocs() const;
+
+  // What relocating this library took, if relocation statistics were on (see linker_reloc_stats.h).
+  android_dl_reloc_stats* reloc_stats() { return &reloc_stats_; }
+
  private:
-  bool is_image_linked() const;
   void set_image_linked();
 
   const ElfW(Sym)* gnu_lookup(SymbolName& symbol_name, const version_info* vi) const;
@@ -455,6 +541,22 @@ struct soinfo {
 
   // Pad gaps between segments when memory mapping?
   bool should_pad_segments_ = false;
+
+  // The .got.plt (DT_PLTGOT) and whether the library asked to be bound eagerly, for lazy binding.
+  ElfW(Addr)* plt_got_ = nullptr;
+  bool has_bind_now_ = false;
+  LazyBindState* lazy_bind_state_ = nullptr;
+
+  // Interned version ids, indexed by versym index, and the (id, vd_ndx) pairs of the versions this
+  // library defines, sorted by id. Only valid if has_version_ids_.
+  bool has_version_ids_ = false;
+  std::vector<uint32_t> version_ids_;
+  std::vector<std::pair<uint32_t, ElfW(Versym)>> verdef_ids_;
+
+  android_dl_reloc_stats reloc_stats_ = {};
+
+  // Computed on first use by get_symbol_count().
+  size_t symbol_count_ = 0;
 };
 
 // This function is used by dlvsym() to calculate hash of sym_ver
@@ -30,6 +30,8 @@
 
 #include <vector>
 
+#include <bionic/pthread_internal.h>
+
 #include "async_safe/CHECK.h"
 #include "linker_globals.h"
 #include "linker_main.h"
@@ -155,6 +157,43 @@ void register_soinfo_tls(soinfo* si) {
   register_tls_module(si, static_offset);
 }
 
+void linker_set_eager_dynamic_tls(bool enabled) {
+  atomic_store(&__libc_shared_globals()->tls_modules.eager_dynamic_tls, enabled);
+}
+
+void linker_get_tls_stats(android_dl_tls_stats* stats) {
+  TlsModules& modules = __libc_shared_globals()->tls_modules;
+  BionicAllocator& allocator = __libc_shared_globals()->tls_allocator;
+
+  ScopedSignalBlocker ssb;
+  ScopedReadLock locker(&modules.rwlock);
+
+  *stats = {};
+  TlsDtv* dtv = __get_tcb_dtv(__get_bionic_tcb());
+  stats->dtv_slots = dtv->count;
+  stats->dtv_current = dtv->generation == atomic_load(&modules.generation);
+
+  for (size_t i = modules.static_module_count; i < modules.module_count; ++i) {
+    if (modules.module_table[i].first_generation == kTlsGenerationNone) continue;
+    ++stats->dynamic_modules;
+    // A block in a stale DTV may belong to an unloaded module whose slot has been reused.
+    if (i < dtv->count && dtv->modules[i] != nullptr &&
+        modules.module_table[i].first_generation <= dtv->generation) {
+      ++stats->allocated_modules;
+    }
+  }
+  for (size_t i = modules.static_module_count; i < dtv->count; ++i) {
+    if (i < modules.module_count && modules.module_table[i].static_offset != SIZE_MAX) continue;
+    if (dtv->modules[i] != nullptr) {
+      stats->dynamic_tls_bytes += allocator.get_chunk_size(dtv->modules[i]);
+    }
+  }
+  // The initial DTV, shared by every thread, is the one with no generation.
+  for (; dtv->generation != kTlsGenerationNone; dtv = dtv->next) {
+    stats->dtv_bytes += allocator.get_chunk_size(dtv);
+  }
+}
+
 void unregister_soinfo_tls(soinfo* si) {
   soinfo_tls* si_tls = si->get_tls();
   if (si_tls == nullptr || si_tls->module_id == kTlsUninitializedModuleId) {
@@ -30,6 +30,7 @@
 
 #include <stdlib.h>
 
+#include "private/bionic_dl_tls_stats.h"
 #include "private/bionic_elf_tls.h"
 
 struct TlsModule;
@@ -43,6 +44,12 @@ void unregister_soinfo_tls(soinfo* si);
 
 const TlsModule& get_tls_module(size_t module_id);
 
+// Turns on or off the allocation of all the loaded dynamic TLS blocks when a thread starts.
+void linker_set_eager_dynamic_tls(bool enabled);
+
+// Reports the calling thread's ELF TLS memory.
+void linker_get_tls_stats(android_dl_tls_stats* stats);
+
 typedef size_t TlsDescResolverFunc(size_t);
 
 struct TlsDescriptor {
@@ -31,8 +31,12 @@
 #include "linker_debug.h"
 #include "linker_globals.h"
 
+#include "android-base/file.h"
 #include "android-base/strings.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -247,3 +251,64 @@ bool is_first_stage_init() {
   static bool ret = (getpid() == 1 && access("/proc/self/exe", F_OK) == -1);
   return ret;
 }
+
+static bool is_trusted(const struct stat& st) {
+  return (st.st_uid == 0 || st.st_uid == geteuid()) && (st.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+}
+
+int open_trusted_file(const std::string& path, struct stat* file_stat) {
+  int fd = TEMP_FAILURE_RETRY(open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW));
+  if (fd == -1) {
+    return -1;
+  }
+
+  struct stat dir_stat;
+  if (TEMP_FAILURE_RETRY(fstat(fd, file_stat)) != 0 ||
+      stat(dirname(path.c_str()).c_str(), &dir_stat) != 0) {
+    int saved_errno = errno;
+    close(fd);
+    errno = saved_errno;
+    return -1;
+  }
+
+  if (!S_ISREG(file_stat->st_mode) || !is_trusted(*file_stat) || !is_trusted(dir_stat)) {
+    close(fd);
+    errno = EACCES;
+    return -1;
+  }
+  return fd;
+}
+
+bool write_trusted_file(const std::string& path, mode_t mode,
+                        bool (*write_contents)(int fd, const void* arg), const void* arg) {
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), ".%d.tmp", getpid());
+  std::string tmp_path = path + suffix;
+
+  int fd = TEMP_FAILURE_RETRY(open(tmp_path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, mode));
+  if (fd == -1) {
+    DEBUG("[ couldn't create %s: %m ]", tmp_path.c_str());
+    return false;
+  }
+
+  bool ok = write_contents(fd, arg);
+  close(fd);
+
+  if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+    DEBUG("[ couldn't write %s: %m ]", path.c_str());
+    unlink(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool write_trusted_file(const std::string& path, const void* data, size_t size) {
+  struct Contents {
+    const void* data;
+    size_t size;
+  } contents = {data, size};
+  return write_trusted_file(path, 0644, [](int fd, const void* arg) {
+    const Contents* contents = static_cast<const Contents*>(arg);
+    return android::base::WriteFully(fd, contents->data, contents->size);
+  }, &contents);
+}
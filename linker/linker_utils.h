@@ -28,6 +28,8 @@
 
 #pragma once
 
+#include <sys/stat.h>
+
 #include <string>
 #include <vector>
 
@@ -56,4 +58,18 @@ void split_path(const char* path, const char* delimiters, std::vector<std::strin
 std::string dirname(const char* path);
 
 bool safe_add(off64_t* out, off64_t a, size_t b);
+
+// Opens a file whose contents the linker acts on without further checks, such as one of its
+// caches, for reading. Fails with EACCES unless the file is a regular file, and both it and the
+// directory it's in are owned by root or by this process's effective uid and aren't writable by
+// anyone else. On success `file_stat` describes the file.
+int open_trusted_file(const std::string& path, struct stat* file_stat);
+
+// Writes a file for open_trusted_file() to read. The contents are written to a private temporary
+// file, which is then renamed into place, so that concurrent processes only ever see complete
+// files. `write_contents` is given a read-write fd for the temporary file, and returns false if
+// it couldn't write it.
+bool write_trusted_file(const std::string& path, mode_t mode,
+                        bool (*write_contents)(int fd, const void* arg), const void* arg);
+bool write_trusted_file(const std::string& path, const void* data, size_t size);
 bool is_first_stage_init();
@@ -26,12 +26,21 @@
  * SUCH DAMAGE.
  */
 
+#include <dirent.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <gtest/gtest.h>
 
+#include <memory>
+#include <string>
+
+#include <android-base/file.h>
+
 #include "linker_utils.h"
 #include "platform/bionic/page.h"
 
@@ -145,3 +154,110 @@ TEST(linker_utils, safe_add) {
   ASSERT_TRUE(safe_add(&val, 2000, 42U));
   ASSERT_EQ(2042, val);
 }
+
+static void ExpectTrusted(bool trusted, const std::string& path) {
+  struct stat file_stat;
+  errno = 0;
+  int fd = open_trusted_file(path, &file_stat);
+  if (trusted) {
+    ASSERT_NE(-1, fd) << path << ": " << strerror(errno);
+    close(fd);
+  } else {
+    ASSERT_EQ(-1, fd) << path;
+    ASSERT_NE(0, errno);
+  }
+}
+
+TEST(linker_utils, open_trusted_file) {
+  TemporaryDir tmp;
+  std::string path = std::string(tmp.path) + "/cache";
+  ASSERT_TRUE(android::base::WriteStringToFile("", path));
+  ASSERT_EQ(0, chmod(tmp.path, 0755));
+
+  ASSERT_EQ(0, chmod(path.c_str(), 0644));
+  ExpectTrusted(true, path);
+  ASSERT_EQ(0, chmod(path.c_str(), 0444));
+  ExpectTrusted(true, path);
+
+  ASSERT_EQ(0, chmod(path.c_str(), 0664));
+  ExpectTrusted(false, path);
+  ASSERT_EQ(0, chmod(path.c_str(), 0646));
+  ExpectTrusted(false, path);
+
+  ExpectTrusted(false, std::string(tmp.path) + "/missing");
+}
+
+TEST(linker_utils, open_trusted_file_writable_directory) {
+  TemporaryDir tmp;
+  std::string path = std::string(tmp.path) + "/cache";
+  ASSERT_TRUE(android::base::WriteStringToFile("", path));
+  ASSERT_EQ(0, chmod(path.c_str(), 0644));
+
+  ASSERT_EQ(0, chmod(tmp.path, 0777));
+  ExpectTrusted(false, path);
+  ASSERT_EQ(0, chmod(tmp.path, 0700));
+  ExpectTrusted(true, path);
+}
+
+TEST(linker_utils, open_trusted_file_symlink) {
+  TemporaryDir tmp;
+  std::string path = std::string(tmp.path) + "/cache";
+  ASSERT_TRUE(android::base::WriteStringToFile("", path));
+  ASSERT_EQ(0, chmod(path.c_str(), 0644));
+  std::string link_path = std::string(tmp.path) + "/link";
+  ASSERT_EQ(0, symlink(path.c_str(), link_path.c_str()));
+
+  ExpectTrusted(false, link_path);
+  ExpectTrusted(false, tmp.path);
+}
+
+TEST(linker_utils, open_trusted_file_other_owner) {
+  if (getuid() != 0) GTEST_SKIP() << "changing a file's owner requires root";
+
+  TemporaryDir tmp;
+  std::string path = std::string(tmp.path) + "/cache";
+  ASSERT_TRUE(android::base::WriteStringToFile("", path));
+  ASSERT_EQ(0, chmod(path.c_str(), 0644));
+  ExpectTrusted(true, path);
+
+  // Another uid's files aren't trusted, even though they can't be written by this process.
+  ASSERT_EQ(0, chown(path.c_str(), 1, 1));
+  ExpectTrusted(false, path);
+
+  // Nor is anything in another uid's directory.
+  ASSERT_EQ(0, chown(path.c_str(), 0, 0));
+  ASSERT_EQ(0, chown(tmp.path, 1, 1));
+  ExpectTrusted(false, path);
+}
+
+TEST(linker_utils, write_trusted_file) {
+  TemporaryDir tmp;
+  ASSERT_EQ(0, chmod(tmp.path, 0755));
+  std::string path = std::string(tmp.path) + "/cache";
+
+  ASSERT_TRUE(write_trusted_file(path, "hello", 5));
+  ExpectTrusted(true, path);
+  std::string content;
+  ASSERT_TRUE(android::base::ReadFileToString(path, &content));
+  ASSERT_EQ("hello", content);
+
+  // An existing file is replaced, even one that wasn't trusted.
+  ASSERT_EQ(0, chmod(path.c_str(), 0666));
+  ASSERT_TRUE(write_trusted_file(path, "world", 5));
+  ExpectTrusted(true, path);
+  ASSERT_TRUE(android::base::ReadFileToString(path, &content));
+  ASSERT_EQ("world", content);
+
+  // A failed write leaves neither the file nor the temporary file behind.
+  std::string other_path = std::string(tmp.path) + "/other";
+  ASSERT_FALSE(write_trusted_file(other_path, 0444, [](int, const void*) { return false; },
+                                  nullptr));
+  ASSERT_EQ(-1, access(other_path.c_str(), F_OK));
+  std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(tmp.path), closedir);
+  ASSERT_TRUE(dir != nullptr);
+  size_t entries = 0;
+  while (dirent* e = readdir(dir.get())) {
+    if (e->d_name[0] != '.') ++entries;
+  }
+  ASSERT_EQ(1U, entries);
+}
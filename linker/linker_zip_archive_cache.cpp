@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "linker_zip_archive_cache.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "linker_debug.h"
+
+// The most archives kept open at once, each holding a file descriptor.
+static constexpr size_t kMaxArchives = 16;
+
+// A central directory record is 46 bytes plus the name, and the archive's lookup table adds a few
+// more bytes per entry; typical APK entry names are a few dozen characters long.
+static constexpr size_t kEstimatedBytesPerEntry = 96;
+
+static ZipArchiveCache g_zip_archive_cache;
+
+ZipArchiveCache& ZipArchiveCache::get() {
+  return g_zip_archive_cache;
+}
+
+ZipArchiveCache::~ZipArchiveCache() {
+  for (const auto& entry : entries_) {
+    CloseArchive(entry.handle);
+  }
+}
+
+void ZipArchiveCache::close_entry(size_t index) {
+  TRACE("[ closing cached zip archive \"%s\" ]", entries_[index].path.c_str());
+  CloseArchive(entries_[index].handle);
+  total_cost_ -= entries_[index].cost;
+  entries_.erase(entries_.begin() + index);
+}
+
+void ZipArchiveCache::evict(size_t max_archives, size_t max_bytes) {
+  while (!entries_.empty() && (entries_.size() > max_archives || total_cost_ > max_bytes)) {
+    close_entry(entries_.size() - 1);
+    ++evictions_;
+  }
+}
+
+void ZipArchiveCache::release() {
+  evict(max_archives_, max_bytes_);
+}
+
+void ZipArchiveCache::set_limits(size_t max_archives, size_t max_bytes) {
+  max_archives_ = std::min(max_archives, kMaxArchives);
+  max_bytes_ = max_bytes;
+  evict(max_archives_, max_bytes_);
+}
+
+void ZipArchiveCache::get_stats(android_dl_zip_archive_cache_stats* stats) const {
+  *stats = {
+    .max_archives = max_archives_,
+    .max_bytes = max_bytes_,
+    .archives = entries_.size(),
+    .bytes = total_cost_,
+    .hits = hits_,
+    .misses = misses_,
+    .stale = stale_,
+    .evictions = evictions_,
+  };
+}
+
+bool ZipArchiveCache::get_or_open(const char* zip_path, int fd, ZipArchiveHandle* handle) {
+  struct stat sb;
+  if (fstat(fd, &sb) == -1) {
+    return false;
+  }
+
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    Entry& entry = entries_[i];
+    if (entry.path != zip_path) continue;
+
+    if (entry.dev == sb.st_dev && entry.ino == sb.st_ino && entry.size == sb.st_size &&
+        entry.mtime.tv_sec == sb.st_mtim.tv_sec && entry.mtime.tv_nsec == sb.st_mtim.tv_nsec) {
+      ++hits_;
+      std::rotate(entries_.begin(), entries_.begin() + i, entries_.begin() + i + 1);
+      *handle = entries_[0].handle;
+      return true;
+    }
+
+    // The file was replaced or modified since it was opened.
+    ++stale_;
+    close_entry(i);
+    break;
+  }
+
+  ++misses_;
+
+  int archive_fd = TEMP_FAILURE_RETRY(open(zip_path, O_RDONLY | O_CLOEXEC));
+  if (archive_fd == -1) {
+    return false;
+  }
+
+  // Identify the archive by the file that was actually opened, in case the path was replaced
+  // since `fd` was opened.
+  if (fstat(archive_fd, &sb) == -1) {
+    close(archive_fd);
+    return false;
+  }
+
+  if (OpenArchiveFd(archive_fd, "", handle) != 0) {
+    // invalid zip-file (?)
+    CloseArchive(*handle);
+    return false;
+  }
+
+  Entry entry = {
+    .path = zip_path,
+    .dev = sb.st_dev,
+    .ino = sb.st_ino,
+    .size = sb.st_size,
+    .mtime = sb.st_mtim,
+    .cost = GetArchiveInfo(*handle).entry_count * kEstimatedBytesPerEntry,
+    .handle = *handle,
+  };
+  total_cost_ += entry.cost;
+  entries_.insert(entries_.begin(), std::move(entry));
+  // The archive that was just opened is always kept.
+  evict(kMaxArchives, SIZE_MAX);
+  return true;
+}
+
+void ZipArchiveCache::print_stats() const {
+  PRINT("ZIP CACHE STATS: %zu hits, %zu misses (%zu stale), %zu evictions, %zu open (~%zu bytes)",
+        hits_, misses_, stale_, evictions_, entries_.size(), total_cost_);
+}
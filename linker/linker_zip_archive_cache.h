@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+
+#include <android-base/macros.h>
+
+#include "private/bionic_dl_zip_archive_cache.h"
+#include "ziparchive/zip_archive.h"
+
+// A process-wide cache of the zip archives (usually APKs) that libraries have been loaded from.
+//
+// Opening an archive maps and indexes its central directory, so keeping archives open lets the
+// dlopen() of the next library from the same APK skip that work. While a load is in progress, all
+// the archives it opens are kept (up to a fixed maximum). When it returns, purge_unused_memory()
+// closes the least recently used archives until the cache is within its limits.
+//
+// Keeping archives open between loads costs a file descriptor and memory for each one, so the
+// limits are zero, and every archive is closed after each load, unless the process opts in with
+// android_dl_set_zip_archive_cache_limits(). The memory limit applies to an estimate of what the
+// archives' central directories use.
+//
+// An archive is only reused while the file at its path is still the one that was opened (same
+// device, inode, size and mtime). Handles returned by get_or_open() must not be kept beyond the
+// next call into the cache. All of these functions must be called with the loader lock held
+// exclusively.
+class ZipArchiveCache {
+ public:
+  ZipArchiveCache() {}
+  ~ZipArchiveCache();
+
+  static ZipArchiveCache& get();
+
+  // `fd` is an open descriptor for `zip_path`, used to check that a cached archive is current.
+  bool get_or_open(const char* zip_path, int fd, ZipArchiveHandle* handle);
+
+  // Closes the archives over the limits (all of them, unless the process opted in).
+  void release();
+
+  void set_limits(size_t max_archives, size_t max_bytes);
+  void get_stats(android_dl_zip_archive_cache_stats* stats) const;
+  void print_stats() const;
+
+ private:
+  struct Entry {
+    std::string path;
+    dev_t dev;
+    ino_t ino;
+    off64_t size;
+    timespec mtime;
+    size_t cost;
+    ZipArchiveHandle handle;
+  };
+
+  void evict(size_t max_archives, size_t max_bytes);
+  void close_entry(size_t index);
+
+  DISALLOW_COPY_AND_ASSIGN(ZipArchiveCache);
+
+  // Ordered from most to least recently used.
+  std::vector<Entry> entries_;
+  size_t total_cost_ = 0;
+
+  size_t max_archives_ = 0;
+  size_t max_bytes_ = 0;
+
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+  size_t stale_ = 0;
+  size_t evictions_ = 0;
+};
@@ -33,6 +33,11 @@ extern "C" {
 void __cfi_slowpath(uint64_t CallSiteTypeId, void* Ptr);
 void __cfi_slowpath_diag(uint64_t CallSiteTypeId, void* Ptr, void* DiagData);
 size_t __cfi_shadow_size();
+#if defined(__BIONIC__)
+void __cfi_slowpath_cache_set_enabled(bool enabled);
+void __cfi_slowpath_stats_set_enabled(bool enabled);
+size_t __cfi_slowpath_get_stats(CFISlowpathStats* stats, size_t count);
+#endif
 }
 
 // Disables debuggerd stack traces to speed up death tests, make them less
@@ -146,6 +151,62 @@ TEST_F(cfi_test_DeathTest, basic) {
 #endif
 }
 
+// libcfi-test.so's constructor and destructor each check the same target, and expect their checks
+// to reach its __cfi_check, so the cache is only turned on once it's loaded, and turned off again
+// before it's finally unloaded.
+TEST(cfi_test, slowpath_cache) {
+#if defined(__BIONIC__)
+  void* handle = dlopen("libcfi-test.so", RTLD_NOW | RTLD_LOCAL);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+  auto get_count = reinterpret_cast<size_t (*)()>(dlsym(handle, "get_count"));
+  auto get_global_address = reinterpret_cast<void* (*)()>(dlsym(handle, "get_global_address"));
+  void* cfi_check = dlsym(handle, "__cfi_check");
+  ASSERT_TRUE(get_count != nullptr && get_global_address != nullptr && cfi_check != nullptr);
+
+  __cfi_slowpath_cache_set_enabled(true);
+  __cfi_slowpath_stats_set_enabled(true);
+
+  // Only the first check of a target goes to __cfi_check.
+  size_t c = get_count();
+  __cfi_slowpath(45, get_global_address());
+  EXPECT_EQ(++c, get_count());
+  __cfi_slowpath(45, get_global_address());
+  EXPECT_EQ(c, get_count());
+  // A different call site type is a different entry...
+  __cfi_slowpath(46, get_global_address());
+  EXPECT_EQ(++c, get_count());
+  // ...and checks with DiagData are never cached.
+  __cfi_slowpath_diag(45, get_global_address(), reinterpret_cast<void*>(5678));
+  EXPECT_EQ(++c, get_count());
+
+  CFISlowpathStats stats[64];
+  size_t modules = __cfi_slowpath_get_stats(stats, 64);
+  ASSERT_LE(modules, 64U);
+  CFISlowpathStats* module = nullptr;
+  for (size_t i = 0; i < modules; ++i) {
+    if (stats[i].cfi_check == reinterpret_cast<uintptr_t>(cfi_check)) module = &stats[i];
+  }
+  ASSERT_TRUE(module != nullptr);
+  EXPECT_LE(4U, module->calls);
+  EXPECT_LE(1U, module->cache_hits);
+
+  // Unloading invalidates the cache. The reloaded library's constructor repeats the check its
+  // destructor just made, and would abort if it were answered from a stale entry.
+  dlclose(handle);
+  handle = dlopen("libcfi-test.so", RTLD_NOW | RTLD_LOCAL);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+  get_count = reinterpret_cast<size_t (*)()>(dlsym(handle, "get_count"));
+  get_global_address = reinterpret_cast<void* (*)()>(dlsym(handle, "get_global_address"));
+  c = get_count();
+  __cfi_slowpath(45, get_global_address());
+  EXPECT_EQ(++c, get_count());
+
+  __cfi_slowpath_stats_set_enabled(false);
+  __cfi_slowpath_cache_set_enabled(false);
+  dlclose(handle);
+#endif
+}
+
 TEST(cfi_test, invalid) {
 #if defined(__BIONIC__)
   void* handle;
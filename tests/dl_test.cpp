@@ -31,6 +31,7 @@
 #include <iostream>
 #include <regex>
 #include <string>
+#include <vector>
 
 #include <android-base/file.h>
 #include <android-base/macros.h>
@@ -407,3 +408,67 @@ TEST(dl, relocations_fat) {
 #endif
   );
 }
+
+#if defined(__BIONIC__)
+// Runs parallel_relocation_helper with relocation spread across `threads` threads, and returns
+// what it printed.
+static void RunParallelRelocationHelper(const char* threads, const std::vector<const char*>& args,
+                                        std::string* output) {
+  std::string helper = GetTestLibRoot() + "/parallel_relocation_helper";
+  std::vector<const char*> argv = { helper.c_str() };
+  argv.insert(argv.end(), args.begin(), args.end());
+  argv.push_back(nullptr);
+
+  std::string lib_path = "LD_LIBRARY_PATH=" + GetTestLibRoot();
+  std::string thread_count = std::string("LD_RELOCATION_THREADS=") + threads;
+  ExecTestHelper eth;
+  eth.SetArgs(argv);
+  eth.SetEnv({ lib_path.c_str(), thread_count.c_str(), nullptr });
+  eth.Run([&]() { execve(helper.c_str(), eth.GetArgs(), eth.GetEnv()); }, 0, nullptr);
+  *output = eth.GetOutput();
+}
+#endif
+
+TEST(dl, parallel_relocation_matches_serial) {
+#if defined(__BIONIC__)
+  // The siblings test libraries check that every symbol is bound to the right definition.
+  const std::vector<const char*> args = { "libtest_check_order_reloc_siblings.so",
+                                          "check_order_reloc_get_answer" };
+  std::string serial;
+  ASSERT_NO_FATAL_FAILURE(RunParallelRelocationHelper("1", args, &serial));
+  ASSERT_EQ("check_order_reloc_get_answer() = 42\n", serial);
+
+  std::string parallel;
+  ASSERT_NO_FATAL_FAILURE(RunParallelRelocationHelper("8", args, &parallel));
+  ASSERT_EQ(serial, parallel);
+#else
+  GTEST_SKIP() << "test is not supported on glibc";
+#endif
+}
+
+TEST(dl, parallel_relocation_failure) {
+#if defined(__BIONIC__)
+  // Both _2 and _4 fail to relocate, but only the first failure (in load order) is reported, and
+  // the whole group is unloaded, including the libraries that were relocated successfully.
+  const std::vector<const char*> args = { "libtest_parallel_reloc_failure.so",
+                                          "parallel_reloc_get_value",
+                                          "libtest_parallel_reloc_failure.so",
+                                          "libtest_parallel_reloc_failure_1.so",
+                                          "libtest_parallel_reloc_failure_2.so",
+                                          "libtest_parallel_reloc_failure_3.so",
+                                          "libtest_parallel_reloc_failure_4.so" };
+  std::string serial;
+  ASSERT_NO_FATAL_FAILURE(RunParallelRelocationHelper("1", args, &serial));
+  ASSERT_NE(std::string::npos,
+            serial.find("cannot locate symbol \"parallel_reloc_missing_symbol\" referenced by \""))
+      << serial;
+  ASSERT_NE(std::string::npos, serial.find("/libtest_parallel_reloc_failure_2.so\"")) << serial;
+  ASSERT_EQ(std::string::npos, serial.find(" is loaded")) << serial;
+
+  std::string parallel;
+  ASSERT_NO_FATAL_FAILURE(RunParallelRelocationHelper("8", args, &parallel));
+  ASSERT_EQ(serial, parallel);
+#else
+  GTEST_SKIP() << "test is not supported on glibc";
+#endif
+}
@@ -19,6 +19,12 @@
 
 #include <android/dlext.h>
 
+#include "private/bionic_dl_load_timeline.h"
+#include "private/bionic_dl_reloc_stats.h"
+#include "private/bionic_dl_reservation_pool.h"
+#include "private/bionic_dl_tls_stats.h"
+#include "private/bionic_dl_zip_archive_cache.h"
+
 __BEGIN_DECLS
 
 /*
@@ -56,6 +62,23 @@ enum {
    */
   ANDROID_NAMESPACE_TYPE_SHARED = 2,
 
+  /* This flag instructs the linker to back the executable segments of libraries in the namespace
+   * with transparent huge pages after they are linked, using MADV_COLLAPSE. Only the parts of a
+   * segment that cover whole PMD-sized (2MiB with 4KiB pages) blocks can be promoted, which in
+   * practice requires linking with -z max-page-size=2097152. Libraries can also opt in themselves
+   * with an NT_ANDROID_TYPE_HUGEPAGE_TEXT note.
+   */
+  ANDROID_NAMESPACE_TYPE_HUGEPAGE_TEXT = 0x02000000,
+
+  /* This flag instructs the linker to bind PLT entries of libraries in the namespace lazily, on
+   * the first call, instead of at load time. Only libraries linked without BIND_NOW whose
+   * .got.plt is outside the RELRO segment are bound lazily, and only on arm64 and x86_64.
+   * Libraries opened with RTLD_NOW are always bound eagerly. Binding waits for any dlopen() or
+   * dlclose() in progress on other threads, so constructors of such libraries must not wait for
+   * threads that call into them.
+   */
+  ANDROID_NAMESPACE_TYPE_LAZY_BINDING = 0x04000000,
+
   /* This flag instructs linker to enable exempt-list workaround for the namespace.
    * See http://b/26394120 for details.
    */
@@ -100,6 +123,109 @@ extern bool android_link_namespaces_all_libs(android_namespace_t* from,
 
 extern void android_set_application_target_sdk_version(int target);
 
+struct android_dlopen_async_request;
+
+/*
+ * Queues android_dlopen_ext(filename, flags, extinfo) to run on the linker's worker thread, and
+ * returns without waiting for it. Queued loads run one at a time, in order, and constructors run
+ * in the usual order, on the worker thread. If notify_fd isn't -1, an 8-byte 1 is written to it
+ * (an eventfd, say) when the load completes, and before android_dlopen_async_wait() can return.
+ * Returns null, and sets dlerror(), if the load can't be queued. Every request must be passed to
+ * android_dlopen_async_wait() once. In a child process, loads that were outstanding when it
+ * forked fail.
+ */
+extern struct android_dlopen_async_request* android_dlopen_async(const char* filename, int flags,
+                                                                 const android_dlextinfo* extinfo,
+                                                                 int notify_fd);
+
+/*
+ * Returns true if the load has completed, successfully or not.
+ */
+extern bool android_dlopen_async_is_done(struct android_dlopen_async_request* request);
+
+/*
+ * Waits for the load to complete (running it on this thread if the worker hasn't started it yet),
+ * releases the request, and returns what dlopen() would have: the handle, or null with dlerror()
+ * set.
+ */
+extern void* android_dlopen_async_wait(struct android_dlopen_async_request* request);
+
+/*
+ * Looks up each of the `count` symbols named in `symbols` as dlsym(handle, ...) would, and stores
+ * its address in the corresponding element of `addresses`, or null if it can't be found. Returns
+ * the number of symbols found. If that's less than `count`, dlerror() describes the last failure.
+ * The loader lock is taken, and the handle's dependencies walked, once for the whole batch.
+ */
+extern size_t android_dlsym_batch(void* handle, const char* const* symbols, void** addresses,
+                                  size_t count);
+
+/*
+ * Turns recording of the linker's per-library load timeline on or off. Recording is also turned
+ * on at startup if LD_LOAD_TIMELINE is set.
+ */
+extern void android_dl_set_load_timeline_enabled(bool enabled);
+
+/*
+ * Calls cb on each recorded load phase, in the order the phases finished, until cb returns
+ * non-zero. Returns the last value cb returned, or 0.
+ */
+extern int android_dl_iterate_load_timeline(
+    int (*cb)(const android_dl_load_phase_info* info, void* data), void* data);
+
+/*
+ * Turns per-library relocation statistics on or off. Libraries relocated while they are on can be
+ * queried with android_dl_get_reloc_stats(). Recording is also turned on at startup if
+ * LD_RELOC_STATS is set.
+ */
+extern void android_dl_set_reloc_stats_enabled(bool enabled);
+
+/*
+ * Copies the relocation statistics of the library `handle` (a dlopen() handle) into `stats`, which
+ * are all zero if statistics were off when it was relocated. Returns false, and sets dlerror(), if
+ * `handle` is invalid.
+ */
+extern bool android_dl_get_reloc_stats(void* handle, android_dl_reloc_stats* stats);
+
+/*
+ * Sets the limits of the pool that keeps the address space reservations of unloaded libraries
+ * for reuse by later loads of the same size: at most `max_regions` (itself at most 64)
+ * reservations, of at most `max_bytes` in total. Reservations over the new limits are unmapped.
+ * A `max_regions` of 0, the default unless LD_RESERVATION_POOL is set, turns the pool off.
+ * A reused reservation keeps its address, so pooling trades away some ASLR.
+ */
+extern void android_dl_set_reservation_pool_limits(size_t max_regions, size_t max_bytes);
+
+/*
+ * Copies the state of the reservation pool into `stats`.
+ */
+extern void android_dl_get_reservation_pool_stats(android_dl_reservation_pool_stats* stats);
+
+/*
+ * Turns on or off eager dynamic TLS allocation. While it is on, each new thread allocates its
+ * copies of the TLS blocks of all the loaded dlopen()ed libraries before running its start routine,
+ * so that its first access to them doesn't have to. It is also turned on at startup if
+ * LD_EAGER_DYNAMIC_TLS is set.
+ */
+extern void android_dl_set_eager_dynamic_tls(bool enabled);
+
+/*
+ * Copies the calling thread's ELF TLS memory usage into `stats`.
+ */
+extern void android_dl_get_tls_stats(android_dl_tls_stats* stats);
+
+/*
+ * Sets the limits of the cache of zip archives (usually APKs) that libraries were loaded from:
+ * after each load, at most `max_archives` (itself at most 16) archives stay open, using an
+ * estimated `max_bytes` in total. Archives over the new limits are closed. A `max_archives` of 0,
+ * the default, closes every archive when the load that opened it returns.
+ */
+extern void android_dl_set_zip_archive_cache_limits(size_t max_archives, size_t max_bytes);
+
+/*
+ * Copies the state of the zip archive cache into `stats`.
+ */
+extern void android_dl_get_zip_archive_cache_stats(android_dl_zip_archive_cache_stats* stats);
+
 __END_DECLS
 
 #endif /* __ANDROID_DLEXT_NAMESPACES_H__ */
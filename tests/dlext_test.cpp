@@ -16,21 +16,31 @@
 
 #include <gtest/gtest.h>
 
+#include <dirent.h>
 #include <dlfcn.h>
 #include <elf.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <signal.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 
+#include <set>
+#include <thread>
+#include <vector>
+
 #include <android/dlext.h>
 #include <android-base/file.h>
+#include <android-base/silent_death_test.h>
 #include <android-base/strings.h>
 #include <android-base/test_utils.h>
+#include <android-base/unique_fd.h>
 
+#include <sys/eventfd.h>
 #include <sys/mman.h>
+#include <sys/personality.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/vfs.h>
@@ -2096,6 +2106,164 @@ TEST(dlext, ns_hidden_child) {
           "internal_function is null\n");
 }
 
+static void CreateLazyBindingNamespace(android_namespace_t** ns) {
+  ASSERT_TRUE(android_init_anonymous_namespace(g_core_shared_libs.c_str(), nullptr));
+
+  *ns = android_create_namespace("lazy",
+                                 nullptr,
+                                 GetTestLibRoot().c_str(),
+                                 ANDROID_NAMESPACE_TYPE_ISOLATED |
+                                     ANDROID_NAMESPACE_TYPE_LAZY_BINDING,
+                                 nullptr,
+                                 nullptr);
+  ASSERT_TRUE(*ns != nullptr) << dlerror();
+  ASSERT_TRUE(android_link_namespaces(*ns, nullptr, g_core_shared_libs.c_str())) << dlerror();
+}
+
+TEST(dlext, ns_lazy_binding) {
+  android_namespace_t* ns;
+  ASSERT_NO_FATAL_FAILURE(CreateLazyBindingNamespace(&ns));
+
+  android_dlextinfo extinfo;
+  extinfo.flags = ANDROID_DLEXT_USE_NAMESPACE;
+  extinfo.library_namespace = ns;
+
+  // RTLD_LAZY is required: RTLD_NOW keeps the eager binding behavior.
+  void* handle = android_dlopen_ext("libtest_lazy_binding.so", RTLD_LAZY, &extinfo);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+
+  // The constructor called through an unbound slot while dlopen() held the loader lock.
+  typedef int (*fn_t)();
+  fn_t get_ctor_value = reinterpret_cast<fn_t>(dlsym(handle, "lazy_binding_get_ctor_value"));
+  ASSERT_TRUE(get_ctor_value != nullptr) << dlerror();
+  ASSERT_EQ(42, get_ctor_value());
+
+  fn_t fn = reinterpret_cast<fn_t>(dlsym(handle, "lazy_binding_get_value"));
+  ASSERT_TRUE(fn != nullptr) << dlerror();
+
+  // Race the first call through the PLT from several threads; every caller
+  // must observe the resolved target and errno must be left alone.
+  std::vector<std::thread> threads;
+  std::vector<int> results(8);
+  for (size_t i = 0; i < results.size(); ++i) {
+    threads.emplace_back([&results, fn, i] {
+      errno = EAGAIN;
+      results[i] = fn();
+      if (errno != EAGAIN) results[i] = -1;
+    });
+  }
+  for (auto& t : threads) t.join();
+
+  for (int result : results) {
+    ASSERT_EQ(1729, result);
+  }
+  ASSERT_EQ(1729, fn());
+
+  dlclose(handle);
+}
+
+using dlext_DeathTest = SilentDeathTest;
+
+TEST_F(dlext_DeathTest, ns_lazy_binding_defers_lookup) {
+#if defined(__aarch64__) || defined(__x86_64__)
+  android_namespace_t* ns;
+  ASSERT_NO_FATAL_FAILURE(CreateLazyBindingNamespace(&ns));
+
+  android_dlextinfo extinfo;
+  extinfo.flags = ANDROID_DLEXT_USE_NAMESPACE;
+  extinfo.library_namespace = ns;
+
+  // The library calls a function that nothing defines. Binding it eagerly fails at load time...
+  void* handle = android_dlopen_ext("libtest_lazy_binding_missing.so", RTLD_NOW, &extinfo);
+  ASSERT_TRUE(handle == nullptr);
+  ASSERT_SUBSTR("cannot locate symbol \"lazy_binding_missing_function\"", dlerror());
+
+  // ...but binding it lazily only fails once the function is actually called.
+  handle = android_dlopen_ext("libtest_lazy_binding_missing.so", RTLD_LAZY, &extinfo);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+
+  typedef int (*fn_t)();
+  fn_t fn = reinterpret_cast<fn_t>(dlsym(handle, "lazy_binding_call_missing"));
+  ASSERT_TRUE(fn != nullptr) << dlerror();
+  ASSERT_EXIT(fn(), testing::KilledBySignal(SIGABRT),
+              "cannot locate symbol \"lazy_binding_missing_function\"");
+
+  dlclose(handle);
+#else
+  GTEST_SKIP() << "lazy binding is only supported on arm64 and x86_64";
+#endif
+}
+
+TEST(dlext, ns_lazy_binding_lookup_list) {
+  android_namespace_t* ns;
+  ASSERT_NO_FATAL_FAILURE(CreateLazyBindingNamespace(&ns));
+
+  android_dlextinfo extinfo;
+  extinfo.flags = ANDROID_DLEXT_USE_NAMESPACE;
+  extinfo.library_namespace = ns;
+
+  void* handle = android_dlopen_ext("libtest_lazy_lookup_list.so", RTLD_LAZY, &extinfo);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+
+  typedef int (*fn_t)();
+  fn_t call_first = reinterpret_cast<fn_t>(dlsym(handle, "lazy_lookup_list_call_first"));
+  ASSERT_TRUE(call_first != nullptr) << dlerror();
+  fn_t call_second = reinterpret_cast<fn_t>(dlsym(handle, "lazy_lookup_list_call_second"));
+  ASSERT_TRUE(call_second != nullptr) << dlerror();
+
+  // Bind the first slot, which builds (and caches) the library's lookup list.
+  ASSERT_EQ(1, call_first());
+
+  // Loading a DF_1_GLOBAL library into the namespace puts it ahead of the
+  // library's own group, so the cached list must be rebuilt for the second slot.
+  void* global_handle =
+      android_dlopen_ext("libtest_lazy_lookup_list_global.so", RTLD_NOW, &extinfo);
+  ASSERT_TRUE(global_handle != nullptr) << dlerror();
+
+#if defined(__aarch64__) || defined(__x86_64__)
+  ASSERT_EQ(2, call_second());
+#else
+  // Without lazy binding, the slot was bound before the global library existed.
+  ASSERT_EQ(1, call_second());
+#endif
+  // Slots that were already bound stay bound.
+  ASSERT_EQ(1, call_first());
+
+  dlclose(global_handle);
+  dlclose(handle);
+}
+
+TEST(dlext, ns_hugepage_text) {
+  ASSERT_TRUE(android_init_anonymous_namespace(g_core_shared_libs.c_str(), nullptr));
+
+  android_namespace_t* ns =
+          android_create_namespace("hugepage_text",
+                                   nullptr,
+                                   GetTestLibRoot().c_str(),
+                                   ANDROID_NAMESPACE_TYPE_ISOLATED |
+                                       ANDROID_NAMESPACE_TYPE_HUGEPAGE_TEXT,
+                                   nullptr,
+                                   nullptr);
+  ASSERT_TRUE(ns != nullptr) << dlerror();
+  ASSERT_TRUE(android_link_namespaces(ns, nullptr, g_core_shared_libs.c_str())) << dlerror();
+
+  android_dlextinfo extinfo;
+  extinfo.flags = ANDROID_DLEXT_USE_NAMESPACE;
+  extinfo.library_namespace = ns;
+
+  // Promotion is best effort (the test library's text is far smaller than a PMD), so all
+  // this can check is that the library still loads and runs.
+  void* handle = android_dlopen_ext("libtest_simple.so", RTLD_NOW, &extinfo);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+
+  typedef bool (*fn_t)();
+  fn_t fn = reinterpret_cast<fn_t>(dlsym(handle, "dlopen_testlib_simple_func"));
+  ASSERT_TRUE(fn != nullptr) << dlerror();
+  ASSERT_TRUE(fn());
+
+  dlclose(handle);
+}
+
 TEST(dlext, dlopen_handle_value_platform) {
   void* handle = dlopen("libtest_dlsym_from_this.so", RTLD_NOW | RTLD_LOCAL);
   ASSERT_TRUE((reinterpret_cast<uintptr_t>(handle) & 1) != 0)
@@ -2110,3 +2278,531 @@ TEST(dlext, dlopen_handle_value_app_compat) {
           << "dlopen should return valid pointer";
   dlclose(handle);
 }
+
+TEST(dlext, load_timeline) {
+  android_dl_set_load_timeline_enabled(true);
+  void* handle = dlopen("libtest_simple.so", RTLD_NOW);
+  android_dl_set_load_timeline_enabled(false);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+
+  std::vector<bool> seen(ANDROID_DL_LOAD_PHASE_COUNT);
+  android_dl_iterate_load_timeline([](const android_dl_load_phase_info* info, void* data) {
+    if (android::base::EndsWith(info->library, "/libtest_simple.so")) {
+      EXPECT_GE(info->phase, 0);
+      EXPECT_LT(info->phase, ANDROID_DL_LOAD_PHASE_COUNT);
+      EXPECT_NE(0U, info->start_ns);
+      EXPECT_NE(0, info->tid);
+      (*static_cast<std::vector<bool>*>(data))[info->phase] = true;
+    }
+    return 0;
+  }, &seen);
+  dlclose(handle);
+
+  for (int phase = 0; phase < ANDROID_DL_LOAD_PHASE_COUNT; ++phase) {
+    EXPECT_TRUE(seen[phase]) << "phase " << phase;
+  }
+}
+
+TEST(dlext, reloc_stats) {
+  android_dl_set_reloc_stats_enabled(true);
+  void* handle = dlopen(kLibName, RTLD_NOW);
+  android_dl_set_reloc_stats_enabled(false);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+
+  android_dl_reloc_stats stats;
+  ASSERT_TRUE(android_dl_get_reloc_stats(handle, &stats)) << dlerror();
+  // libdlext_test.so calls into libtest_simple.so, so it needs at least one symbol lookup.
+  EXPECT_NE(0U, stats.symbol_lookups);
+  EXPECT_LE(stats.symbol_lookups_cached, stats.symbol_lookups);
+  EXPECT_NE(0U, stats.absolute + stats.relative + stats.relr);
+  EXPECT_NE(0U, stats.dirty_pages);
+  dlclose(handle);
+}
+
+TEST(dlext, reloc_stats_invalid_handle) {
+  android_dl_reloc_stats stats;
+  ASSERT_FALSE(android_dl_get_reloc_stats(reinterpret_cast<void*>(1), &stats));
+  ASSERT_SUBSTR("invalid handle", dlerror());
+}
+
+static void RunBindingCacheHelper(ExecTestHelper& eth, size_t* lookups, size_t* from_cache) {
+  eth.Run([&]() { execve(eth.GetArg0(), eth.GetArgs(), eth.GetEnv()); }, 0, nullptr);
+  ASSERT_EQ(2, sscanf(eth.GetOutput().c_str(), "%zu %zu", lookups, from_cache)) << eth.GetOutput();
+}
+
+TEST(dlext, binding_cache) {
+  TemporaryDir cache_dir;
+  std::string helper = GetTestLibRoot() + "/binding_cache_helper";
+  std::string lib = GetTestLibRoot() + "/" + kLibName;
+  std::string env = std::string("LD_BINDING_CACHE_DIR=") + cache_dir.path;
+  ExecTestHelper eth;
+  eth.SetArgs({ helper.c_str(), lib.c_str(), nullptr });
+  eth.SetEnv({ env.c_str(), nullptr });
+
+  // The first process searches for every symbol and records the bindings...
+  size_t lookups = 0;
+  size_t from_cache = 0;
+  RunBindingCacheHelper(eth, &lookups, &from_cache);
+  ASSERT_NE(0U, lookups);
+  ASSERT_EQ(0U, from_cache);
+
+  // ...and the second finds them in the cache instead.
+  RunBindingCacheHelper(eth, &lookups, &from_cache);
+  ASSERT_NE(0U, from_cache);
+  ASSERT_LE(from_cache, lookups);
+}
+
+TEST(dlext, binding_cache_ignores_untrusted_files) {
+  TemporaryDir cache_dir;
+  std::string helper = GetTestLibRoot() + "/binding_cache_helper";
+  std::string lib = GetTestLibRoot() + "/" + kLibName;
+  std::string env = std::string("LD_BINDING_CACHE_DIR=") + cache_dir.path;
+  ExecTestHelper eth;
+  eth.SetArgs({ helper.c_str(), lib.c_str(), nullptr });
+  eth.SetEnv({ env.c_str(), nullptr });
+
+  size_t lookups = 0;
+  size_t from_cache = 0;
+  RunBindingCacheHelper(eth, &lookups, &from_cache);
+  ASSERT_EQ(0U, from_cache);
+
+  // A file that someone else could have written isn't used...
+  std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(cache_dir.path), closedir);
+  ASSERT_TRUE(dir != nullptr);
+  size_t cache_files = 0;
+  while (dirent* entry = readdir(dir.get())) {
+    if (!android::base::EndsWith(entry->d_name, ".bindings")) continue;
+    std::string path = std::string(cache_dir.path) + "/" + entry->d_name;
+    ASSERT_EQ(0, chmod(path.c_str(), 0666)) << path;
+    ++cache_files;
+  }
+  ASSERT_NE(0U, cache_files);
+  RunBindingCacheHelper(eth, &lookups, &from_cache);
+  ASSERT_EQ(0U, from_cache);
+
+  // ...but is replaced by one that is.
+  RunBindingCacheHelper(eth, &lookups, &from_cache);
+  ASSERT_NE(0U, from_cache);
+}
+
+TEST(dlext, binding_cache_written_with_lazy_binding) {
+  TemporaryDir cache_dir;
+  std::string helper = GetTestLibRoot() + "/binding_cache_helper";
+  std::string lib = GetTestLibRoot() + "/" + kLibName;
+  std::string env = std::string("LD_BINDING_CACHE_DIR=") + cache_dir.path;
+  ExecTestHelper eth;
+  eth.SetEnv({ env.c_str(), nullptr });
+
+  // A process that leaves the PLT to be bound lazily doesn't record the symbols it refers to...
+  size_t lookups = 0;
+  size_t from_cache = 0;
+  eth.SetArgs({ helper.c_str(), lib.c_str(), "lazy", nullptr });
+  RunBindingCacheHelper(eth, &lookups, &from_cache);
+  ASSERT_EQ(0U, from_cache);
+
+  // ...so a process that binds them up front looks those up itself, without warning about the
+  // file, and still uses it for everything else.
+  eth.SetArgs({ helper.c_str(), lib.c_str(), "now", nullptr });
+  RunBindingCacheHelper(eth, &lookups, &from_cache);
+  ASSERT_NE(0U, from_cache);
+  ASSERT_LT(from_cache, lookups);
+  ASSERT_EQ(std::to_string(lookups) + " " + std::to_string(from_cache) + "\n", eth.GetOutput());
+}
+
+static std::set<std::string> ListRelroCache(const char* dir_path) {
+  std::set<std::string> files;
+  std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(dir_path), closedir);
+  if (dir == nullptr) return files;
+  while (dirent* entry = readdir(dir.get())) {
+    if (android::base::EndsWith(entry->d_name, ".relro")) files.insert(entry->d_name);
+  }
+  return files;
+}
+
+TEST(dlext, relro_cache) {
+  TemporaryDir cache_dir;
+  std::string helper = GetTestLibRoot() + "/relro_cache_helper";
+  std::string lib = GetTestLibRoot() + "/" + kLibName;
+  std::string env = std::string("LD_RELRO_CACHE_DIR=") + cache_dir.path;
+  ExecTestHelper eth;
+  eth.SetArgs({ helper.c_str(), lib.c_str(), nullptr });
+  eth.SetEnv({ env.c_str(), nullptr });
+  // RELRO is only cached for libraries at addresses that don't change from one run to the next.
+  auto run_without_aslr = [&]() {
+    eth.Run([&]() {
+      personality(ADDR_NO_RANDOMIZE);
+      execve(eth.GetArg0(), eth.GetArgs(), eth.GetEnv());
+    }, 0, nullptr);
+  };
+
+  // The first process writes a file for each library...
+  run_without_aslr();
+  std::set<std::string> written = ListRelroCache(cache_dir.path);
+  ASSERT_FALSE(written.empty());
+
+  // ...and the second maps them rather than writing its own.
+  run_without_aslr();
+  std::vector<std::string> mapped = android::base::Split(eth.GetOutput(), "\n");
+  mapped.pop_back();
+  ASSERT_FALSE(mapped.empty()) << eth.GetOutput();
+  for (const std::string& path : mapped) {
+    EXPECT_EQ(1U, written.count(android::base::Basename(path))) << path;
+  }
+  EXPECT_EQ(written, ListRelroCache(cache_dir.path));
+}
+
+TEST(dlext, relro_cache_ignores_untrusted_files) {
+  TemporaryDir cache_dir;
+  std::string helper = GetTestLibRoot() + "/relro_cache_helper";
+  std::string lib = GetTestLibRoot() + "/" + kLibName;
+  std::string env = std::string("LD_RELRO_CACHE_DIR=") + cache_dir.path;
+  ExecTestHelper eth;
+  eth.SetArgs({ helper.c_str(), lib.c_str(), nullptr });
+  eth.SetEnv({ env.c_str(), nullptr });
+  auto run_without_aslr = [&]() {
+    eth.Run([&]() {
+      personality(ADDR_NO_RANDOMIZE);
+      execve(eth.GetArg0(), eth.GetArgs(), eth.GetEnv());
+    }, 0, nullptr);
+  };
+
+  run_without_aslr();
+  std::set<std::string> written = ListRelroCache(cache_dir.path);
+  ASSERT_FALSE(written.empty());
+
+  // Files that someone else could rewrite after they've been mapped aren't used...
+  for (const std::string& name : written) {
+    std::string path = std::string(cache_dir.path) + "/" + name;
+    ASSERT_EQ(0, chmod(path.c_str(), 0666)) << path;
+  }
+  run_without_aslr();
+  EXPECT_EQ("", eth.GetOutput());
+
+  if (getuid() != 0) GTEST_SKIP() << "changing a file's owner requires root";
+
+  // ...and nor are files that belong to another uid.
+  for (const std::string& name : written) {
+    std::string path = std::string(cache_dir.path) + "/" + name;
+    ASSERT_EQ(0, chmod(path.c_str(), 0444)) << path;
+    ASSERT_EQ(0, chown(path.c_str(), 1, 1)) << path;
+  }
+  run_without_aslr();
+  EXPECT_EQ("", eth.GetOutput());
+  EXPECT_EQ(written, ListRelroCache(cache_dir.path));
+}
+
+TEST(dlext, dlsym_batch) {
+  void* handle = dlopen("libtest_with_dependency.so", RTLD_NOW);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+
+  // getRandomNumber is in a DT_NEEDED library.
+  const char* symbols[] = {"getRandomNumber", "this_symbol_does_not_exist", "getRandomNumber"};
+  void* addresses[3] = {};
+  ASSERT_EQ(2U, android_dlsym_batch(handle, symbols, addresses, 3));
+  ASSERT_SUBSTR("undefined symbol: this_symbol_does_not_exist", dlerror());
+  EXPECT_EQ(dlsym(handle, "getRandomNumber"), addresses[0]);
+  EXPECT_EQ(nullptr, addresses[1]);
+  EXPECT_EQ(addresses[0], addresses[2]);
+  dlclose(handle);
+}
+
+TEST(dlext, dlsym_batch_rtld_default) {
+  const char* symbols[] = {"dlsym", "strlen"};
+  void* addresses[2] = {};
+  ASSERT_EQ(2U, android_dlsym_batch(RTLD_DEFAULT, symbols, addresses, 2)) << dlerror();
+  EXPECT_EQ(dlsym(RTLD_DEFAULT, "dlsym"), addresses[0]);
+  EXPECT_EQ(dlsym(RTLD_DEFAULT, "strlen"), addresses[1]);
+}
+
+TEST(dlext, dlsym_batch_ifunc_resolver_calls_dlopen) {
+  void* handle = dlopen("libtest_ifunc_dlopen.so", RTLD_NOW);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+
+  const char* symbols[] = {"ifunc_dlopen", "return_simple_loaded"};
+  void* addresses[2] = {};
+  ASSERT_EQ(2U, android_dlsym_batch(handle, symbols, addresses, 2)) << dlerror();
+  // The resolver picks return_simple_loaded() if its own dlopen() worked.
+  EXPECT_EQ(addresses[1], addresses[0]);
+  dlclose(handle);
+}
+
+TEST(dlext, dlopen_async) {
+  android::base::unique_fd notify_fd(eventfd(0, EFD_CLOEXEC));
+  ASSERT_NE(-1, notify_fd.get()) << strerror(errno);
+
+  android_dlopen_async_request* request =
+      android_dlopen_async("libtest_simple.so", RTLD_NOW, nullptr, notify_fd.get());
+  ASSERT_TRUE(request != nullptr) << dlerror();
+  void* handle = android_dlopen_async_wait(request);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+
+  uint64_t count = 0;
+  ASSERT_EQ(static_cast<ssize_t>(sizeof(count)), read(notify_fd.get(), &count, sizeof(count)));
+  EXPECT_EQ(1U, count);
+
+  void* sym = dlsym(handle, "dlopen_testlib_simple_func");
+  ASSERT_TRUE(sym != nullptr) << dlerror();
+  dlclose(handle);
+}
+
+TEST(dlext, dlopen_async_failure) {
+  android_dlopen_async_request* request =
+      android_dlopen_async("libtest_dlopen_async_nonexistent.so", RTLD_NOW, nullptr, -1);
+  ASSERT_TRUE(request != nullptr) << dlerror();
+  ASSERT_TRUE(android_dlopen_async_wait(request) == nullptr);
+  ASSERT_SUBSTR("dlopen failed", dlerror());
+}
+
+static bool PollAsyncDlopen(android_dlopen_async_request* request) {
+  for (size_t i = 0; i < 10000; ++i) {
+    if (android_dlopen_async_is_done(request)) return true;
+    usleep(1000);
+  }
+  return false;
+}
+
+// Fills a pipe, then makes its write end blocking again, so that the next write to it blocks until
+// the read end is drained.
+static void FillPipe(int read_fd, int write_fd) {
+  ASSERT_EQ(0, fcntl(read_fd, F_SETFL, O_NONBLOCK)) << strerror(errno);
+  ASSERT_EQ(0, fcntl(write_fd, F_SETFL, O_NONBLOCK)) << strerror(errno);
+  char c = 0;
+  while (write(write_fd, &c, 1) == 1) {
+  }
+  ASSERT_EQ(EAGAIN, errno);
+  ASSERT_EQ(0, fcntl(write_fd, F_SETFL, 0)) << strerror(errno);
+}
+
+static void DrainPipe(int read_fd) {
+  char buf[4096];
+  while (read(read_fd, buf, sizeof(buf)) > 0) {
+  }
+}
+
+TEST(dlext, dlopen_async_is_done) {
+  android::base::unique_fd notify_fd(eventfd(0, EFD_CLOEXEC));
+  ASSERT_NE(-1, notify_fd.get()) << strerror(errno);
+
+  android_dlopen_async_request* request =
+      android_dlopen_async("libtest_simple.so", RTLD_NOW, nullptr, notify_fd.get());
+  ASSERT_TRUE(request != nullptr) << dlerror();
+  ASSERT_TRUE(PollAsyncDlopen(request));
+
+  // A completed load is notified before its request can be released.
+  uint64_t count = 0;
+  ASSERT_EQ(static_cast<ssize_t>(sizeof(count)), read(notify_fd.get(), &count, sizeof(count)));
+  EXPECT_EQ(1U, count);
+  void* handle = android_dlopen_async_wait(request);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+  dlclose(handle);
+}
+
+TEST(dlext, dlopen_async_fifo) {
+  const char* libs[] = {"libtest_simple.so", "libtest_empty.so", "libtest_dlopen_async_ctor_tid.so"};
+  android_dlopen_async_request* requests[3];
+  for (size_t i = 0; i < 3; ++i) {
+    requests[i] = android_dlopen_async(libs[i], RTLD_NOW, nullptr, -1);
+    ASSERT_TRUE(requests[i] != nullptr) << dlerror();
+  }
+
+  // Loads run one at a time, in the order they were queued, so once the last is done, so is the
+  // rest.
+  ASSERT_TRUE(PollAsyncDlopen(requests[2]));
+  EXPECT_TRUE(android_dlopen_async_is_done(requests[0]));
+  EXPECT_TRUE(android_dlopen_async_is_done(requests[1]));
+
+  for (size_t i = 0; i < 3; ++i) {
+    void* handle = android_dlopen_async_wait(requests[i]);
+    ASSERT_TRUE(handle != nullptr) << libs[i] << ": " << dlerror();
+    dlclose(handle);
+  }
+}
+
+TEST(dlext, dlopen_async_runs_queued_load_inline) {
+  int fds[2];
+  ASSERT_EQ(0, pipe2(fds, O_CLOEXEC)) << strerror(errno);
+  android::base::unique_fd read_fd(fds[0]);
+  android::base::unique_fd write_fd(fds[1]);
+  FillPipe(read_fd.get(), write_fd.get());
+
+  // The worker finishes the first load, then blocks notifying it...
+  android_dlopen_async_request* blocked =
+      android_dlopen_async("libtest_simple.so", RTLD_NOW, nullptr, write_fd.get());
+  ASSERT_TRUE(blocked != nullptr) << dlerror();
+  ASSERT_TRUE(PollAsyncDlopen(blocked));
+
+  // ...so it can't have started the second, which runs on the thread that waits for it.
+  android_dlopen_async_request* queued =
+      android_dlopen_async("libtest_dlopen_async_ctor_tid.so", RTLD_NOW, nullptr, -1);
+  ASSERT_TRUE(queued != nullptr) << dlerror();
+  void* handle = android_dlopen_async_wait(queued);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+  auto ctor_tid = reinterpret_cast<pid_t (*)()>(dlsym(handle, "dlopen_async_ctor_tid"));
+  ASSERT_TRUE(ctor_tid != nullptr) << dlerror();
+  EXPECT_EQ(gettid(), ctor_tid());
+  dlclose(handle);
+
+  DrainPipe(read_fd.get());
+  handle = android_dlopen_async_wait(blocked);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+  dlclose(handle);
+}
+
+TEST(dlext, dlopen_async_fork) {
+  int fds[2];
+  ASSERT_EQ(0, pipe2(fds, O_CLOEXEC)) << strerror(errno);
+  android::base::unique_fd read_fd(fds[0]);
+  android::base::unique_fd write_fd(fds[1]);
+  FillPipe(read_fd.get(), write_fd.get());
+
+  android_dlopen_async_request* request =
+      android_dlopen_async("libtest_simple.so", RTLD_NOW, nullptr, write_fd.get());
+  ASSERT_TRUE(request != nullptr) << dlerror();
+  ASSERT_TRUE(PollAsyncDlopen(request));
+
+  // The worker isn't copied into the child, which fails the request it inherited and starts a new
+  // worker for its own.
+  pid_t pid = fork();
+  ASSERT_NE(-1, pid) << strerror(errno);
+  if (pid == 0) {
+    if (android_dlopen_async_wait(request) != nullptr) _exit(1);
+    const char* error = dlerror();
+    if (error == nullptr || strstr(error, "forked") == nullptr) _exit(2);
+    android_dlopen_async_request* child_request =
+        android_dlopen_async("libtest_empty.so", RTLD_NOW, nullptr, -1);
+    if (child_request == nullptr || !PollAsyncDlopen(child_request)) _exit(3);
+    _exit(android_dlopen_async_wait(child_request) != nullptr ? 0 : 4);
+  }
+  AssertChildExited(pid, 0);
+
+  DrainPipe(read_fd.get());
+  void* handle = android_dlopen_async_wait(request);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+  dlclose(handle);
+}
+
+TEST(dlext, reservation_pool) {
+  android_dl_set_reservation_pool_limits(4, SIZE_MAX);
+  android_dl_reservation_pool_stats before;
+  android_dl_get_reservation_pool_stats(&before);
+  ASSERT_EQ(4U, before.max_regions);
+
+  void* handle = dlopen("libtest_simple.so", RTLD_NOW);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+  void* sym = dlsym(handle, "dlopen_testlib_simple_func");
+  ASSERT_TRUE(sym != nullptr) << dlerror();
+  ASSERT_EQ(0, dlclose(handle));
+
+  // The unloaded library's reservation is kept...
+  android_dl_reservation_pool_stats stats;
+  android_dl_get_reservation_pool_stats(&stats);
+  ASSERT_EQ(before.regions + 1, stats.regions);
+  ASSERT_NE(0U, stats.bytes);
+
+  // ...and reused, at the same address, when it's loaded again.
+  handle = dlopen("libtest_simple.so", RTLD_NOW);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+  android_dl_get_reservation_pool_stats(&stats);
+  EXPECT_EQ(before.hits + 1, stats.hits);
+  EXPECT_EQ(before.regions, stats.regions);
+  EXPECT_EQ(sym, dlsym(handle, "dlopen_testlib_simple_func"));
+  ASSERT_EQ(0, dlclose(handle));
+
+  // Turning the pool off unmaps everything in it.
+  android_dl_set_reservation_pool_limits(0, 0);
+  android_dl_get_reservation_pool_stats(&stats);
+  EXPECT_EQ(0U, stats.regions);
+  EXPECT_EQ(0U, stats.bytes);
+  EXPECT_LT(before.evictions, stats.evictions);
+}
+
+TEST(dlext, zip_archive_cache) {
+  const std::string zip_path =
+      GetTestLibRoot() + "/libdlext_test_zip/libdlext_test_zip_zipaligned.zip";
+  const std::string lib_path = zip_path + "!/libdir/libatest_simple_zip.so";
+  const std::string other_lib_path =
+      GetTestLibRoot() + "/libdlext_test_runpath_zip/libdlext_test_runpath_zip_zipaligned.zip" +
+      "!/libdir/libtest_dt_runpath_d_zip.so";
+
+  // By default, the archive is closed when the dlopen() that opened it returns...
+  android_dl_zip_archive_cache_stats before;
+  android_dl_get_zip_archive_cache_stats(&before);
+  ASSERT_EQ(0U, before.max_archives);
+  void* handle = dlopen(lib_path.c_str(), RTLD_NOW);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+  ASSERT_EQ(0, dlclose(handle));
+  android_dl_zip_archive_cache_stats stats;
+  android_dl_get_zip_archive_cache_stats(&stats);
+  EXPECT_LT(before.misses, stats.misses);
+  EXPECT_EQ(0U, stats.archives);
+  EXPECT_EQ(0U, stats.bytes);
+
+  // ...but the process can opt in to keeping it open for the next load from the same archive.
+  android_dl_set_zip_archive_cache_limits(1, SIZE_MAX);
+  handle = dlopen(lib_path.c_str(), RTLD_NOW);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+  ASSERT_EQ(0, dlclose(handle));
+  android_dl_get_zip_archive_cache_stats(&before);
+  EXPECT_EQ(1U, before.archives);
+  EXPECT_NE(0U, before.bytes);
+
+  handle = dlopen(lib_path.c_str(), RTLD_NOW);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+  ASSERT_EQ(0, dlclose(handle));
+  android_dl_get_zip_archive_cache_stats(&stats);
+  EXPECT_LT(before.hits, stats.hits);
+  EXPECT_EQ(before.misses, stats.misses);
+  EXPECT_EQ(1U, stats.archives);
+
+  // Loading from another archive evicts the least recently used one.
+  before = stats;
+  handle = dlopen(other_lib_path.c_str(), RTLD_NOW);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+  ASSERT_EQ(0, dlclose(handle));
+  android_dl_get_zip_archive_cache_stats(&stats);
+  EXPECT_LT(before.misses, stats.misses);
+  EXPECT_LT(before.evictions, stats.evictions);
+  EXPECT_EQ(1U, stats.archives);
+
+  // Turning the cache off closes everything in it.
+  android_dl_set_zip_archive_cache_limits(0, 0);
+  android_dl_get_zip_archive_cache_stats(&stats);
+  EXPECT_EQ(0U, stats.archives);
+  EXPECT_EQ(0U, stats.bytes);
+}
+
+TEST(dlext, eager_dynamic_tls) {
+  void* lib = dlopen("libtest_elftls_dynamic.so", RTLD_LOCAL | RTLD_NOW);
+  ASSERT_TRUE(lib != nullptr) << dlerror();
+  auto bump_local_vars = reinterpret_cast<int (*)()>(dlsym(lib, "bump_local_vars"));
+  ASSERT_TRUE(bump_local_vars != nullptr) << dlerror();
+
+  // A new thread has every dynamic TLS block before it touches any of them...
+  android_dl_set_eager_dynamic_tls(true);
+  android_dl_tls_stats stats;
+  int result = 0;
+  std::thread([&] {
+    android_dl_get_tls_stats(&stats);
+    result = bump_local_vars();
+  }).join();
+  android_dl_set_eager_dynamic_tls(false);
+
+  EXPECT_TRUE(stats.dtv_current);
+  EXPECT_NE(0U, stats.dynamic_modules);
+  EXPECT_EQ(stats.dynamic_modules, stats.allocated_modules);
+  // libtest_elftls_dynamic.so has a 4MiB TLS variable.
+  EXPECT_LE(4U * 1024 * 1024, stats.dynamic_tls_bytes);
+  EXPECT_LE(stats.dynamic_modules, stats.dtv_slots);
+  EXPECT_NE(0U, stats.dtv_bytes);
+  // ...initialized as usual.
+  EXPECT_EQ(42, result);
+
+  // Otherwise it starts with none.
+  std::thread([&] { android_dl_get_tls_stats(&stats); }).join();
+  EXPECT_FALSE(stats.dtv_current);
+  EXPECT_EQ(0U, stats.allocated_modules);
+  EXPECT_EQ(0U, stats.dynamic_tls_bytes);
+  EXPECT_EQ(0U, stats.dtv_bytes);
+
+  dlclose(lib);
+}
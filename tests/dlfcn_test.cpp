@@ -20,6 +20,8 @@
 #include <elf.h>
 #include <limits.h>
 #include <link.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
@@ -28,9 +30,14 @@
 #include <sys/auxv.h>
 #endif
 #include <sys/user.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <string>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include <android-base/file.h>
 #include <android-base/macros.h>
@@ -40,6 +47,7 @@
 #include "gtest_utils.h"
 #include "dlfcn_symlink_support.h"
 #include "utils.h"
+#include "SignalUtils.h"
 
 #define ASSERT_SUBSTR(needle, haystack) \
     ASSERT_PRED_FORMAT2(::testing::IsSubstring, needle, haystack)
@@ -325,6 +333,30 @@ TEST(dlfcn, ifunc) {
   dlclose(handle);
 }
 
+// dlsym() runs IFUNC resolvers, which may load and unload libraries themselves.
+TEST(dlfcn, ifunc_resolver_calls_dlopen) {
+  typedef int (*fn_ptr)();
+
+  void* handle = dlopen("libtest_ifunc_dlopen.so", RTLD_NOW);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+
+  fn_ptr fn = reinterpret_cast<fn_ptr>(dlsym(handle, "ifunc_dlopen"));
+  ASSERT_TRUE(fn != nullptr) << dlerror();
+  ASSERT_EQ(1, fn());
+
+  // The library that the resolver loaded has been unloaded again.
+  ASSERT_TRUE(dlopen("libtest_simple.so", RTLD_NOW | RTLD_NOLOAD) == nullptr);
+
+  // The same again, from another thread than the one that loaded the library.
+  std::thread([handle, &fn] {
+    fn = reinterpret_cast<fn_ptr>(dlsym(handle, "ifunc_dlopen"));
+  }).join();
+  ASSERT_TRUE(fn != nullptr) << dlerror();
+  ASSERT_EQ(1, fn());
+
+  dlclose(handle);
+}
+
 TEST(dlfcn, ifunc_ctor_call) {
   typedef const char* (*fn_ptr)();
 
@@ -909,6 +941,100 @@ TEST(dlfcn, dlsym_failures) {
   ASSERT_EQ(0, dlclose(self));
 }
 
+// dlsym() and dladdr() share the loader lock, so they run concurrently with each other. Check
+// that each thread still gets its own error, and that lookups keep working while another thread
+// loads and unloads a library.
+TEST(dlfcn, dlsym_concurrent_with_dlopen) {
+  void* self = dlopen(nullptr, RTLD_NOW);
+  ASSERT_TRUE(self != nullptr) << dlerror();
+
+  std::atomic<bool> done(false);
+  std::thread loader([&done] {
+    while (!done) {
+      void* handle = dlopen("libtest_simple.so", RTLD_NOW);
+      if (handle != nullptr) dlclose(handle);
+    }
+  });
+
+  std::vector<std::thread> threads;
+  std::vector<std::string> failures(4);
+  for (size_t i = 0; i < failures.size(); ++i) {
+    threads.emplace_back([self, i, &failures] {
+      std::string missing = "ThisSymbolDoesNotExist" + std::to_string(i);
+      for (size_t j = 0; j < 1000 && failures[i].empty(); ++j) {
+        if (dlsym(self, "DlSymTestFunction") == nullptr) {
+          failures[i] = "DlSymTestFunction not found";
+        }
+        Dl_info info;
+        if (dladdr(reinterpret_cast<void*>(&DlSymTestFunction), &info) == 0) {
+          failures[i] = "dladdr failed";
+        }
+        if (dlsym(self, missing.c_str()) != nullptr) {
+          failures[i] = missing + " found";
+        }
+        const char* error = dlerror();
+        if (error == nullptr || strstr(error, missing.c_str()) == nullptr) {
+          failures[i] = std::string("unexpected dlerror: ") + (error ? error : "(null)");
+        }
+      }
+    });
+  }
+  for (auto& t : threads) t.join();
+  done = true;
+  loader.join();
+
+  for (const auto& failure : failures) {
+    ASSERT_EQ("", failure);
+  }
+  ASSERT_EQ(0, dlclose(self));
+}
+
+static std::atomic<size_t> g_dlsym_from_signal_handler_count;
+
+static void dlsym_from_signal_handler(int) {
+  if (dlsym(RTLD_DEFAULT, "strlen") != nullptr) ++g_dlsym_from_signal_handler_count;
+}
+
+// A signal handler may interrupt dlsym() and call it again while the interrupted call holds the
+// loader lock shared, even with a dlopen() queued for the lock. Neither call should deadlock, and
+// the nested call mustn't disturb the interrupted one's error.
+TEST(dlfcn, dlsym_from_signal_handler) {
+  ScopedSignalHandler ssh(SIGUSR1, dlsym_from_signal_handler);
+  g_dlsym_from_signal_handler_count = 0;
+
+  std::atomic<bool> done(false);
+  std::thread loader([&done] {
+    while (!done) {
+      void* handle = dlopen("libtest_simple.so", RTLD_NOW);
+      if (handle != nullptr) dlclose(handle);
+    }
+  });
+  pthread_t self = pthread_self();
+  std::thread signaller([&done, self] {
+    while (!done) {
+      pthread_kill(self, SIGUSR1);
+      usleep(10);
+    }
+  });
+
+  std::string failure;
+  for (size_t i = 0; i < 10000 && failure.empty(); ++i) {
+    if (dlsym(RTLD_DEFAULT, "ThisSymbolDoesNotExist") != nullptr) {
+      failure = "ThisSymbolDoesNotExist found";
+    }
+    const char* error = dlerror();
+    if (error == nullptr || strstr(error, "ThisSymbolDoesNotExist") == nullptr) {
+      failure = std::string("unexpected dlerror: ") + (error ? error : "(null)");
+    }
+  }
+  done = true;
+  signaller.join();
+  loader.join();
+
+  ASSERT_EQ("", failure);
+  ASSERT_NE(0U, g_dlsym_from_signal_handler_count.load());
+}
+
 TEST(dlfcn, dladdr_executable) {
   dlerror(); // Clear any pending errors.
   void* self = dlopen(nullptr, RTLD_NOW);
@@ -1015,6 +1141,118 @@ TEST(dlfcn, dladdr_libc) {
   ASSERT_EQ(addr, info.dli_saddr);
 }
 
+struct LoadedRange {
+  std::string name;
+  uintptr_t base;
+  uintptr_t start;
+  uintptr_t end;
+};
+
+// Returns the PT_LOAD ranges of every loaded library, as reported by dl_iterate_phdr().
+static std::vector<LoadedRange> GetLoadedRanges() {
+  std::vector<LoadedRange> ranges;
+  dl_iterate_phdr([](dl_phdr_info* info, size_t, void* data) {
+    auto ranges = reinterpret_cast<std::vector<LoadedRange>*>(data);
+    uintptr_t min_vaddr = UINTPTR_MAX;
+    for (size_t i = 0; i < info->dlpi_phnum; ++i) {
+      const ElfW(Phdr)* phdr = &info->dlpi_phdr[i];
+      if (phdr->p_type == PT_LOAD) min_vaddr = std::min<uintptr_t>(min_vaddr, phdr->p_vaddr);
+    }
+    uintptr_t base = info->dlpi_addr + (min_vaddr & ~(getpagesize() - 1));
+    for (size_t i = 0; i < info->dlpi_phnum; ++i) {
+      const ElfW(Phdr)* phdr = &info->dlpi_phdr[i];
+      if (phdr->p_type != PT_LOAD || phdr->p_memsz == 0) continue;
+      uintptr_t start = info->dlpi_addr + phdr->p_vaddr;
+      ranges->push_back({info->dlpi_name, base, start, start + phdr->p_memsz});
+    }
+    return 0;
+  }, &ranges);
+  return ranges;
+}
+
+// Checks dladdr() at both ends and the middle of every loaded range, and sets `count` to the
+// number of ranges.
+static void CheckDladdrAgainstLoadedRanges(size_t* count) {
+  std::vector<LoadedRange> ranges = GetLoadedRanges();
+  for (const LoadedRange& range : ranges) {
+    for (uintptr_t addr : { range.start, range.start + (range.end - range.start) / 2, range.end - 1 }) {
+      Dl_info info;
+      ASSERT_NE(0, dladdr(reinterpret_cast<void*>(addr), &info)) << range.name << " " << addr;
+      ASSERT_EQ(range.base, reinterpret_cast<uintptr_t>(info.dli_fbase)) << range.name;
+      // glibc reports the executable with an empty name.
+      if (!range.name.empty()) ASSERT_EQ(range.name, info.dli_fname);
+    }
+  }
+  *count = ranges.size();
+}
+
+// Checks that dladdr() maps `name`'s address in `handle` back to `name`.
+static void CheckDladdrAgainstDlsym(void* handle, const char* name) {
+  void* sym = dlsym(handle, name);
+  ASSERT_TRUE(sym != nullptr) << dlerror();
+  for (char* addr : { static_cast<char*>(sym), static_cast<char*>(sym) + 1 }) {
+    Dl_info info;
+    ASSERT_NE(0, dladdr(addr, &info)) << name;
+    ASSERT_STREQ(name, info.dli_sname);
+    ASSERT_EQ(sym, info.dli_saddr);
+  }
+}
+
+// The linker answers dladdr() from an index of the loaded ranges, and switches to a sorted
+// symbol table for libraries that are looked up by address repeatedly. Check both against
+// dl_iterate_phdr() and dlsym(), including after libraries are loaded and unloaded.
+TEST(dlfcn, dladdr_repeated) {
+  size_t initial_ranges;
+  ASSERT_NO_FATAL_FAILURE(CheckDladdrAgainstLoadedRanges(&initial_ranges));
+
+#if defined(__BIONIC__)
+  // glibc's libc has aliases such as _IO_puts at the same address.
+  for (size_t n = 0; n < 16; ++n) {
+    ASSERT_NO_FATAL_FAILURE(CheckDladdrAgainstDlsym(RTLD_DEFAULT, "puts"));
+  }
+#endif
+
+  void* gnu = dlopen("libgnu-hash-table-library.so", RTLD_NOW);
+  ASSERT_TRUE(gnu != nullptr) << dlerror();
+  for (size_t n = 0; n < 16; ++n) {
+    ASSERT_NO_FATAL_FAILURE(CheckDladdrAgainstDlsym(gnu, "getRandomNumber"));
+  }
+  size_t ranges;
+  ASSERT_NO_FATAL_FAILURE(CheckDladdrAgainstLoadedRanges(&ranges));
+  ASSERT_GT(ranges, initial_ranges);
+
+  // Loading another library moves the ranges around the one whose symbols are already sorted.
+  void* sysv = dlopen("libsysv-hash-table-library.so", RTLD_NOW);
+  ASSERT_TRUE(sysv != nullptr) << dlerror();
+  for (size_t n = 0; n < 16; ++n) {
+    ASSERT_NO_FATAL_FAILURE(CheckDladdrAgainstDlsym(gnu, "getRandomNumber"));
+    ASSERT_NO_FATAL_FAILURE(CheckDladdrAgainstDlsym(sysv, "getRandomNumber"));
+  }
+  ASSERT_NO_FATAL_FAILURE(CheckDladdrAgainstLoadedRanges(&ranges));
+
+  // Once a library is unloaded, its addresses must no longer be attributed to it.
+  void* gnu_sym = dlsym(gnu, "getRandomNumber");
+  ASSERT_TRUE(gnu_sym != nullptr) << dlerror();
+  Dl_info info;
+  ASSERT_NE(0, dladdr(gnu_sym, &info));
+  std::string gnu_path = info.dli_fname;
+  ASSERT_EQ(0, dlclose(gnu));
+  void* still_loaded = dlopen("libgnu-hash-table-library.so", RTLD_NOW | RTLD_NOLOAD);
+  if (still_loaded != nullptr) {
+    dlclose(still_loaded);
+  } else if (dladdr(gnu_sym, &info) != 0) {
+    ASSERT_NE(gnu_path, info.dli_fname);
+  }
+  for (size_t n = 0; n < 16; ++n) {
+    ASSERT_NO_FATAL_FAILURE(CheckDladdrAgainstDlsym(sysv, "getRandomNumber"));
+  }
+  ASSERT_NO_FATAL_FAILURE(CheckDladdrAgainstLoadedRanges(&ranges));
+
+  ASSERT_EQ(0, dlclose(sysv));
+  ASSERT_NO_FATAL_FAILURE(CheckDladdrAgainstLoadedRanges(&ranges));
+  ASSERT_EQ(initial_ranges, ranges);
+}
+
 TEST(dlfcn, dladdr_invalid) {
   Dl_info info;
 
@@ -1252,6 +1490,53 @@ TEST(dlfcn, symbol_versioning_default_via_dlsym) {
   dlclose(handle);
 }
 
+TEST(dlfcn, symbol_versioning_two_versions_in_one_group) {
+  // The group's lookups are cached by name, so the lookup of versioned_function@TESTLIB_V2 finds a
+  // cached entry for TESTLIB_V1 first, and must not use it.
+  void* handle = dlopen("libtest_lookup_cache_versions.so", RTLD_NOW);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+
+  typedef int (*fn_t)();
+  void* v1 = dlopen("libtest_versioned_uselibv1.so", RTLD_NOW | RTLD_NOLOAD);
+  ASSERT_TRUE(v1 != nullptr) << dlerror();
+  fn_t fn = reinterpret_cast<fn_t>(dlsym(v1, "get_function_version"));
+  ASSERT_TRUE(fn != nullptr) << dlerror();
+  EXPECT_EQ(1, fn());
+
+  void* v2 = dlopen("libtest_versioned_uselibv2.so", RTLD_NOW | RTLD_NOLOAD);
+  ASSERT_TRUE(v2 != nullptr) << dlerror();
+  fn = reinterpret_cast<fn_t>(dlsym(v2, "get_function_version"));
+  ASSERT_TRUE(fn != nullptr) << dlerror();
+  EXPECT_EQ(2, fn());
+
+  dlclose(v2);
+  dlclose(v1);
+  dlclose(handle);
+}
+
+TEST(dlfcn, lookup_cache_dt_symbolic) {
+  // Every library in the group looks up lookup_cache_value and the undefined weak
+  // lookup_cache_missing, in the order _root, _first, _symbolic, _last. Only the DF_SYMBOLIC
+  // library starts its search with itself, so the cached answers mustn't leak into or out of it.
+  void* handle = dlopen("libtest_lookup_cache_root.so", RTLD_NOW);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+
+  typedef int (*fn_t)();
+  const std::pair<const char*, int> expected[] = {
+    { "lookup_cache_get_from_root", 1 },
+    { "lookup_cache_get_from_first", 1 },
+    { "lookup_cache_get_from_symbolic", 2 },
+    { "lookup_cache_get_from_last", 1 },
+  };
+  for (const auto& [name, value] : expected) {
+    fn_t fn = reinterpret_cast<fn_t>(dlsym(handle, name));
+    ASSERT_TRUE(fn != nullptr) << dlerror();
+    EXPECT_EQ(value, fn()) << name;
+  }
+
+  dlclose(handle);
+}
+
 TEST(dlfcn, dlvsym_smoke) {
 #if !defined(ANDROID_HOST_MUSL)
   void* handle = dlopen("libtest_versioned_lib.so", RTLD_NOW);
@@ -1276,6 +1561,121 @@ TEST(dlfcn, dlvsym_smoke) {
 #endif
 }
 
+TEST(dlfcn, dlvsym_version_in_several_libraries) {
+#if !defined(ANDROID_HOST_MUSL)
+  // libtest_versioned_otherlib.so comes first in this group, and only defines TESTLIB_V2, so the
+  // other versions are found in libtest_versioned_lib.so.
+  void* handle = dlopen("libtest_versioned_uselibv3_other.so", RTLD_NOW);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+
+  typedef int (*fn_t)();
+  const std::pair<const char*, int> expected[] = {
+    { "TESTLIB_V1", 1 },
+    { "TESTLIB_V2", 20 },
+    { "TESTLIB_V3", 3 },
+  };
+  for (const auto& [version, value] : expected) {
+    fn_t fn = reinterpret_cast<fn_t>(dlvsym(handle, "versioned_function", version));
+    ASSERT_TRUE(fn != nullptr) << version << ": " << dlerror();
+    EXPECT_EQ(value, fn()) << version;
+  }
+
+  dlclose(handle);
+#else
+  GTEST_SKIP() << "musl doesn't have dlvsym";
+#endif
+}
+
+TEST(dlfcn, dlvsym_version_in_library_loaded_later) {
+#if !defined(ANDROID_HOST_MUSL)
+  // libtest_versioned_otherlib.so defines TESTLIB_V2 after libtest_versioned_lib.so already has.
+  void* handle = dlopen("libtest_versioned_lib.so", RTLD_NOW);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+  void* other_handle = dlopen("libtest_versioned_otherlib.so", RTLD_NOW);
+  ASSERT_TRUE(other_handle != nullptr) << dlerror();
+
+  typedef int (*fn_t)();
+  fn_t fn = reinterpret_cast<fn_t>(dlvsym(other_handle, "versioned_function", "TESTLIB_V2"));
+  ASSERT_TRUE(fn != nullptr) << dlerror();
+  EXPECT_EQ(20, fn());
+  fn = reinterpret_cast<fn_t>(dlvsym(handle, "versioned_function", "TESTLIB_V2"));
+  ASSERT_TRUE(fn != nullptr) << dlerror();
+  EXPECT_EQ(2, fn());
+
+  fn = reinterpret_cast<fn_t>(dlvsym(other_handle, "versioned_function", "TESTLIB_V3"));
+  ASSERT_TRUE(fn == nullptr);
+  ASSERT_SUBSTR("undefined symbol: versioned_function, version TESTLIB_V3", dlerror());
+
+  dlclose(other_handle);
+  dlclose(handle);
+
+  // A version that was asked for before any library defined it, and that outlives the library
+  // that first defined it.
+  ASSERT_TRUE(dlopen("libtest_verdef_ids.so", RTLD_NOW | RTLD_NOLOAD) == nullptr);
+  ASSERT_TRUE(dlvsym(RTLD_DEFAULT, "verdef_ids_versioned", "TESTLIB_VERDEF_IDS") == nullptr);
+  for (int i = 0; i < 2; ++i) {
+    handle = dlopen("libtest_verdef_ids.so", RTLD_NOW);
+    ASSERT_TRUE(handle != nullptr) << dlerror();
+    fn = reinterpret_cast<fn_t>(dlvsym(handle, "verdef_ids_versioned", "TESTLIB_VERDEF_IDS"));
+    ASSERT_TRUE(fn != nullptr) << dlerror();
+    EXPECT_EQ(3, fn());
+    dlclose(handle);
+  }
+#else
+  GTEST_SKIP() << "musl doesn't have dlvsym";
+#endif
+}
+
+TEST(dlfcn, dlvsym_unknown_version) {
+#if !defined(ANDROID_HOST_MUSL)
+  // No library defines this version.
+  void* handle = dlopen("libtest_verdef_ids.so", RTLD_NOW);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+
+  typedef int (*fn_t)();
+  fn_t fn;
+#if defined(__BIONIC__)
+  // bionic lets it match symbols without a version of their own (glibc doesn't).
+  fn = reinterpret_cast<fn_t>(
+      dlvsym(handle, "verdef_ids_unversioned", "TESTLIB_VERDEF_IDS_UNKNOWN"));
+  ASSERT_TRUE(fn != nullptr) << dlerror();
+  EXPECT_EQ(1, fn());
+#endif
+
+  fn = reinterpret_cast<fn_t>(dlvsym(handle, "verdef_ids_versioned", "TESTLIB_VERDEF_IDS_UNKNOWN"));
+  ASSERT_TRUE(fn == nullptr);
+  ASSERT_SUBSTR("undefined symbol: verdef_ids_versioned, version TESTLIB_VERDEF_IDS_UNKNOWN",
+                dlerror());
+
+  dlclose(handle);
+#else
+  GTEST_SKIP() << "musl doesn't have dlvsym";
+#endif
+}
+
+TEST(dlfcn, dlvsym_version_defined_twice) {
+#if defined(__BIONIC__)
+  // libtest_verdef_ids.so has a version named after its soname, which the base version is also
+  // named after. The first definition, the base version, is the one that's used.
+  void* handle = dlopen("libtest_verdef_ids.so", RTLD_NOW);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+
+  typedef int (*fn_t)();
+  fn_t fn = reinterpret_cast<fn_t>(
+      dlvsym(handle, "verdef_ids_unversioned", "libtest_verdef_ids.so"));
+  ASSERT_TRUE(fn != nullptr) << dlerror();
+  EXPECT_EQ(1, fn());
+
+  fn = reinterpret_cast<fn_t>(
+      dlvsym(handle, "verdef_ids_named_after_soname", "libtest_verdef_ids.so"));
+  ASSERT_TRUE(fn == nullptr);
+
+  dlclose(handle);
+#else
+  GTEST_SKIP() << "glibc uses the version node, not the base version";
+#endif
+}
+
 // This preempts the implementation from libtest_versioned_lib.so
 extern "C" int version_zero_function() {
   return 0;
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+// Loads the library named on the command line with relocation statistics on, and prints how many
+// symbol lookups relocating it took and how many of those a binding cache file answered. With a
+// second argument of "lazy" or "now", the library is loaded into a namespace that allows lazy
+// binding, with RTLD_LAZY or RTLD_NOW respectively.
+
+#include <android/dlext.h>
+#include <dlfcn.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include "../core_shared_libs.h"
+#include "../dlext_private.h"
+
+static void* OpenInLazyBindingNamespace(const char* path, int flags) {
+  std::string dir(path, strrchr(path, '/') - path);
+  android_namespace_t* ns =
+      android_create_namespace("lazy", nullptr, dir.c_str(),
+                               ANDROID_NAMESPACE_TYPE_ISOLATED |
+                                   ANDROID_NAMESPACE_TYPE_LAZY_BINDING,
+                               nullptr, nullptr);
+  if (ns == nullptr || !android_link_namespaces(ns, nullptr, kCoreSharedLibs)) {
+    return nullptr;
+  }
+
+  android_dlextinfo extinfo = {
+    .flags = ANDROID_DLEXT_USE_NAMESPACE,
+    .library_namespace = ns,
+  };
+  return android_dlopen_ext(path, flags, &extinfo);
+}
+
+int main(int argc, char* argv[]) {
+  if (argc != 2 && !(argc == 3 && (strcmp(argv[2], "lazy") == 0 || strcmp(argv[2], "now") == 0))) {
+    fprintf(stderr, "usage: %s LIBRARY [lazy|now]\n", argv[0]);
+    return 1;
+  }
+
+  android_dl_set_reloc_stats_enabled(true);
+  void* handle;
+  if (argc == 3) {
+    handle = OpenInLazyBindingNamespace(argv[1],
+                                        strcmp(argv[2], "lazy") == 0 ? RTLD_LAZY : RTLD_NOW);
+  } else {
+    handle = dlopen(argv[1], RTLD_NOW);
+  }
+  if (handle == nullptr) {
+    fprintf(stderr, "%s\n", dlerror());
+    return 1;
+  }
+
+  android_dl_reloc_stats stats;
+  if (!android_dl_get_reloc_stats(handle, &stats)) {
+    fprintf(stderr, "%s\n", dlerror());
+    return 1;
+  }
+  printf("%zu %zu\n", stats.symbol_lookups, stats.symbol_lookups_from_binding_cache);
+  return 0;
+}
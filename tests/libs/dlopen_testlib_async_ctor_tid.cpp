@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/types.h>
+#include <unistd.h>
+
+// Records which thread ran the constructor, to tell whether an android_dlopen_async() load ran on
+// the worker or on the thread that waited for it.
+
+static pid_t g_ctor_tid = 0;
+
+static void __attribute__((constructor)) record_ctor_tid() {
+  g_ctor_tid = gettid();
+}
+
+extern "C" pid_t dlopen_async_ctor_tid() {
+  return g_ctor_tid;
+}
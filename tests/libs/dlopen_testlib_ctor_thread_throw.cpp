@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+
+// The constructor waits for a thread that throws and catches an exception, so the unwinder has
+// to find this library's unwind tables while dlopen() of it is still in progress.
+
+static bool g_caught = false;
+
+static void __attribute__((noinline)) throw_from_this_library() {
+  throw 42;
+}
+
+static void* thread_fn(void*) {
+  try {
+    throw_from_this_library();
+  } catch (int) {
+    g_caught = true;
+  }
+  return nullptr;
+}
+
+static void __attribute__((constructor)) throw_on_thread_from_ctor() {
+  pthread_t t;
+  if (pthread_create(&t, nullptr, thread_fn, nullptr) == 0) {
+    pthread_join(t, nullptr);
+  }
+}
+
+extern "C" bool ctor_thread_caught_exception() {
+  return g_caught;
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <dlfcn.h>
+
+// The resolver loads, looks up and unloads another library, so it needs the loader lock
+// exclusively from inside the dlsym() or dladdr() call that runs it.
+
+extern "C" int return_simple_loaded() {
+  return 1;
+}
+
+extern "C" int return_simple_not_loaded() {
+  return 0;
+}
+
+typedef int (*fn_ptr)();
+
+extern "C" fn_ptr ifunc_dlopen_resolver() {
+  void* handle = dlopen("libtest_simple.so", RTLD_NOW);
+  if (handle == nullptr) return return_simple_not_loaded;
+  void* sym = dlsym(handle, "dlopen_testlib_simple_func");
+  dlclose(handle);
+  return sym != nullptr ? return_simple_loaded : return_simple_not_loaded;
+}
+
+// Nothing in this library calls it, so the resolver only runs when it's looked up.
+extern "C" int ifunc_dlopen() __attribute__((ifunc("ifunc_dlopen_resolver")));
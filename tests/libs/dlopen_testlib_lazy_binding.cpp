@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+extern "C" int lazy_binding_dep_value();
+
+extern "C" int lazy_binding_get_value() {
+  return lazy_binding_dep_value();
+}
+
+extern "C" int lazy_binding_dep_ctor_value();
+
+static int g_ctor_value = 0;
+
+// Calls through a PLT slot that hasn't been bound yet while dlopen() still holds the loader lock.
+static void __attribute__((constructor)) init_ctor_value() {
+  g_ctor_value = lazy_binding_dep_ctor_value();
+}
+
+extern "C" int lazy_binding_get_ctor_value() {
+  return g_ctor_value;
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Built into several libraries of one group, to check that the lookups cached while relocating
+// the group give the same answers as uncached ones. LOOKUP_CACHE_GETTER names this library's
+// accessor, and if LOOKUP_CACHE_VALUE is defined, the library also defines lookup_cache_value.
+
+extern "C" {
+
+#if defined(LOOKUP_CACHE_VALUE)
+int lookup_cache_value = LOOKUP_CACHE_VALUE;
+#else
+extern int lookup_cache_value;
+#endif
+
+// Nothing defines this, so the first library to look it up caches a miss, and the others hit it.
+extern int lookup_cache_missing __attribute__((weak));
+
+int LOOKUP_CACHE_GETTER() {
+  return &lookup_cache_missing == nullptr ? lookup_cache_value : -1;
+}
+
+}
@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Built into a group of libraries, some of which reference a symbol that nothing defines, so that
+// relocating the group fails part of the way through.
+
+#if defined(REFERENCE_MISSING_SYMBOL)
+extern "C" int parallel_reloc_missing_symbol();
+
+extern "C" int parallel_reloc_call_missing() {
+  return parallel_reloc_missing_symbol();
+}
+#endif
+
+extern "C" int parallel_reloc_get_value() {
+  return 1;
+}
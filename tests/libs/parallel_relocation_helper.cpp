@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+// Loads the library named on the command line and prints either the result of calling the given
+// function in it or the dlopen() error. Then prints whether each of the remaining libraries is
+// still loaded, so that the output can be compared between serial and parallel relocation.
+
+#include <dlfcn.h>
+#include <stdio.h>
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s LIBRARY FUNCTION [LIBRARY...]\n", argv[0]);
+    return 1;
+  }
+
+  void* handle = dlopen(argv[1], RTLD_NOW);
+  if (handle == nullptr) {
+    printf("%s\n", dlerror());
+  } else {
+    auto fn = reinterpret_cast<int (*)()>(dlsym(handle, argv[2]));
+    if (fn == nullptr) {
+      fprintf(stderr, "%s\n", dlerror());
+      return 1;
+    }
+    printf("%s() = %d\n", argv[2], fn());
+  }
+
+  for (int i = 3; i < argc; ++i) {
+    void* loaded = dlopen(argv[i], RTLD_NOW | RTLD_NOLOAD);
+    printf("%s is %s\n", argv[i], loaded != nullptr ? "loaded" : "not loaded");
+  }
+  return 0;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+// Loads the library named on the command line, and prints the path of every RELRO cache file
+// (see LD_RELRO_CACHE_DIR) that the process has mapped.
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <set>
+#include <string>
+
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s LIBRARY\n", argv[0]);
+    return 1;
+  }
+
+  if (dlopen(argv[1], RTLD_NOW) == nullptr) {
+    fprintf(stderr, "%s\n", dlerror());
+    return 1;
+  }
+
+  FILE* maps = fopen("/proc/self/maps", "re");
+  if (maps == nullptr) {
+    perror("/proc/self/maps");
+    return 1;
+  }
+  std::set<std::string> paths;
+  char line[BUFSIZ];
+  while (fgets(line, sizeof(line), maps) != nullptr) {
+    char* path = strchr(line, '/');
+    if (path == nullptr) continue;
+    path[strcspn(path, "\n")] = '\0';
+    size_t length = strlen(path);
+    if (length > 6 && strcmp(path + length - 6, ".relro") == 0) paths.insert(path);
+  }
+  fclose(maps);
+
+  for (const std::string& path : paths) printf("%s\n", path.c_str());
+  return 0;
+}
@@ -30,12 +30,21 @@
 
 #include <dlfcn.h>
 #include <link.h>
+#include <string.h>
 #if __has_include(<sys/auxv.h>)
 #include <sys/auxv.h>
 #endif
+#include <unistd.h>
 
+#include <atomic>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
+
+#include <android-base/file.h>
+
+#include "utils.h"
 
 TEST(link, dl_iterate_phdr_early_exit) {
   static size_t call_count = 0;
@@ -127,6 +136,137 @@ TEST(link, dl_iterate_phdr_counters) {
   ASSERT_LT(before_dlclose.subs, after_dlclose.subs);
 }
 
+// Constructors run before dlopen() returns, so the libraries being loaded must already be visible
+// to dl_iterate_phdr() (and so to the unwinder) on other threads by then.
+TEST(link, dl_iterate_phdr_from_ctor_thread) {
+  void* handle = dlopen("libtest_ctor_thread_throw.so", RTLD_NOW);
+  ASSERT_TRUE(handle != nullptr) << dlerror();
+  auto caught = reinterpret_cast<bool (*)()>(dlsym(handle, "ctor_thread_caught_exception"));
+  ASSERT_TRUE(caught != nullptr) << dlerror();
+  ASSERT_TRUE(caught());
+  dlclose(handle);
+}
+
+// dl_iterate_phdr doesn't wait for dlopen/dlclose, so unloaded libraries must stay mapped until
+// every iteration that could have seen them has finished.
+TEST(link, dl_iterate_phdr_concurrent_with_dlclose) {
+  std::atomic<bool> done(false);
+  std::thread loader([&done] {
+    while (!done) {
+      void* handle = dlopen("libtest_empty.so", RTLD_NOW);
+      if (handle != nullptr) dlclose(handle);
+    }
+  });
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < 4; ++i) {
+    threads.emplace_back([] {
+      for (size_t j = 0; j < 1000; ++j) {
+        dl_iterate_phdr([](dl_phdr_info* info, size_t, void*) {
+          // Touch every program header, and the name, of every library reported.
+          size_t sum = strlen(info->dlpi_name);
+          for (size_t k = 0; k < info->dlpi_phnum; ++k) sum += info->dlpi_phdr[k].p_type;
+          return sum == 0 ? 1 : 0;
+        }, nullptr);
+      }
+    });
+  }
+  for (auto& t : threads) t.join();
+  done = true;
+  loader.join();
+}
+
+// A callback may itself unload a library that the iteration has yet to report.
+TEST(link, dl_iterate_phdr_dlclose_from_callback) {
+  void* handle = dlopen("libtest_empty.so", RTLD_NOW);
+  ASSERT_NE(nullptr, handle);
+
+  size_t call_count = 0;
+  struct State {
+    void* handle;
+    size_t* call_count;
+  } state = {handle, &call_count};
+  ASSERT_EQ(0, dl_iterate_phdr([](dl_phdr_info* info, size_t, void* data) {
+    State* state = static_cast<State*>(data);
+    if (state->handle != nullptr) {
+      EXPECT_EQ(0, dlclose(state->handle));
+      state->handle = nullptr;
+    }
+    // The library unloaded above is still readable if it's reported.
+    size_t load_segments = 0;
+    for (size_t i = 0; i < info->dlpi_phnum; ++i) {
+      if (info->dlpi_phdr[i].p_type == PT_LOAD) ++load_segments;
+    }
+    EXPECT_GT(load_segments, 0U) << info->dlpi_name;
+    ++*state->call_count;
+    return 0;
+  }, &state));
+  ASSERT_GT(call_count, 0U);
+}
+
+static bool IsMapped(const char* name) {
+  std::string maps;
+  return android::base::ReadFileToString("/proc/self/maps", &maps) &&
+         maps.find(name) != std::string::npos;
+}
+
+// Loads and unloads libtest_empty.so, and exits with 0 if it's unmapped afterwards.
+static void ExitWithUnloadResult() {
+  void* handle = dlopen("libtest_empty.so", RTLD_NOW);
+  if (handle == nullptr || !IsMapped("libtest_empty.so") || dlclose(handle) != 0) _exit(2);
+  _exit(IsMapped("libtest_empty.so") ? 1 : 0);
+}
+
+// Unloaded libraries are only unmapped once no dl_iterate_phdr() callback might be looking at
+// them. A child forked while another thread was in a callback doesn't have that thread.
+TEST(link, dl_iterate_phdr_fork_while_iterating) {
+#if !defined(__BIONIC__)
+  GTEST_SKIP() << "glibc's dl_iterate_phdr() holds a lock that a child process inherits";
+#endif
+  std::atomic<bool> in_callback(false);
+  std::atomic<bool> done(false);
+  struct State {
+    std::atomic<bool>* in_callback;
+    std::atomic<bool>* done;
+  } state = {&in_callback, &done};
+  std::thread iterator([&state] {
+    dl_iterate_phdr([](dl_phdr_info*, size_t, void* data) {
+      State* state = static_cast<State*>(data);
+      *state->in_callback = true;
+      while (!*state->done) usleep(1000);
+      return 1;
+    }, &state);
+  });
+  while (!in_callback) usleep(1000);
+
+  pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+  if (pid == 0) ExitWithUnloadResult();
+
+  done = true;
+  iterator.join();
+  AssertChildExited(pid, 0);
+}
+
+// The thread that forks does continue in the child, so its own callback is still protected.
+TEST(link, dl_iterate_phdr_fork_from_callback) {
+#if !defined(__BIONIC__)
+  GTEST_SKIP() << "glibc's dl_iterate_phdr() holds a lock that a child process inherits";
+#endif
+  pid_t pid = -1;
+  dl_iterate_phdr([](dl_phdr_info*, size_t, void* data) {
+    pid_t* pid = static_cast<pid_t*>(data);
+    *pid = fork();
+    return 1;
+  }, &pid);
+  ASSERT_NE(-1, pid);
+  if (pid == 0) {
+    // The callback has returned, so nothing holds unloaded libraries any more.
+    ExitWithUnloadResult();
+  }
+  AssertChildExited(pid, 0);
+}
+
 struct ProgHdr {
   const ElfW(Phdr)* table;
   size_t size;